@@ -42,12 +42,25 @@ char *Usage[] =
 #ifdef THREADS
    (char *)"      [-numThreads <number of threads (default=1)>]\n",
 #endif
+   (char *)"      [-bondCadence <updates between bonding pair searches (default=1)>]\n",
+   (char *)"      [-adaptiveStep <minimum update step>,<maximum update step>]\n",
+   (char *)"      [-minimize <force tolerance> (relax initial state)]\n",
+   (char *)"      [-formulaStats (molecule types by formula only)]\n",
+   (char *)"      [-motif <name>[=<atomic numbers>/<bonds>[!]] (count motif; multiple option)]\n",
    (char *)"      [-vesselRadius <vessel radius>]\n",
    (char *)"      [-thermal <radius>,<x>,<y>,<z>,<temperature>] (multiple option)\n",
    (char *)"      [-randomSeed <random seed>]\n",
    (char *)"      [-load <load file name>]\n",
    (char *)"      [-save <save file name>]\n",
    (char *)"      [-dump <molecule dump file name> ('-' for stdout)]\n",
+   (char *)"      [-bondEvents <bond event log file name>]\n",
+   (char *)"      [-reactions <reaction network file name>]\n",
+   (char *)"      [-trajectory <trajectory file name>]\n",
+   (char *)"      [-trajectoryFreq <cycles between trajectory frames (default=100)>]\n",
+   (char *)"      [-trajectoryPrecision <trajectory position precision (default=0.001)>]\n",
+   (char *)"      [-replay <trajectory file name> (view trajectory)]\n",
+   (char *)"      [-recipes <molecule recipe output file name>]\n",
+   (char *)"      [-seedRecipes <molecule recipe input file name>]\n",
    (char *)"      [-noGraphics (turn off graphics)]\n",
    (char *)"      [-statsFreq <statistics gather frequency (0=never, 1=default)>]\n",
    NULL
@@ -69,6 +82,37 @@ float     VesselRadius = DEFAULT_VESSEL_RADIUS;
 int       NumAtoms     = DEFAULT_NUM_ATOMS;
 Chemistry *chemistry   = NULL;
 bool      Update       = true;
+int       BondCadence  = DEFAULT_BOND_CADENCE;
+bool      FormulaStats = false;
+
+// Background molecule statistics.
+StatsService *MoleculeStatsService = NULL;
+
+// Molecular motifs to count.
+vector<char *> Motifs;
+
+// Register motifs with chemistry.
+void addMotifs(Chemistry *chemistry)
+{
+#if (O2_MOLECULES)
+   chemistry->motifIndex->add("O2");
+#endif
+#if (H2O_MOLECULES)
+   chemistry->motifIndex->add("H2O");
+#endif
+#if (CO2_MOLECULES)
+   chemistry->motifIndex->add("CO2");
+#endif
+   for (int i = 0, j = (int)Motifs.size(); i < j; i++)
+   {
+      chemistry->motifIndex->add(Motifs[i]);
+   }
+}
+
+
+// Adaptive update step bounds.
+float MinUpdateStep = 0.0f;
+float MaxUpdateStep = 0.0f;
 
 #ifdef THREADS
 // Threads.
@@ -90,6 +134,31 @@ Random *Randomizer = NULL;
 char *SaveFile = NULL;
 char *LoadFile = NULL;
 
+// Bond event log file.
+char *BondEventFile = NULL;
+FILE *BondEventFp   = NULL;
+
+// Reaction network file.
+char *ReactionFile = NULL;
+
+// Trajectory file.
+char             *TrajectoryFile     = NULL;
+FILE             *TrajectoryFp       = NULL;
+int              TrajectoryFreq      = TrajectoryWriter::DEFAULT_FRAME_FREQ;
+float            TrajectoryPrecision = TrajectoryWriter::DEFAULT_PRECISION;
+TrajectoryWriter *Trajectory         = NULL;
+
+// Trajectory replay.
+char             *ReplayFile = NULL;
+FILE             *ReplayFp   = NULL;
+TrajectoryReader *Replay     = NULL;
+int              ReplayFrame = 0;
+int              ReplaySpeed = 1;
+
+// Molecule recipe output and seeding files.
+char *RecipeFile     = NULL;
+char *SeedRecipeFile = NULL;
+
 // Graphics window dimensions.
 bool Graphics     = true;
 int  WindowWidth  = WINDOW_WIDTH;
@@ -199,6 +268,9 @@ GUITabbedPanel *controlPanel;
 GUISlider      *delaySlider;
 GUILabel       *statusText;
 GUIPanel       *cyclePanel;
+GUIPanel       *replayPanel;
+GUISlider      *replaySlider;
+GUISlider      *replaySpeedSlider;
 GUILabel       *cycleDisplay;
 GUIComboBox    *createOp;
 GUIComboBox    *deleteOp;
@@ -426,51 +498,47 @@ void displayControls(void)
       if (StatsCounter == StatsFreq)
       {
          StatsCounter = 0;
-#if ( O2_MOLECULES )
-         sprintf(str, "O2 = %d\n", chemistry->countO2());
-         buf.append(str);
-#endif
-#if ( H2O_MOLECULES )
-         sprintf(str, "H2O = %d\n", chemistry->countH2O());
-         buf.append(str);
-#endif
-#if ( CO2_MOLECULES )
-         sprintf(str, "CO2 = %d\n", chemistry->countCO2());
-         buf.append(str);
-#endif
+         for (int i = 0, j = (int)chemistry->motifIndex->motifs.size(); i < j; i++)
+         {
+            sprintf(str, "%s = %d\n", chemistry->motifIndex->motifs[i]->name,
+                    chemistry->motifIndex->motifs[i]->getCount());
+            buf.append(str);
+         }
 #if (ORGANIC_MOLECULES)
-         static int   num, numClosed, numTypes, numClosedTypes;
-         static float aveSize, aveClosedSize;
+         // Statistics are computed in the background and shown
+         // once available.
+         static MoleculeStats stats;
+         if (MoleculeStatsService == NULL)
+         {
+            MoleculeStatsService = new StatsService();
+            assert(MoleculeStatsService != NULL);
+         }
          if (Update)
          {
-            chemistry->getMoleculeStats(num, numClosed, numTypes,
-                                        numClosedTypes, aveSize, aveClosedSize);
+            MoleculeStatsService->request(chemistry);
          }
-         sprintf(str, "Molecules = %d, Closed = %d\n", num, numClosed);
+         MoleculeStatsService->getStats(stats);
+         sprintf(str, "Molecules = %d, Closed = %d\n", stats.num, stats.numClosed);
          buf.append(str);
-         sprintf(str, "Types = %d, Closed = %d\n", numTypes, numClosedTypes);
+         sprintf(str, "Types = %d, Closed = %d\n", stats.numTypes, stats.numClosedTypes);
          buf.append(str);
-         sprintf(str, "Size = %.2f, Closed = %.2f\n", aveSize, aveClosedSize);
+         sprintf(str, "Size = %.2f, Closed = %.2f\n", stats.aveSize, stats.aveClosedSize);
          buf.append(str);
 #endif
+         sprintf(str, "Step = %.4f, Time = %.2f\n",
+                 chemistry->updateStep, chemistry->updateTime);
+         buf.append(str);
          statusText->setLabelString(buf);
          Update = false;
       }
    }
    else
    {
-#if ( O2_MOLECULES )
-      sprintf(str, "O2 = NA\n");
-      buf.append(str);
-#endif
-#if ( H2O_MOLECULES )
-      sprintf(str, "H2O = NA\n");
-      buf.append(str);
-#endif
-#if ( CO2_MOLECULES )
-      sprintf(str, "CO2 = NA\n");
-      buf.append(str);
-#endif
+      for (int i = 0, j = (int)chemistry->motifIndex->motifs.size(); i < j; i++)
+      {
+         sprintf(str, "%s = NA\n", chemistry->motifIndex->motifs[i]->name);
+         buf.append(str);
+      }
 #if ( ORGANIC_MOLECULES )
       sprintf(str, "Molecules = NA, Closed = NA\n");
       buf.append(str);
@@ -479,11 +547,20 @@ void displayControls(void)
       sprintf(str, "Size = NA, Closed = NA\n");
       buf.append(str);
 #endif
+      sprintf(str, "Step = %.4f, Time = %.2f\n",
+              chemistry->updateStep, chemistry->updateTime);
+      buf.append(str);
       statusText->setLabelString(buf);
    }
 
    // Show cycle.
-   if (Cycles >= 0)
+   if (Replay != NULL)
+   {
+      cyclePanel->setVisible(true);
+      sprintf(str, "Cycle: %d", chemistry->updateCycle);
+      cycleDisplay->setLabelString(str);
+   }
+   else if (Cycles >= 0)
    {
       cyclePanel->setVisible(true);
       sprintf(str, "Cycle: %d/%d", CycleCounter, Cycles);
@@ -763,6 +840,7 @@ specialKeyboard(int key, int x, int y)
             }
             delete molecule;
          }
+         chemistry->resetBondSearch();
       }
       else
       {
@@ -841,10 +919,17 @@ void idle()
       }
       if (run)
       {
-         chemistry->update();
-         if (Cycles >= 0)
+         if (Replay != NULL)
+         {
+            replayChemistry(ReplayFrame + ReplaySpeed);
+         }
+         else
          {
-            CycleCounter++;
+            updateChemistry();
+            if (Cycles >= 0)
+            {
+               CycleCounter++;
+            }
          }
       }
       if (Step)
@@ -991,6 +1076,26 @@ void EventsHandler::actionPerformed(GUIEvent& evt)
          return;
       }
 
+      // Replay frame slider?
+      if (callbackString == "replayFrame")
+      {
+         if (Replay != NULL)
+         {
+            replayChemistry((int)((slider->getProgress() *
+                                   (float)(Replay->getNumFrames() - 1)) + 0.5f));
+         }
+         return;
+      }
+
+      // Replay speed slider?
+      if (callbackString == "replaySpeed")
+      {
+         ReplaySpeed = 1 + (int)(slider->getProgress() * (float)(MAX_REPLAY_SPEED - 1));
+         sprintf(buf, "Speed: %d frames/step", ReplaySpeed);
+         slider->setLabelString(buf);
+         return;
+      }
+
       // X velocity slider?
       bool setVelocity = false;
       if (callbackString == "xspeed")
@@ -1142,10 +1247,9 @@ void EventsHandler::actionPerformed(GUIEvent& evt)
                }
                if (op == "bond")
                {
-                  if ((CurrentOrbital != -1) && (body->covalentBody != NULL))
+                  if (CurrentOrbital != -1)
                   {
-                     body->covalentBody->covalentBody = NULL;
-                     body->covalentBody = NULL;
+                     chemistry->removeBond(body);
                   }
                }
                else if (op == "atom")
@@ -1191,7 +1295,7 @@ void EventsHandler::actionPerformed(GUIEvent& evt)
             {
                if (op == "import")
                {
-                  if ((fp = fopen(name.c_str(), "r")) != NULL)
+                  if ((fp = fopen(name.c_str(), "rb")) != NULL)
                   {
                      chemistry->import(fp);
                      fclose(fp);
@@ -1200,7 +1304,7 @@ void EventsHandler::actionPerformed(GUIEvent& evt)
                }
                else if (op == "load")
                {
-                  if ((fp = fopen(name.c_str(), "r")) != NULL)
+                  if ((fp = fopen(name.c_str(), "rb")) != NULL)
                   {
                      chemistry->load(fp);
                      fclose(fp);
@@ -1209,7 +1313,7 @@ void EventsHandler::actionPerformed(GUIEvent& evt)
                }
                else
                {
-                  if ((fp = fopen(name.c_str(), "w")) != NULL)
+                  if ((fp = fopen(name.c_str(), "wb")) != NULL)
                   {
                      chemistry->save(fp);
                      fclose(fp);
@@ -1303,20 +1407,11 @@ void processHits(GLint hits, GLuint buffer[], int sw)
                   Body           *body1, *body2;
                   atom1 = chemistry->getAtom(CurrentAtomID);
                   body1 = &atom1->shells[CurrentShell].orbitals[CurrentOrbital];
-                  if (body1->covalentBody != NULL)
-                  {
-                     body1->covalentBody->covalentBody = NULL;
-                     body1->covalentBody = NULL;
-                  }
+                  chemistry->removeBond(body1);
                   atom2 = chemistry->getAtom(id);
                   body2 = &atom2->shells[s].orbitals[o];
-                  if (body2->covalentBody != NULL)
-                  {
-                     body2->covalentBody->covalentBody = NULL;
-                     body2->covalentBody = NULL;
-                  }
-                  body1->covalentBody = body2;
-                  body2->covalentBody = body1;
+                  chemistry->removeBond(body2);
+                  chemistry->createBond(body1, body2);
                }
             }
 
@@ -1432,6 +1527,41 @@ void exit2DMode()
 }
 
 
+// Seed chemistry with molecules synthesized from recipes:
+// each recipe makes as many molecules as were counted for it.
+void seedRecipes(char *recipeFile)
+{
+   int        i, i2, j;
+   FILE       *fp;
+   Vector     position;
+   Reaction   *recipe;
+   RecipeBook recipeBook;
+
+   vector<int> atomIDs;
+
+   if ((fp = fopen(recipeFile, "r")) == NULL)
+   {
+      fprintf(stderr, "Cannot load recipes from file %s\n", recipeFile);
+      exit(1);
+   }
+   recipeBook.load(fp);
+   fclose(fp);
+   for (i = 0, i2 = (int)recipeBook.recipes.size(); i < i2; i++)
+   {
+      recipe = recipeBook.recipes[i];
+      for (j = 0; j < recipe->count; j++)
+      {
+         position.x = (float)chemistry->randomizer->RAND_INTERVAL(-1.0f, 1.0f);
+         position.y = (float)chemistry->randomizer->RAND_INTERVAL(-1.0f, 1.0f);
+         position.z = (float)chemistry->randomizer->RAND_INTERVAL(-1.0f, 1.0f);
+         position.Normalize((float)chemistry->randomizer->RAND_INTERVAL(0.0f,
+                                                                        chemistry->vesselRadius * 0.5f));
+         recipe->synthesize(chemistry, position, atomIDs);
+      }
+   }
+}
+
+
 // Initialize.
 void initChemistry()
 {
@@ -1456,10 +1586,42 @@ void initChemistry()
    glEnable(GL_CULL_FACE);
    glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
 
+   // Replay?
+   if (ReplayFile != NULL)
+   {
+      if ((ReplayFp = fopen(ReplayFile, "rb")) == NULL)
+      {
+         fprintf(stderr, "Cannot open trajectory file %s\n", ReplayFile);
+         exit(1);
+      }
+      Replay = new TrajectoryReader(ReplayFp);
+      assert(Replay != NULL);
+      if (!Replay->valid || (Replay->getNumFrames() == 0))
+      {
+         fprintf(stderr, "Invalid trajectory file %s\n", ReplayFile);
+         exit(1);
+      }
+      if (RandomSeed == INVALID_RANDOM)
+      {
+         RandomSeed = (RANDOM)time(NULL);
+         Randomizer = new Random(RandomSeed);
+         assert(Randomizer != NULL);
+      }
+      VesselRadius = Replay->header.vesselRadius;
+#ifdef THREADS
+      chemistry = new Chemistry(VesselRadius, Randomizer->RAND(), NumThreads);
+#else
+      chemistry = new Chemistry(VesselRadius, Randomizer->RAND());
+#endif
+      assert(chemistry != NULL);
+      chemistry->init(0);
+      replayChemistry(0);
+   }
+
    // Load?
-   if (LoadFile != NULL)
+   else if (LoadFile != NULL)
    {
-      if ((fp = fopen(LoadFile, "r")) == NULL)
+      if ((fp = fopen(LoadFile, "rb")) == NULL)
       {
          fprintf(stderr, "Cannot load from file %s\n", LoadFile);
          exit(1);
@@ -1508,6 +1670,44 @@ void initChemistry()
          chemistry->createThermal(Thermals[i].radius, Thermals[i].position, Thermals[i].temperature);
       }
    }
+   if (SeedRecipeFile != NULL)
+   {
+      seedRecipes(SeedRecipeFile);
+   }
+   chemistry->bondCadence = BondCadence;
+   chemistry->setSpeciesByFormula(FormulaStats);
+   addMotifs(chemistry);
+   if (BondEventFile != NULL)
+   {
+      if ((BondEventFp = fopen(BondEventFile, "wb")) == NULL)
+      {
+         fprintf(stderr, "Cannot open bond event file %s\n", BondEventFile);
+         exit(1);
+      }
+      BondEvent::saveHeader(BondEventFp);
+      chemistry->logBondEvents(true);
+   }
+   if (ReactionFile != NULL)
+   {
+      chemistry->trackReactions(true);
+      chemistry->generateMolecules();
+   }
+   if (MaxUpdateStep > 0.0f)
+   {
+      chemistry->minUpdateStep = MinUpdateStep;
+      chemistry->maxUpdateStep = MaxUpdateStep;
+   }
+   if (TrajectoryFile != NULL)
+   {
+      if ((TrajectoryFp = fopen(TrajectoryFile, "wb")) == NULL)
+      {
+         fprintf(stderr, "Cannot open trajectory file %s\n", TrajectoryFile);
+         exit(1);
+      }
+      Trajectory = new TrajectoryWriter(TrajectoryFp, chemistry->vesselRadius,
+                                        TrajectoryFreq, TrajectoryPrecision);
+      assert(Trajectory != NULL);
+   }
 
    if (Graphics)
    {
@@ -1568,6 +1768,16 @@ void initChemistry()
       }
       statusText = (GUILabel *)guiFrame.getWidgetByCallbackString("statusText");
       cyclePanel = (GUIPanel *)guiFrame.getWidgetByCallbackString("Cycles");
+      replayPanel       = (GUIPanel *)guiFrame.getWidgetByCallbackString("Replay");
+      replaySlider      = (GUISlider *)guiFrame.getWidgetByCallbackString("replayFrame");
+      replaySpeedSlider = (GUISlider *)guiFrame.getWidgetByCallbackString("replaySpeed");
+      replaySlider->setAlphaFadeScale(500.0f);
+      replaySpeedSlider->setAlphaFadeScale(500.0f);
+      replayPanel->setVisible(Replay != NULL);
+      if (Replay != NULL)
+      {
+         replayChemistry(ReplayFrame);
+      }
       createOp   = (GUIComboBox *)guiFrame.getWidgetByCallbackString("createOp");
       deleteOp   = (GUIComboBox *)guiFrame.getWidgetByCallbackString("deleteOp");
       moveOp     = (GUIComboBox *)guiFrame.getWidgetByCallbackString("moveOp");
@@ -1598,6 +1808,72 @@ void initChemistry()
 }
 
 
+// Replay trajectory frame, stopping at the last frame.
+void replayChemistry(int frameNum)
+{
+   int                    n;
+   char                   buf[50];
+   static TrajectoryFrame frame;
+
+   n = Replay->getNumFrames();
+   if (frameNum >= n - 1)
+   {
+      frameNum = n - 1;
+      if (Graphics && (delaySlider != NULL))
+      {
+         Delay = MAX_DELAY;
+         delaySlider->setProgress(1.0f);
+         delaySlider->setLabelString("Delay: STOP");
+      }
+   }
+   if (frameNum < 0)
+   {
+      frameNum = 0;
+   }
+   if (!Replay->read(frameNum, frame))
+   {
+      fprintf(stderr, "Cannot read trajectory frame %d\n", frameNum);
+      return;
+   }
+   frame.restore(chemistry, Replay->header.precision);
+   ReplayFrame = frameNum;
+   Update      = true;
+   if ((CurrentAtomID != -1) && (chemistry->getAtom(CurrentAtomID) == NULL))
+   {
+      CurrentAtomID = CurrentShell = CurrentOrbital = -1;
+   }
+   Replay->prefetch(frameNum + ReplaySpeed);
+   if (Graphics && (replaySlider != NULL))
+   {
+      if (n > 1)
+      {
+         replaySlider->setProgress((float)frameNum / (float)(n - 1));
+      }
+      sprintf(buf, "Frame: %d/%d", frameNum + 1, n);
+      replaySlider->setLabelString(buf);
+   }
+}
+
+
+// Update chemistry, drain bond events, record trajectory and track reactions.
+void updateChemistry()
+{
+   chemistry->update();
+   if (BondEventFp != NULL)
+   {
+      chemistry->bondEvents->drain(BondEventFp);
+   }
+   if (Trajectory != NULL)
+   {
+      Trajectory->record(chemistry);
+   }
+   if (chemistry->reactionNetwork != NULL)
+   {
+      chemistry->generateMolecules();
+   }
+}
+
+
 // Run.
 void runChemistry()
 {
@@ -1612,7 +1888,7 @@ void runChemistry()
    {
       for ( ; CycleCounter < Cycles; CycleCounter++)
       {
-         chemistry->update();
+         updateChemistry();
       }
    }
 }
@@ -1621,13 +1897,13 @@ void runChemistry()
 // Terminate.
 void termChemistry()
 {
-   int  i;
+   int  i, j;
    FILE *fp;
 
    // Save?
    if (SaveFile != NULL)
    {
-      if ((fp = fopen(SaveFile, "w")) == NULL)
+      if ((fp = fopen(SaveFile, "wb")) == NULL)
       {
          fprintf(stderr, "Cannot save to file %s\n", SaveFile);
          exit(1);
@@ -1648,6 +1924,66 @@ void termChemistry()
       fclose(fp);
    }
 
+   // Close bond event log.
+   if (BondEventFp != NULL)
+   {
+      chemistry->bondEvents->drain(BondEventFp);
+      if (chemistry->bondEvents->getDropped() > 0)
+      {
+         fprintf(stderr, "Bond events dropped: %d\n", chemistry->bondEvents->getDropped());
+      }
+      fclose(BondEventFp);
+      BondEventFp = NULL;
+   }
+
+   // Close replay.
+   if (Replay != NULL)
+   {
+      delete Replay;
+      Replay = NULL;
+      fclose(ReplayFp);
+      ReplayFp = NULL;
+   }
+
+   // Close trajectory.
+   if (Trajectory != NULL)
+   {
+      delete Trajectory;
+      Trajectory = NULL;
+      fclose(TrajectoryFp);
+      TrajectoryFp = NULL;
+   }
+
+   // Write reaction network.
+   if (ReactionFile != NULL)
+   {
+      if ((fp = fopen(ReactionFile, "w")) == NULL)
+      {
+         fprintf(stderr, "Cannot write reaction network to file %s\n", ReactionFile);
+         exit(1);
+      }
+      chemistry->reactionNetwork->print(fp);
+      fclose(fp);
+   }
+
+   // Write molecule recipes.
+   if (RecipeFile != NULL)
+   {
+      if ((fp = fopen(RecipeFile, "w")) == NULL)
+      {
+         fprintf(stderr, "Cannot write recipes to file %s\n", RecipeFile);
+         exit(1);
+      }
+      RecipeBook recipeBook;
+      chemistry->generateMolecules();
+      for (i = 0, j = (int)chemistry->molecules.size(); i < j; i++)
+      {
+         recipeBook.getRecipe(chemistry->molecules[i]);
+      }
+      recipeBook.save(fp);
+      fclose(fp);
+   }
+
    // Release storage.
    delete chemistry;
    chemistry = NULL;
@@ -1683,6 +2019,7 @@ int main(int argc, char *argv[])
 #endif
    struct ThermalBody thermal;
    char *s1, *s2, *dumpFile;
+   float minimizeTolerance;
 
 #ifdef WIN32
    // Direct stdio to parent console.
@@ -1701,6 +2038,7 @@ int main(int argc, char *argv[])
 #ifdef THREADS
    gotNumThreads = false;
 #endif
+   minimizeTolerance = 0.0f;
    for (i = 1; i < argc; i++)
    {
       if (strcmp(argv[i], "-cycles") == 0)
@@ -1756,6 +2094,92 @@ int main(int argc, char *argv[])
       }
 #endif
 
+      if (strcmp(argv[i], "-bondCadence") == 0)
+      {
+         i++;
+         if (i >= argc)
+         {
+            printUsage();
+            exit(1);
+         }
+         if ((BondCadence = atoi(argv[i])) < 1)
+         {
+            printUsage();
+            exit(1);
+         }
+         continue;
+      }
+
+      if (strcmp(argv[i], "-formulaStats") == 0)
+      {
+         FormulaStats = true;
+         continue;
+      }
+
+      if (strcmp(argv[i], "-motif") == 0)
+      {
+         i++;
+         if (i >= argc)
+         {
+            printUsage();
+            exit(1);
+         }
+         Motif *motif = Motif::parse(argv[i]);
+         if (motif == NULL)
+         {
+            fprintf(stderr, "Invalid motif %s\n", argv[i]);
+            printUsage();
+            exit(1);
+         }
+         delete motif;
+         Motifs.push_back(argv[i]);
+         continue;
+      }
+
+      if (strcmp(argv[i], "-minimize") == 0)
+      {
+         i++;
+         if (i >= argc)
+         {
+            printUsage();
+            exit(1);
+         }
+         if ((minimizeTolerance = (float)atof(argv[i])) <= 0.0f)
+         {
+            printUsage();
+            exit(1);
+         }
+         continue;
+      }
+
+      if (strcmp(argv[i], "-adaptiveStep") == 0)
+      {
+         i++;
+         if (i >= argc)
+         {
+            printUsage();
+            exit(1);
+         }
+         s1 = argv[i];
+         s2 = strpbrk(s1, ",");
+         if (s2 == NULL)
+         {
+            printUsage();
+            exit(1);
+         }
+         *s2           = '\0';
+         MinUpdateStep = (float)atof(s1);
+         *s2           = ',';
+         MaxUpdateStep = (float)atof(s2 + 1);
+         if ((MinUpdateStep <= 0.0f) || (MaxUpdateStep < MinUpdateStep))
+         {
+            fprintf(stderr, "Invalid adaptive step bounds\n");
+            printUsage();
+            exit(1);
+         }
+         continue;
+      }
+
       if (strcmp(argv[i], "-vesselRadius") == 0)
       {
          i++;
@@ -1908,6 +2332,110 @@ int main(int argc, char *argv[])
          continue;
       }
 
+      if (strcmp(argv[i], "-bondEvents") == 0)
+      {
+         i++;
+         if (i >= argc)
+         {
+            printUsage();
+            exit(1);
+         }
+         BondEventFile = argv[i];
+         continue;
+      }
+
+      if (strcmp(argv[i], "-reactions") == 0)
+      {
+         i++;
+         if (i >= argc)
+         {
+            printUsage();
+            exit(1);
+         }
+         ReactionFile = argv[i];
+         continue;
+      }
+
+      if (strcmp(argv[i], "-trajectory") == 0)
+      {
+         i++;
+         if (i >= argc)
+         {
+            printUsage();
+            exit(1);
+         }
+         TrajectoryFile = argv[i];
+         continue;
+      }
+
+      if (strcmp(argv[i], "-trajectoryFreq") == 0)
+      {
+         i++;
+         if (i >= argc)
+         {
+            printUsage();
+            exit(1);
+         }
+         if ((TrajectoryFreq = atoi(argv[i])) < 1)
+         {
+            printUsage();
+            exit(1);
+         }
+         continue;
+      }
+
+      if (strcmp(argv[i], "-trajectoryPrecision") == 0)
+      {
+         i++;
+         if (i >= argc)
+         {
+            printUsage();
+            exit(1);
+         }
+         if ((TrajectoryPrecision = (float)atof(argv[i])) <= 0.0f)
+         {
+            printUsage();
+            exit(1);
+         }
+         continue;
+      }
+
+      if (strcmp(argv[i], "-replay") == 0)
+      {
+         i++;
+         if (i >= argc)
+         {
+            printUsage();
+            exit(1);
+         }
+         ReplayFile = argv[i];
+         continue;
+      }
+
+      if (strcmp(argv[i], "-recipes") == 0)
+      {
+         i++;
+         if (i >= argc)
+         {
+            printUsage();
+            exit(1);
+         }
+         RecipeFile = argv[i];
+         continue;
+      }
+
+      if (strcmp(argv[i], "-seedRecipes") == 0)
+      {
+         i++;
+         if (i >= argc)
+         {
+            printUsage();
+            exit(1);
+         }
+         SeedRecipeFile = argv[i];
+         continue;
+      }
+
       if (strcmp(argv[i], "-statsFreq") == 0)
       {
          i++;
@@ -1943,6 +2471,18 @@ int main(int argc, char *argv[])
       exit(1);
    }
 
+   if ((ReplayFile != NULL) &&
+       (!Graphics || (LoadFile != NULL) || gotNumAtoms || gotVesselRadius ||
+        gotNumThermals || (Cycles >= 0) || (SaveFile != NULL) || dump ||
+        (TrajectoryFile != NULL) || (BondEventFile != NULL) ||
+        (ReactionFile != NULL) || (RecipeFile != NULL) || (SeedRecipeFile != NULL) ||
+        (minimizeTolerance > 0.0f)))
+   {
+      fprintf(stderr, "Replay only views a trajectory\n");
+      printUsage();
+      exit(1);
+   }
+
    for (i = 0, j = (int)Thermals.size(); i < j; i++)
    {
       if ((Thermals[i].position.Magnitude() - Thermals[i].radius) > VesselRadius)
@@ -1956,10 +2496,23 @@ int main(int argc, char *argv[])
    // Initialize.
    initChemistry();
 
+   // Relax initial state?
+   if (minimizeTolerance > 0.0f)
+   {
+      chemistry->minimize(minimizeTolerance);
+   }
+
+   // Record initial trajectory frame.
+   if (Trajectory != NULL)
+   {
+      Trajectory->record(chemistry);
+   }
+
    // Dump molecules?
    if (dump)
    {
       chemistry->generateMolecules();
+      chemistry->codeMolecules();
       FILE *fp;
       if (strcmp(dumpFile, "-") == 0)
       {
@@ -1974,9 +2527,11 @@ int main(int argc, char *argv[])
          }
       }
       fprintf(fp, "Molecules:\n");
-      for (i = 0, j = (int)chemistry->molecules.size(); i < j; i++)
+      vector<Molecule *> molecules = chemistry->molecules;
+      sort(molecules.begin(), molecules.end(), Molecule::ltcmpMolecules);
+      for (i = 0, j = (int)molecules.size(); i < j; i++)
       {
-         chemistry->molecules[i]->print(fp);
+         molecules[i]->print(fp);
       }
       if (fp != stdout)
       {
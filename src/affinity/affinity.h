@@ -24,6 +24,10 @@ Affinity chemistry driver.
 #define __AFFINITY__
 
 #include "../chemistry/chemistry.hpp"
+#include "../chemistry/census.hpp"
+#include "../chemistry/reaction.hpp"
+#include "../chemistry/statsService.hpp"
+#include "../chemistry/trajectory.hpp"
 using namespace affinity;
 
 // Chemistry.
@@ -33,6 +37,24 @@ extern int NumAtoms;
 extern float VesselRadius;
 extern Chemistry *chemistry;
 
+// Updates between bonding pair searches.
+#define DEFAULT_BOND_CADENCE 1
+extern int BondCadence;
+
+// Molecule species by formula only.
+extern bool FormulaStats;
+
+// Background molecule statistics.
+extern StatsService *MoleculeStatsService;
+
+// Molecular motifs to count.
+extern vector<char *> Motifs;
+void addMotifs(Chemistry *chemistry);
+
+// Adaptive update step bounds (0=fixed step).
+extern float MinUpdateStep;
+extern float MaxUpdateStep;
+
 #ifdef THREADS
 // Threads.
 #define DEFAULT_NUM_THREADS 1
@@ -60,12 +82,35 @@ extern Random *Randomizer;
 extern char *SaveFile;
 extern char *LoadFile;
 
+// Bond event log file (binary records).
+extern char *BondEventFile;
+extern FILE *BondEventFp;
+
+// Reaction network file.
+extern char *ReactionFile;
+
+// Trajectory file, frame frequency and position precision.
+extern char             *TrajectoryFile;
+extern FILE             *TrajectoryFp;
+extern int              TrajectoryFreq;
+extern float            TrajectoryPrecision;
+extern TrajectoryWriter *Trajectory;
+
+// Trajectory replay (graphics only): frames advanced per step.
+#define MAX_REPLAY_SPEED 100
+extern char             *ReplayFile;
+extern TrajectoryReader *Replay;
+extern int              ReplayFrame;
+extern int              ReplaySpeed;
+void replayChemistry(int frameNum);
+
 // Window size.
 #define WINDOW_WIDTH 850
 #define WINDOW_HEIGHT 600
 
 // Initialize, run, and terminate.
 void initChemistry();
+void updateChemistry();
 void runChemistry();
 void termChemistry();
 
@@ -20,9 +20,12 @@
 
 #ifdef WIN32
 #include <windows.h>
+#include <io.h>
 #endif
 #ifdef UNIX
 #include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
 #endif
 #include "affinity.h"
 #include "../utility/log.hpp"
@@ -37,6 +40,12 @@ char *Usage[] =
 #ifdef THREADS
    (char *)"      [-numThreads <number of threads (default=1)>]",
 #endif
+   (char *)"      [-bondCadence <updates between bonding pair searches (default=1)>]",
+   (char *)"      [-adaptiveStep <minimum update step>,<maximum update step>]",
+   (char *)"      [-formulaStats (molecule types by formula only)]",
+   (char *)"      [-motif <name>[=<atomic numbers>/<bonds>[!]] (fitness motif; multiple option)]",
+   (char *)"      [-censusFreq <cycles between fitness samples (0=final state only, default)>]",
+   (char *)"      [-censusFitness <final | mean | auc | stability> (sampled fitness aggregate, default=mean)]",
    (char *)"      [-input <evolution input file name> (for run continuation)]",
    (char *)"      -output <evolution output file name>",
    (char *)"      [-randomSeed <random seed> (for new run)]",
@@ -147,6 +156,36 @@ char *OutputFileName;
 bool Unpack;
 char *UnpackPrefix;
 
+// Fitness census: cycles between samples (0=final state only)
+// and the aggregate of the sampled fitness time series.
+int               CensusFreq    = 0;
+Census::AGGREGATE CensusFitness = Census::MEAN;
+
+// Population checkpoint file: header, random state (RAND_N words),
+// then for each member its record followed by its chemistry snapshot.
+// Files without the checkpoint magic are in the original population
+// format: random seed, random state, then member chemistries.
+#define CHECKPOINT_MAGIC         "AFEV"
+#define CHECKPOINT_VERSION       1
+#define CHECKPOINT_BYTE_ORDER    0x01020304
+
+struct CheckpointHeader
+{
+   char               magic[4];
+   int                version;
+   unsigned int       byteOrder;
+   int                numMembers;
+   unsigned long long randomSeed;
+   int                randomIndex;
+   int                reserved;
+};
+
+struct CheckpointMember
+{
+   float fitness;
+   int   generation;
+};
+
 // Population member.
 class Member
 {
@@ -291,51 +330,57 @@ public:
 
 
    // Evaluate.
+   // With a census, fitness aggregates the scores of samples taken
+   // every CensusFreq cycles; otherwise the final state is scored.
    void evaluate()
    {
+      chemistry->bondCadence = BondCadence;
+      chemistry->setSpeciesByFormula(FormulaStats);
+      addMotifs(chemistry);
+      if (MaxUpdateStep > 0.0f)
+      {
+         chemistry->minUpdateStep = MinUpdateStep;
+         chemistry->maxUpdateStep = MaxUpdateStep;
+      }
+      Census census(CensusFreq > 0 ? CensusFreq : Census::DEFAULT_SAMPLE_FREQ);
       for (int i = 0; i < Cycles; i++)
       {
          chemistry->update();
+         if (CensusFreq > 0)
+         {
+            census.sample(chemistry);
+         }
       }
       fitness = 0.0f;
 
-#if (O2_MOLECULES)
-      // Count O2 molecules.
-      int o2 = chemistry->countO2();
-      if (o2 > 0)
+      if (CensusFreq > 0)
       {
-         fitness += 100.0f + (float)(o2 - 1);
-      }
+         // Score census samples.
+         vector<float> scores;
+         census.sample(chemistry, true);
+         for (int i = 0, j = (int)census.stats.size(); i < j; i++)
+         {
+            scores.push_back(getMotifScore(census.motifCounts[i]));
+#if (ORGANIC_MOLECULES)
+            scores[i] += getStatsScore(census.stats[i]);
 #endif
-
-#if (H2O_MOLECULES)
-      // Count H2O molecules.
-      int h2o = chemistry->countH2O();
-      if (h2o > 0)
-      {
-         fitness += 100.0f + (float)(h2o - 1);
+         }
+         fitness = census.aggregate(scores, CensusFitness);
       }
-#endif
-
-#if (CO2_MOLECULES)
-      // Count CO2 molecules.
-      int co2 = chemistry->countCO2();
-      if (co2 > 0)
+      else
       {
-         fitness += 100.0f + (float)(co2 - 1);
+         // Count motifs.
+         vector<int> motifCounts;
+         for (int i = 0, j = (int)chemistry->motifIndex->motifs.size(); i < j; i++)
+         {
+            motifCounts.push_back(chemistry->motifIndex->motifs[i]->getCount());
+         }
+         fitness = getMotifScore(motifCounts);
       }
-#endif
 
 #if (ORGANIC_MOLECULES)
-      int   num, numClosed, numTypes, numClosedTypes;
-      float aveSize, aveClosedSize;
-      chemistry->getMoleculeStats(num, numClosed, numTypes,
-                                  numClosedTypes, aveSize, aveClosedSize);
-      if (numClosed > 0)
-      {
-         fitness = ((float)numClosed * aveClosedSize) /
-                   (float)numClosedTypes;
-      }
+      // Without a census, fitness is set from molecule statistics
+      // computed in background.
 #endif
 
 #if (!H2O_MOLECULES && !O2_MOLECULES && !CO2_MOLECULES && !ORGANIC_MOLECULES)
@@ -373,6 +418,44 @@ public:
    }
 
 
+   // Score motif counts.
+   float getMotifScore(vector<int>& motifCounts)
+   {
+      float score = 0.0f;
+
+      for (int i = 0, j = (int)motifCounts.size(); i < j; i++)
+      {
+         if (motifCounts[i] > 0)
+         {
+            score += 100.0f + (float)(motifCounts[i] - 1);
+         }
+      }
+      return(score);
+   }
+
+
+#if (ORGANIC_MOLECULES)
+   // Score molecule statistics.
+   float getStatsScore(MoleculeStats& stats)
+   {
+      if (stats.numClosed > 0)
+      {
+         return(((float)stats.numClosed * stats.aveClosedSize) /
+                (float)stats.numClosedTypes);
+      }
+      return(0.0f);
+   }
+
+
+   // Set fitness from molecule statistics.
+   // Motif fitness from evaluate is kept.
+   void setFitness(MoleculeStats& stats)
+   {
+      fitness += getStatsScore(stats);
+   }
+#endif
+
+
    // Create mutation of member.
    void mutate(Member *member)
    {
@@ -1002,13 +1085,45 @@ public:
    }
 
 
-   // Save.
-   void save(FILE *fp)
+   // Load from checkpoint.
+   void loadCheckpoint(FILE *fp)
    {
+      CheckpointMember record;
+
+      if (fread(&record, sizeof(record), 1, fp) != 1)
+      {
+         sprintf(Log::messageBuf, "Cannot read checkpoint member");
+         Log::logError();
+         exit(1);
+      }
+      if (chemistry == NULL)
+      {
+#ifdef THREADS
+         chemistry = new Chemistry(DEFAULT_VESSEL_RADIUS, (RANDOM)0, NumThreads);
+#else
+         chemistry = new Chemistry(DEFAULT_VESSEL_RADIUS, (RANDOM)0);
+#endif
+         assert(chemistry != NULL);
+      }
+      chemistry->load(fp);
+      fitness    = record.fitness;
+      generation = record.generation;
+   }
+
+
+   // Save to checkpoint buffer.
+   void save(vector<char>& buffer)
+   {
+      CheckpointMember record;
+      int              base;
+
       assert(chemistry != NULL);
-      chemistry->save(fp);
-      FWRITE_FLOAT(&fitness, fp);
-      FWRITE_INT(&generation, fp);
+      record.fitness    = fitness;
+      record.generation = generation;
+      base = (int)buffer.size();
+      buffer.resize(base + sizeof(record));
+      memcpy(&buffer[base], &record, sizeof(record));
+      chemistry->save(buffer);
    }
 
 
@@ -1079,10 +1194,239 @@ public:
 // Population.
 Member *Population[POPULATION_SIZE];
 
+// Population checkpoint writer.
+// The population is captured in memory and written by a worker thread
+// to a temporary file, which is synced and renamed over the output
+// file. Evolution continues during the write, and the output file is
+// always a complete checkpoint.
+class Checkpoint
+{
+public:
+
+   // Constructor.
+   Checkpoint(char *fileName)
+   {
+      this->fileName = fileName;
+      tempName       = new char[strlen(fileName) + 5];
+      assert(tempName != NULL);
+      sprintf(tempName, "%s.tmp", fileName);
+      busy = failed = false;
+#ifdef THREADS
+      terminate = false;
+      if (pthread_mutex_init(&mutex, NULL) != 0)
+      {
+         fprintf(stderr, "pthread_mutex_init failed, errno=%d\n", errno);
+         exit(1);
+      }
+      if (pthread_cond_init(&cond, NULL) != 0)
+      {
+         fprintf(stderr, "pthread_cond_init failed, errno=%d\n", errno);
+         exit(1);
+      }
+      if (pthread_create(&thread, NULL, run, (void *)this) != 0)
+      {
+         fprintf(stderr, "pthread_create failed, errno=%d\n", errno);
+         exit(1);
+      }
+#endif
+   }
+
+
+   // Destructor: finishes pending write.
+   ~Checkpoint()
+   {
+      wait();
+#ifdef THREADS
+      pthread_mutex_lock(&mutex);
+      terminate = true;
+      pthread_cond_broadcast(&cond);
+      pthread_mutex_unlock(&mutex);
+      pthread_join(thread, NULL);
+      pthread_cond_destroy(&cond);
+      pthread_mutex_destroy(&mutex);
+#endif
+      delete [] tempName;
+   }
+
+
+   // Capture population and write it.
+   // Waits for the previous write to finish.
+   void save()
+   {
+      int              i;
+      CheckpointHeader header;
+      unsigned int     randomState[RAND_N];
+
+      wait();
+      memset(&header, 0, sizeof(header));
+      memcpy(header.magic, CHECKPOINT_MAGIC, 4);
+      header.version    = CHECKPOINT_VERSION;
+      header.byteOrder  = CHECKPOINT_BYTE_ORDER;
+      header.numMembers = POPULATION_SIZE;
+      header.randomSeed = (unsigned long long)RandomSeed;
+      Randomizer->RAND_GET_STATE(randomState, header.randomIndex);
+      buffer.resize(sizeof(header) + sizeof(randomState));
+      memcpy(&buffer[0], &header, sizeof(header));
+      memcpy(&buffer[sizeof(header)], randomState, sizeof(randomState));
+      for (i = 0; i < POPULATION_SIZE; i++)
+      {
+         Population[i]->save(buffer);
+      }
+#ifdef THREADS
+      pthread_mutex_lock(&mutex);
+      busy = true;
+      pthread_cond_broadcast(&cond);
+      pthread_mutex_unlock(&mutex);
+#else
+      failed = !write();
+#endif
+   }
+
+
+   // Wait for pending write to finish.
+   void wait()
+   {
+#ifdef THREADS
+      pthread_mutex_lock(&mutex);
+      while (busy)
+      {
+         pthread_cond_wait(&cond, &mutex);
+      }
+      pthread_mutex_unlock(&mutex);
+#endif
+      if (failed)
+      {
+         sprintf(Log::messageBuf, "Cannot save to population file %s", fileName);
+         Log::logError();
+         exit(1);
+      }
+   }
+
+
+private:
+
+   char         *fileName;
+   char         *tempName;
+   vector<char> buffer;
+   bool         busy;
+   bool         failed;
+
+   // Write buffer to temporary file, sync it, and rename it over the file.
+   bool write()
+   {
+      FILE *fp;
+      bool result;
+
+#ifdef UNIX
+      char *dirName, *s;
+      int  fd;
+#endif
+
+      if ((fp = fopen(tempName, "wb")) == NULL)
+      {
+         return(false);
+      }
+      result = (fwrite(&buffer[0], buffer.size(), 1, fp) == 1);
+      if (fflush(fp) != 0)
+      {
+         result = false;
+      }
+#ifdef UNIX
+      if (fsync(fileno(fp)) != 0)
+      {
+         result = false;
+      }
+#endif
+#ifdef WIN32
+      if (_commit(_fileno(fp)) != 0)
+      {
+         result = false;
+      }
+#endif
+      if (fclose(fp) != 0)
+      {
+         result = false;
+      }
+      if (!result)
+      {
+         remove(tempName);
+         return(false);
+      }
+#ifdef WIN32
+      if (!MoveFileExA(tempName, fileName, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH))
+      {
+         return(false);
+      }
+#else
+      if (rename(tempName, fileName) != 0)
+      {
+         return(false);
+      }
+#endif
+#ifdef UNIX
+      // Sync directory to persist the rename.
+      dirName = new char[strlen(fileName) + 2];
+      assert(dirName != NULL);
+      strcpy(dirName, fileName);
+      if ((s = strrchr(dirName, '/')) != NULL)
+      {
+         s[1] = '\0';
+      }
+      else
+      {
+         strcpy(dirName, ".");
+      }
+      if ((fd = open(dirName, O_RDONLY)) >= 0)
+      {
+         fsync(fd);
+         close(fd);
+      }
+      delete [] dirName;
+#endif
+      return(true);
+   }
+
+
+#ifdef THREADS
+   pthread_t       thread;
+   pthread_mutex_t mutex;
+   pthread_cond_t  cond;
+   bool            terminate;
+
+   // Worker thread.
+   static void *run(void *arg)
+   {
+      Checkpoint *checkpoint = (Checkpoint *)arg;
+      bool       result;
+
+      pthread_mutex_lock(&checkpoint->mutex);
+      while (true)
+      {
+         while (!checkpoint->busy && !checkpoint->terminate)
+         {
+            pthread_cond_wait(&checkpoint->cond, &checkpoint->mutex);
+         }
+         if (checkpoint->terminate)
+         {
+            break;
+         }
+         pthread_mutex_unlock(&checkpoint->mutex);
+         result = checkpoint->write();
+         pthread_mutex_lock(&checkpoint->mutex);
+         checkpoint->failed = !result;
+         checkpoint->busy   = false;
+         pthread_cond_broadcast(&checkpoint->cond);
+      }
+      pthread_mutex_unlock(&checkpoint->mutex);
+      return(NULL);
+   }
+#endif
+};
+
 // Start/end functions.
 void logParameters();
-void loadPopulation(FILE *fp);
-void savePopulation(FILE *fp);
+bool loadRandomizer(FILE *fp);
+void loadPopulation(FILE *fp, bool checkpoint);
 
 // Evolve functions.
 void evolve(), evaluate(), prune(), mutate(), mate();
@@ -1090,9 +1434,10 @@ void evolve(), evaluate(), prune(), mutate(), mate();
 int
 main(int argc, char *argv[])
 {
-   int  i;
-   FILE *fp;
-   bool gotlogopt, gotprefix;
+   int        i;
+   FILE       *fp;
+   bool       gotlogopt, gotprefix, checkpointed;
+   Checkpoint *checkpoint;
 
    // Logging.
    Log::LOGGING_FLAG = EVOLVE_LOGGING;
@@ -1159,6 +1504,105 @@ main(int argc, char *argv[])
       }
 #endif
 
+      if (strcmp(argv[i], "-bondCadence") == 0)
+      {
+         i++;
+         if (i >= argc)
+         {
+            printUsage();
+            exit(1);
+         }
+         if ((BondCadence = atoi(argv[i])) < 1)
+         {
+            printUsage();
+            exit(1);
+         }
+         continue;
+      }
+
+      if (strcmp(argv[i], "-formulaStats") == 0)
+      {
+         FormulaStats = true;
+         continue;
+      }
+
+      if (strcmp(argv[i], "-motif") == 0)
+      {
+         i++;
+         if (i >= argc)
+         {
+            printUsage();
+            exit(1);
+         }
+         Motif *motif = Motif::parse(argv[i]);
+         if (motif == NULL)
+         {
+            printUsage();
+            exit(1);
+         }
+         delete motif;
+         Motifs.push_back(argv[i]);
+         continue;
+      }
+
+      if (strcmp(argv[i], "-censusFreq") == 0)
+      {
+         i++;
+         if (i >= argc)
+         {
+            printUsage();
+            exit(1);
+         }
+         if ((CensusFreq = atoi(argv[i])) < 0)
+         {
+            printUsage();
+            exit(1);
+         }
+         continue;
+      }
+
+      if (strcmp(argv[i], "-censusFitness") == 0)
+      {
+         i++;
+         if (i >= argc)
+         {
+            printUsage();
+            exit(1);
+         }
+         if (!Census::getAggregate(argv[i], CensusFitness))
+         {
+            printUsage();
+            exit(1);
+         }
+         continue;
+      }
+
+      if (strcmp(argv[i], "-adaptiveStep") == 0)
+      {
+         i++;
+         if (i >= argc)
+         {
+            printUsage();
+            exit(1);
+         }
+         char *s = strpbrk(argv[i], ",");
+         if (s == NULL)
+         {
+            printUsage();
+            exit(1);
+         }
+         *s            = '\0';
+         MinUpdateStep = (float)atof(argv[i]);
+         *s            = ',';
+         MaxUpdateStep = (float)atof(s + 1);
+         if ((MinUpdateStep <= 0.0f) || (MaxUpdateStep < MinUpdateStep))
+         {
+            printUsage();
+            exit(1);
+         }
+         continue;
+      }
+
       if (strcmp(argv[i], "-input") == 0)
       {
          i++;
@@ -1257,20 +1701,18 @@ main(int argc, char *argv[])
          printUsage();
          exit(1);
       }
-      if ((fp = fopen(InputFileName, "r")) == NULL)
+      if ((fp = fopen(InputFileName, "rb")) == NULL)
       {
          sprintf(Log::messageBuf, "Cannot load population file %s", InputFileName);
          Log::logError();
          exit(1);
       }
-      FREAD_LONG(&RandomSeed, fp);
-      Randomizer = new Random(RandomSeed);
-      assert(Randomizer != NULL);
-      Randomizer->RAND_LOAD(fp);
+      checkpointed = loadRandomizer(fp);
    }
    else
    {
-      fp = NULL;
+      fp           = NULL;
+      checkpointed = false;
       if (RandomSeed == INVALID_RANDOM)
       {
          RandomSeed = (RANDOM)time(NULL);
@@ -1308,7 +1750,7 @@ main(int argc, char *argv[])
    else
    {
       // Continue run.
-      loadPopulation(fp);
+      loadPopulation(fp, checkpointed);
       fclose(fp);
    }
 
@@ -1322,7 +1764,7 @@ main(int argc, char *argv[])
       for (int i = 0; i < POPULATION_SIZE; i++)
       {
          sprintf(fileName, "%s%d.chem", UnpackPrefix, i);
-         if ((fp = fopen(fileName, "w")) == NULL)
+         if ((fp = fopen(fileName, "wb")) == NULL)
          {
             fprintf(stderr, "Cannot save to file %s\n", fileName);
             exit(1);
@@ -1342,9 +1784,6 @@ main(int argc, char *argv[])
          b = false;
          FWRITE_BOOL(&b, fp);
          FWRITE_BOOL(&b, fp);
-         w = -1;
-         FWRITE_INT(&w, fp);
-         FWRITE_INT(&w, fp);
          Population[i]->chemistry->save(fp);
          fclose(fp);
       }
@@ -1352,6 +1791,8 @@ main(int argc, char *argv[])
    else
    {
       // Evolution loop.
+      checkpoint = new Checkpoint(OutputFileName);
+      assert(checkpoint != NULL);
       Log::logInformation((char *)"Begin evolve:");
       for (i = 0; i < Generations; i++)
       {
@@ -1359,33 +1800,16 @@ main(int argc, char *argv[])
          Log::logInformation();
          evolve();
 
-         // Save population?
+         // Checkpoint population?
          if ((i % SAVE_FREQUENCY) == 0)
          {
-            if ((fp = fopen(OutputFileName, "w")) == NULL)
-            {
-               sprintf(Log::messageBuf, "Cannot save to population file %s", OutputFileName);
-               Log::logError();
-               exit(1);
-            }
-            FWRITE_LONG(&RandomSeed, fp);
-            Randomizer->RAND_SAVE(fp);
-            savePopulation(fp);
-            fclose(fp);
+            checkpoint->save();
          }
       }
 
-      // Save population.
-      if ((fp = fopen(OutputFileName, "w")) == NULL)
-      {
-         sprintf(Log::messageBuf, "Cannot save to population file %s", OutputFileName);
-         Log::logError();
-         exit(1);
-      }
-      FWRITE_LONG(&RandomSeed, fp);
-      Randomizer->RAND_SAVE(fp);
-      savePopulation(fp);
-      fclose(fp);
+      // Save population and wait for write.
+      checkpoint->save();
+      delete checkpoint;
    }
 
    // Release memory.
@@ -1423,6 +1847,10 @@ void logParameters()
    Log::logInformation();
    sprintf(Log::messageBuf, "CYCLES = %d", Cycles);
    Log::logInformation();
+   sprintf(Log::messageBuf, "CENSUS_FREQ = %d", CensusFreq);
+   Log::logInformation();
+   sprintf(Log::messageBuf, "CENSUS_FITNESS = %s", Census::getAggregateName(CensusFitness));
+   Log::logInformation();
    Log::logInformation((char *)"Evolvable Parameters:");
    sprintf(Log::messageBuf, "MIN_VESSEL_RADIUS = %f", MIN_VESSEL_RADIUS);
    Log::logInformation();
@@ -1531,24 +1959,57 @@ void logParameters()
 }
 
 
-// Load evolution population.
-void loadPopulation(FILE *fp)
+// Load random seed and state from population file.
+// Returns true if the file is a checkpoint.
+bool loadRandomizer(FILE *fp)
 {
-   for (int i = 0; i < POPULATION_SIZE; i++)
+   CheckpointHeader header;
+   unsigned int     randomState[RAND_N];
+
+   if ((fread(&header, sizeof(header), 1, fp) == 1) &&
+       (memcmp(header.magic, CHECKPOINT_MAGIC, 4) == 0))
    {
-      Population[i] = new Member();
-      assert(Population[i] != NULL);
-      Population[i]->load(fp);
+      if ((header.version != CHECKPOINT_VERSION) ||
+          (header.byteOrder != CHECKPOINT_BYTE_ORDER) ||
+          (header.numMembers != POPULATION_SIZE) ||
+          (fread(randomState, sizeof(randomState), 1, fp) != 1))
+      {
+         sprintf(Log::messageBuf, "Invalid checkpoint in population file %s", InputFileName);
+         Log::logError();
+         exit(1);
+      }
+      RandomSeed = (RANDOM)header.randomSeed;
+      Randomizer = new Random(RandomSeed);
+      assert(Randomizer != NULL);
+      Randomizer->RAND_SET_STATE(randomState, header.randomIndex);
+      return(true);
    }
+
+   // Original population format.
+   fseek(fp, 0, SEEK_SET);
+   FREAD_LONG(&RandomSeed, fp);
+   Randomizer = new Random(RandomSeed);
+   assert(Randomizer != NULL);
+   Randomizer->RAND_LOAD(fp);
+   return(false);
 }
 
 
-// Save evolution population.
-void savePopulation(FILE *fp)
+// Load evolution population.
+void loadPopulation(FILE *fp, bool checkpoint)
 {
    for (int i = 0; i < POPULATION_SIZE; i++)
    {
-      Population[i]->save(fp);
+      Population[i] = new Member();
+      assert(Population[i] != NULL);
+      if (checkpoint)
+      {
+         Population[i]->loadCheckpoint(fp);
+      }
+      else
+      {
+         Population[i]->load(fp);
+      }
    }
 }
 
@@ -1575,6 +2036,39 @@ void evaluate()
 {
    Log::logInformation((char *)"Evaluate:");
 
+#if (ORGANIC_MOLECULES)
+   // Compute statistics of each member in background while the next runs,
+   // unless members sample their own census.
+   if (CensusFreq == 0)
+   {
+      MoleculeStats stats;
+      if (MoleculeStatsService == NULL)
+      {
+         MoleculeStatsService = new StatsService();
+         assert(MoleculeStatsService != NULL);
+      }
+      for (int i = 0; i < POPULATION_SIZE; i++)
+      {
+         Population[i]->evaluate();
+         if (i > 0)
+         {
+            MoleculeStatsService->wait(stats);
+            Population[i - 1]->setFitness(stats);
+            sprintf(Log::messageBuf, "  Member = %d, Fitness = %f, Generation = %d",
+                    i - 1, Population[i - 1]->fitness, Population[i - 1]->generation);
+            Log::logInformation();
+         }
+         MoleculeStatsService->request(Population[i]->chemistry);
+      }
+      MoleculeStatsService->wait(stats);
+      Population[POPULATION_SIZE - 1]->setFitness(stats);
+      sprintf(Log::messageBuf, "  Member = %d, Fitness = %f, Generation = %d",
+              POPULATION_SIZE - 1, Population[POPULATION_SIZE - 1]->fitness,
+              Population[POPULATION_SIZE - 1]->generation);
+      Log::logInformation();
+      return;
+   }
+#endif
    for (int i = 0; i < POPULATION_SIZE; i++)
    {
       Population[i]->evaluate();
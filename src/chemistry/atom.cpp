@@ -42,6 +42,7 @@ Atom::Atom(Parameters *parameters, int id, int protons, Random *randomizer)
    number             = protons;
    nucleus.parameters = parameters;
    nucleus.id         = id;
+   nucleus.element    = number;
    nucleus.mass       = (float)number * parameters->PROTON_MASS;
    nucleus.radius     = parameters->NUCLEUS_BODY_RADIUS;
    nucleus.charge     = parameters->PROTON_CHARGE;
@@ -490,6 +491,7 @@ Atom::Atom(Parameters *parameters, int id, int protons, Random *randomizer)
          b1             = &shells[i].orbitals[j];
          b1->parameters = parameters;
          b1->id         = id;
+         b1->element    = number;
          b1->radius     = parameters->ORBITAL_BODY_RADIUS;
          b1->shell      = i;
          b1->orbital    = j;
@@ -744,6 +746,12 @@ void Atom::updateOrbitalBonds()
 void Atom::getValence(float& out, float& in)
 {
    assert(parameters->MAX_NUCLEUS_PROTONS == 20);
+   getValence(number, out, in);
+}
+
+
+void Atom::getValence(int number, float& out, float& in)
+{
    switch (number)
    {
    case 1:
@@ -1150,6 +1158,7 @@ void Atom::load(FILE *fp)
    nucleus.parameters = parameters;
    generateColor();
    nucleus.load(fp);
+   nucleus.element = number;
    for (i = 0, j = (int)shells.size(); i < j; i++)
    {
       shells[i].orbitals.clear();
@@ -1166,6 +1175,7 @@ void Atom::load(FILE *fp)
       {
          shells[i].orbitals[p].parameters = parameters;
          shells[i].orbitals[p].load(fp);
+         shells[i].orbitals[p].element = number;
       }
    }
 }
@@ -1191,3 +1201,86 @@ void Atom::save(FILE *fp)
       }
    }
 }
+
+
+// Load atom from snapshot records.
+// Records are checked before loading (false=invalid records).
+bool Atom::load(SnapshotAtom& record, SnapshotShell *shellRecords,
+                SnapshotBody *bodyRecords)
+{
+   int          i, j, p, q;
+   SnapshotBody *body;
+
+   if ((record.number < parameters->MIN_NUCLEUS_PROTONS) ||
+       (record.number > parameters->MAX_NUCLEUS_PROTONS) ||
+       (record.numShells < 1) ||
+       (bodyRecords->shell != -1) || (bodyRecords->orbital != -1))
+   {
+      return(false);
+   }
+   for (i = 0, body = bodyRecords + 1; i < record.numShells; i++)
+   {
+      if ((shellRecords[i].number != i) || (shellRecords[i].numOrbitals < 0))
+      {
+         return(false);
+      }
+      for (p = 0; p < shellRecords[i].numOrbitals; p++, body++)
+      {
+         if ((body->id != bodyRecords->id) || (body->shell != i) || (body->orbital != p))
+         {
+            return(false);
+         }
+      }
+   }
+   number             = record.number;
+   nucleus.parameters = parameters;
+   generateColor();
+   nucleus.load(*bodyRecords);
+   bodyRecords++;
+   nucleus.element = number;
+   for (i = 0, j = (int)shells.size(); i < j; i++)
+   {
+      shells[i].orbitals.clear();
+   }
+   shells.clear();
+   shells.resize(record.numShells);
+   for (i = 0, j = (int)shells.size(); i < j; i++)
+   {
+      shells[i].number = shellRecords[i].number;
+      shells[i].orbitals.resize(shellRecords[i].numOrbitals);
+      for (p = 0, q = (int)shells[i].orbitals.size(); p < q; p++)
+      {
+         shells[i].orbitals[p].parameters = parameters;
+         shells[i].orbitals[p].load(*bodyRecords);
+         bodyRecords++;
+         shells[i].orbitals[p].element = number;
+      }
+   }
+   return(true);
+}
+
+
+// Save atom to snapshot records.
+void Atom::save(SnapshotAtom& record, vector<SnapshotShell>& shellRecords,
+                vector<SnapshotBody>& bodyRecords)
+{
+   int           i, j, p, q;
+   SnapshotShell shellRecord;
+   SnapshotBody  bodyRecord;
+
+   record.number    = number;
+   record.numShells = (int)shells.size();
+   nucleus.save(bodyRecord);
+   bodyRecords.push_back(bodyRecord);
+   for (i = 0, j = (int)shells.size(); i < j; i++)
+   {
+      shellRecord.number      = shells[i].number;
+      shellRecord.numOrbitals = (int)shells[i].orbitals.size();
+      shellRecords.push_back(shellRecord);
+      for (p = 0, q = (int)shells[i].orbitals.size(); p < q; p++)
+      {
+         shells[i].orbitals[p].save(bodyRecord);
+         bodyRecords.push_back(bodyRecord);
+      }
+   }
+}
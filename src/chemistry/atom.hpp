@@ -93,6 +93,7 @@ public:
 
    // Get orbital valence.
    void getValence(float& out, float& in);
+   static void getValence(int number, float& out, float& in);
 
    // Generate color.
    void generateColor();
@@ -111,6 +112,13 @@ public:
    // Load and save atom.
    void load(FILE *fp);
    void save(FILE *fp);
+
+   // Load and save atom snapshot records, with its shell
+   // and body records in order. Load rejects invalid records.
+   bool load(SnapshotAtom& record, SnapshotShell *shellRecords,
+             SnapshotBody *bodyRecords);
+   void save(SnapshotAtom& record, vector<SnapshotShell>& shellRecords,
+             vector<SnapshotBody>& bodyRecords);
 };
 }
 #endif
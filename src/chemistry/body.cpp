@@ -27,9 +27,11 @@ Body::Body(Parameters *parameters)
 {
    this->parameters = parameters;
    id           = shell = orbital = -1;
+   element      = 0;
    mass         = radius = charge = valence[0] = valence[1] = 0.0f;
    hasValence   = false;
    covalentBody = NULL;
+   bond         = -1;
 }
 
 
@@ -38,6 +40,7 @@ Body::Body(Parameters *parameters, float mass, float radius, float charge,
 {
    this->parameters = parameters;
    id               = shell = orbital = -1;
+   element          = 0;
    this->mass       = mass;
    this->radius     = radius;
    this->charge     = charge;
@@ -45,6 +48,7 @@ Body::Body(Parameters *parameters, float mass, float radius, float charge,
    this->valence[1] = valence[1];
    this->hasValence = hasValence;
    covalentBody     = NULL;
+   bond             = -1;
    this->position   = position;
    this->velocity   = velocity;
 }
@@ -79,9 +83,10 @@ void Body::setVelocity(Vector& velocity)
 
 
 // Update body.
+// Forces are impulses over UPDATE_STEP, scaled to given step.
 void Body::update(float step)
 {
-   velocity += forces / mass;
+   velocity += (forces / mass) * (step / parameters->UPDATE_STEP);
    if (velocity.Magnitude() > parameters->MAX_TEMPERATURE)
    {
       velocity.Normalize(parameters->MAX_TEMPERATURE);
@@ -92,6 +97,7 @@ void Body::update(float step)
 
 
 // Get covalent bonding force with other body.
+// Valence depends only on the element, so look up the element pair.
 float Body::getCovalentForce(Body *body)
 {
    if (!hasValence || !body->hasValence)
@@ -102,9 +108,8 @@ float Body::getCovalentForce(Body *body)
    return(min(valence[0], body->valence[1]) +
           min(body->valence[0], valence[1]));
 #endif
-   return(((fabs((float)valence[0] - (float)body->valence[0]) +
-            fabs((float)valence[1] - (float)body->valence[1])) / 2.0f) +
-          parameters->MIN_COVALENT_BOND_FORCE);
+   return(parameters->covalentForces[(element * parameters->covalentForceDimension) +
+                                     body->element]);
 }
 
 
@@ -174,3 +179,45 @@ void Body::save(FILE *fp)
    FWRITE_FLOAT(&velocity.y, fp);
    FWRITE_FLOAT(&velocity.z, fp);
 }
+
+
+// Load body from snapshot record.
+void Body::load(SnapshotBody& record)
+{
+   id         = record.id;
+   shell      = record.shell;
+   orbital    = record.orbital;
+   mass       = record.mass;
+   radius     = record.radius;
+   charge     = record.charge;
+   valence[0] = record.valence[0];
+   valence[1] = record.valence[1];
+   hasValence = (record.hasValence != 0);
+   position.x = record.position[0];
+   position.y = record.position[1];
+   position.z = record.position[2];
+   velocity.x = record.velocity[0];
+   velocity.y = record.velocity[1];
+   velocity.z = record.velocity[2];
+}
+
+
+// Save body to snapshot record.
+void Body::save(SnapshotBody& record)
+{
+   record.id          = id;
+   record.shell       = shell;
+   record.orbital     = orbital;
+   record.mass        = mass;
+   record.radius      = radius;
+   record.charge      = charge;
+   record.valence[0]  = valence[0];
+   record.valence[1]  = valence[1];
+   record.hasValence  = (hasValence ? 1 : 0);
+   record.position[0] = position.x;
+   record.position[1] = position.y;
+   record.position[2] = position.z;
+   record.velocity[0] = velocity.x;
+   record.velocity[1] = velocity.y;
+   record.velocity[2] = velocity.z;
+}
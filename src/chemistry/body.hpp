@@ -42,12 +42,14 @@ public:
    int    id;                                     // atom id
    int    shell;                                  // shell (-1=nucleus)
    int    orbital;                                // orbital (-1=nucleus)
+   int    element;                                // element (atomic number)
    float  mass;                                   // mass
    float  radius;                                 // radius
    float  charge;                                 // charge (+|-)
    float  valence[2];                             // valence (export/import)
    bool   hasValence;                             // has valence?
    Body   *covalentBody;                          // covalent bonded body
+   int    bond;                                   // bond index (-1=none)
    Vector position;                               // position
    Vector velocity;                               // velocity
    Vector forces;                                 // impinging forces
@@ -77,6 +79,8 @@ public:
    // Load and save body.
    void load(FILE *fp);
    void save(FILE *fp);
+   void load(SnapshotBody& record);
+   void save(SnapshotBody& record);
 };
 }
 #endif
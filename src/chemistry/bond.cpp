@@ -0,0 +1,61 @@
+/*
+ * This software is provided under the terms of the GNU General
+ * Public License as published by the Free Software Foundation.
+ *
+ * Copyright (c) 2006-2007 Tom Portegys, All Rights Reserved.
+ * Permission to use, copy, modify, and distribute this software
+ * and its documentation for NON-COMMERCIAL purposes and without
+ * fee is hereby granted provided that this copyright notice
+ * appears in all copies.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.
+ */
+
+
+/*
+ * Covalent bond.
+ */
+
+#include "bond.hpp"
+using namespace affinity;
+
+// Constructor.
+Bond::Bond(Body *body1, Body *body2, float force)
+{
+   this->body1 = body1;
+   this->body2 = body2;
+   this->force = force;
+}
+
+
+// Get bond length.
+float Bond::getLength()
+{
+   Vector x;
+
+   x = body2->position - body1->position;
+   return(x.Magnitude());
+}
+
+
+// Update spring forces.
+void Bond::update()
+{
+   float  d;
+   Vector x, f;
+
+   // Use spring equation.
+   x = body2->position - body1->position;
+   d = x.Magnitude();
+   if (d < tol)
+   {
+      return;
+   }
+   x.Normalize();
+   f = (-force * body1->parameters->COVALENT_BOND_STIFFNESS_SCALE * d * x);
+   body1->forces -= f;
+   body2->forces += f;
+}
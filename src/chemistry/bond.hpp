@@ -0,0 +1,55 @@
+/*
+ * This software is provided under the terms of the GNU General
+ * Public License as published by the Free Software Foundation.
+ *
+ * Copyright (c) 2006-2007 Tom Portegys, All Rights Reserved.
+ * Permission to use, copy, modify, and distribute this software
+ * and its documentation for NON-COMMERCIAL purposes and without
+ * fee is hereby granted provided that this copyright notice
+ * appears in all copies.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.
+ */
+
+
+/*
+ * Covalent bond.
+ */
+
+#ifndef __BOND__
+#define __BOND__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include "parameters.hpp"
+#include "body.hpp"
+#include "../utility/vector.hpp"
+
+namespace affinity
+{
+// Covalent bond between orbital bodies.
+// A bond is a 0-length spring whose stiffness is proportional
+// to the covalent bonding force, cached when the bond forms.
+class Bond
+{
+public:
+
+   Body  *body1;                                  // bonded bodies
+   Body  *body2;
+   float force;                                   // covalent bonding force
+
+   // Constructor.
+   Bond(Body *body1 = NULL, Body *body2 = NULL, float force = 0.0f);
+
+   // Get bond length.
+   float getLength();
+
+   // Update spring forces.
+   void update();
+};
+}
+#endif
@@ -0,0 +1,276 @@
+/*
+ * This software is provided under the terms of the GNU General
+ * Public License as published by the Free Software Foundation.
+ *
+ * Copyright (c) 2006-2007 Tom Portegys, All Rights Reserved.
+ * Permission to use, copy, modify, and distribute this software
+ * and its documentation for NON-COMMERCIAL purposes and without
+ * fee is hereby granted provided that this copyright notice
+ * appears in all copies.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.
+ */
+
+
+
+/*
+ * Bond event log.
+ */
+
+#include "bondEvent.hpp"
+#include <string.h>
+#include <algorithm>
+using namespace affinity;
+
+// Default ring capacity per thread.
+const int BondEventLog::DEFAULT_CAPACITY = 65536;
+
+// Constructors.
+BondEvent::BondEvent()
+{
+   cycle = type = -1;
+   id1   = shell1 = orbital1 = -1;
+   id2   = shell2 = orbital2 = -1;
+   force    = 0.0f;
+   sequence = 0;
+}
+
+
+BondEvent::BondEvent(int cycle, int type, Body *body1, Body *body2, float force)
+{
+   this->cycle = cycle;
+   this->type  = type;
+   id1         = body1->id;
+   shell1      = body1->shell;
+   orbital1    = body1->orbital;
+   id2         = body2->id;
+   shell2      = body2->shell;
+   orbital2    = body2->orbital;
+   this->force = force;
+   sequence    = 0;
+}
+
+
+// Load binary record.
+bool BondEvent::load(FILE *fp)
+{
+   int v[8];
+
+   if (fread(v, sizeof(int), 8, fp) != 8)
+   {
+      return(false);
+   }
+   if (fread(&force, sizeof(float), 1, fp) != 1)
+   {
+      return(false);
+   }
+   cycle    = v[0];
+   type     = v[1];
+   id1      = v[2];
+   shell1   = v[3];
+   orbital1 = v[4];
+   id2      = v[5];
+   shell2   = v[6];
+   orbital2 = v[7];
+   return(true);
+}
+
+
+// Save binary record.
+void BondEvent::save(FILE *fp)
+{
+   int v[8];
+
+   v[0] = cycle;
+   v[1] = type;
+   v[2] = id1;
+   v[3] = shell1;
+   v[4] = orbital1;
+   v[5] = id2;
+   v[6] = shell2;
+   v[7] = orbital2;
+   if ((fwrite(v, sizeof(int), 8, fp) != 8) ||
+       (fwrite(&force, sizeof(float), 1, fp) != 1))
+   {
+      fprintf(stderr, "Cannot write bond event\n");
+      exit(1);
+   }
+}
+
+
+// Load binary file header.
+bool BondEvent::loadHeader(FILE *fp)
+{
+   BondEventHeader header;
+
+   if ((fread(&header, sizeof(header), 1, fp) != 1) ||
+       (memcmp(header.magic, BOND_EVENT_MAGIC, BOND_EVENT_MAGIC_SIZE) != 0) ||
+       (header.byteOrder != BOND_EVENT_BYTE_ORDER) ||
+       (header.version != BOND_EVENT_VERSION) ||
+       (header.headerSize != (int)sizeof(header)))
+   {
+      return(false);
+   }
+   return(true);
+}
+
+
+// Save binary file header.
+void BondEvent::saveHeader(FILE *fp)
+{
+   BondEventHeader header;
+
+   memcpy(header.magic, BOND_EVENT_MAGIC, BOND_EVENT_MAGIC_SIZE);
+   header.version    = BOND_EVENT_VERSION;
+   header.byteOrder  = BOND_EVENT_BYTE_ORDER;
+   header.headerSize = (int)sizeof(header);
+   if (fwrite(&header, sizeof(header), 1, fp) != 1)
+   {
+      fprintf(stderr, "Cannot write bond event header\n");
+      exit(1);
+   }
+}
+
+
+// Print.
+void BondEvent::print(FILE *fp)
+{
+   fprintf(fp, "%d %s %d/%d/%d %d/%d/%d %f\n", cycle,
+           (type == FORM ? "form" : "break"),
+           id1, shell1, orbital1, id2, shell2, orbital2, force);
+}
+
+
+// Compare by cycle and record sequence.
+bool BondEvent::ltcmpEvents(const BondEvent& a, const BondEvent& b)
+{
+   if (a.cycle != b.cycle)
+   {
+      return(a.cycle < b.cycle);
+   }
+   return(a.sequence < b.sequence);
+}
+
+
+// Bond event log constructor.
+// Capacity is rounded up to a power of 2.
+BondEventLog::BondEventLog(int numThreads, int capacity)
+{
+   int i;
+
+   assert(numThreads > 0 && capacity > 0);
+   for (this->capacity = 1; (int)this->capacity < capacity; this->capacity <<= 1)
+   {
+   }
+   numRings = numThreads;
+   rings    = new Ring[numRings];
+   assert(rings != NULL);
+   for (i = 0; i < numRings; i++)
+   {
+      rings[i].events = new BondEvent[this->capacity];
+      assert(rings[i].events != NULL);
+      rings[i].head = 0;
+      rings[i].tail = 0;
+   }
+   sequence = 0;
+   dropped  = 0;
+}
+
+
+// Destructor.
+BondEventLog::~BondEventLog()
+{
+   for (int i = 0; i < numRings; i++)
+   {
+      delete [] rings[i].events;
+   }
+   delete [] rings;
+}
+
+
+// Record event from thread.
+// The sequence orders events across rings: update phases are separated
+// by thread synchronization, so a later phase's events stamp higher.
+bool BondEventLog::record(int threadNum, BondEvent& event)
+{
+   unsigned head, tail;
+   Ring     *ring;
+
+   assert(threadNum >= 0 && threadNum < numRings);
+   ring = &rings[threadNum];
+   tail = ring->tail.load(memory_order_relaxed);
+   head = ring->head.load(memory_order_acquire);
+   if (tail - head >= capacity)
+   {
+      dropped++;
+      return(false);
+   }
+   event.sequence = sequence.fetch_add(1, memory_order_relaxed);
+   ring->events[tail & (capacity - 1)] = event;
+   ring->tail.store(tail + 1, memory_order_release);
+   return(true);
+}
+
+
+// Drain events to memory.
+// Rings are appended in turn and merged by cycle and sequence, so
+// events keep the order in which they were recorded across threads.
+int BondEventLog::drain(vector<BondEvent>& events)
+{
+   int      i, n;
+   unsigned head, tail;
+   Ring     *ring;
+
+   n = (int)events.size();
+   for (i = 0; i < numRings; i++)
+   {
+      ring = &rings[i];
+      head = ring->head.load(memory_order_relaxed);
+      tail = ring->tail.load(memory_order_acquire);
+      for ( ; head != tail; head++)
+      {
+         events.push_back(ring->events[head & (capacity - 1)]);
+      }
+      ring->head.store(head, memory_order_release);
+   }
+   if (numRings > 1)
+   {
+      sort(events.begin() + n, events.end(), BondEvent::ltcmpEvents);
+   }
+   return((int)events.size() - n);
+}
+
+
+// Drain events to binary file.
+int BondEventLog::drain(FILE *fp)
+{
+   int i, i2;
+
+   vector<BondEvent> events;
+
+   drain(events);
+   for (i = 0, i2 = (int)events.size(); i < i2; i++)
+   {
+      events[i].save(fp);
+   }
+   return(i2);
+}
+
+
+// Events dropped on full rings.
+int BondEventLog::getDropped()
+{
+   return(dropped.load());
+}
+
+
+// Discard recorded events.
+void BondEventLog::clear()
+{
+   vector<BondEvent> events;
+
+   drain(events);
+}
@@ -0,0 +1,138 @@
+/*
+ * This software is provided under the terms of the GNU General
+ * Public License as published by the Free Software Foundation.
+ *
+ * Copyright (c) 2006-2007 Tom Portegys, All Rights Reserved.
+ * Permission to use, copy, modify, and distribute this software
+ * and its documentation for NON-COMMERCIAL purposes and without
+ * fee is hereby granted provided that this copyright notice
+ * appears in all copies.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.
+ */
+
+
+
+/*
+ * Bond event log.
+ * Bond formations and breaks are recorded with their update cycle
+ * into per-thread lock-free ring buffers, and drained to memory or
+ * a binary file for reaction analysis. A binary file begins with a
+ * header identifying it, followed by the event records.
+ */
+
+#ifndef __BOND_EVENT__
+#define __BOND_EVENT__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <vector>
+#include <atomic>
+#include "body.hpp"
+using namespace std;
+
+// Bond event file identification.
+#define BOND_EVENT_MAGIC         "AFBE"
+#define BOND_EVENT_MAGIC_SIZE    4
+#define BOND_EVENT_VERSION       1
+#define BOND_EVENT_BYTE_ORDER    0x01020304u
+
+namespace affinity
+{
+// Bond event file header.
+struct BondEventHeader
+{
+   char         magic[BOND_EVENT_MAGIC_SIZE];
+   int          version;
+   unsigned int byteOrder;                        // BOND_EVENT_BYTE_ORDER as written
+   int          headerSize;
+};
+
+// Bond event.
+class BondEvent
+{
+public:
+
+   enum { FORM=0, BREAK=1 };
+
+   int      cycle;                                // update cycle
+   int      type;                                 // FORM or BREAK
+   int      id1, shell1, orbital1;                // body A
+   int      id2, shell2, orbital2;                // body B
+   float    force;                                // covalent bonding force
+   unsigned sequence;                             // record order (not saved)
+
+   // Constructors.
+   BondEvent();
+   BondEvent(int cycle, int type, Body *body1, Body *body2, float force);
+
+   // Load and save as binary record.
+   // Load returns false at end of file.
+   bool load(FILE *fp);
+   void save(FILE *fp);
+
+   // Load and save binary file header, preceding the records.
+   // Load returns false if the file is not a bond event file of
+   // this version and byte order.
+   static bool loadHeader(FILE *fp);
+   static void saveHeader(FILE *fp);
+
+   // Print.
+   void print(FILE *fp = stdout);
+
+   // Compare by cycle and record sequence for merging.
+   static bool ltcmpEvents(const BondEvent& a, const BondEvent& b);
+};
+
+// Bond event log.
+// Each thread records into its own single producer ring buffer;
+// a single consumer drains them between updates.
+class BondEventLog
+{
+public:
+
+   static const int DEFAULT_CAPACITY;
+
+   // Constructor.
+   BondEventLog(int numThreads = 1, int capacity = DEFAULT_CAPACITY);
+
+   // Destructor.
+   ~BondEventLog();
+
+   // Record event from thread, stamping its sequence.
+   // Returns false and counts the event as dropped if the ring is full.
+   bool record(int threadNum, BondEvent& event);
+
+   // Drain events in recorded order to memory or binary file.
+   // A file is to begin with BondEvent::saveHeader.
+   // Returns number of events drained.
+   int drain(vector<BondEvent>& events);
+   int drain(FILE *fp);
+
+   // Events dropped on full rings.
+   int getDropped();
+
+   // Discard recorded events.
+   void clear();
+
+private:
+
+   // Ring buffer.
+   struct Ring
+   {
+      BondEvent        *events;
+      atomic<unsigned> head;                      // next read
+      atomic<unsigned> tail;                      // next write
+   };
+   Ring        *rings;
+   int         numRings;
+   unsigned         capacity;
+   atomic<unsigned> sequence;
+   atomic<int>      dropped;
+};
+}
+#endif
@@ -0,0 +1,170 @@
+/*
+ * This software is provided under the terms of the GNU General
+ * Public License as published by the Free Software Foundation.
+ *
+ * Copyright (c) 2006-2007 Tom Portegys, All Rights Reserved.
+ * Permission to use, copy, modify, and distribute this software
+ * and its documentation for NON-COMMERCIAL purposes and without
+ * fee is hereby granted provided that this copyright notice
+ * appears in all copies.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.
+ */
+
+
+/*
+ * Census: molecule statistics and motif counts sampled over a run.
+ */
+
+#include "census.hpp"
+#include "chemistry.hpp"
+using namespace affinity;
+
+// Update cycles between samples.
+const int Census::DEFAULT_SAMPLE_FREQ = 10;
+
+// Aggregate names.
+static const char *AggregateNames[] =
+{
+   "final", "mean", "auc", "stability", NULL
+};
+
+// Constructor.
+Census::Census(int sampleFreq)
+{
+   assert(sampleFreq > 0);
+   this->sampleFreq = sampleFreq;
+}
+
+
+// Clear samples.
+void Census::clear()
+{
+   stats.clear();
+   motifCounts.clear();
+}
+
+
+// Sample chemistry.
+// Statistics come from the incrementally generated molecules,
+// and motif counts are kept current by the motif index.
+bool Census::sample(Chemistry *chemistry, bool force)
+{
+   int           i, i2;
+   MoleculeStats s;
+   vector<int>   counts;
+
+   if (!force && ((chemistry->updateCycle % sampleFreq) != 0))
+   {
+      return(false);
+   }
+   if ((stats.size() > 0) && (stats.back().cycle == chemistry->updateCycle))
+   {
+      return(false);
+   }
+   chemistry->getMoleculeStats(s.num, s.numClosed, s.numTypes, s.numClosedTypes,
+                               s.aveSize, s.aveClosedSize);
+   s.cycle = chemistry->updateCycle;
+   stats.push_back(s);
+   for (i = 0, i2 = (int)chemistry->motifIndex->motifs.size(); i < i2; i++)
+   {
+      counts.push_back(chemistry->motifIndex->motifs[i]->getCount());
+   }
+   motifCounts.push_back(counts);
+   return(true);
+}
+
+
+// Aggregate sampled values.
+float Census::aggregate(vector<float>& values, AGGREGATE type)
+{
+   int    i, n;
+   double sum, sum2, mean;
+
+   n = (int)values.size();
+   assert(n == (int)stats.size());
+   if (n == 0)
+   {
+      return(0.0f);
+   }
+   switch (type)
+   {
+   case FINAL:
+      return(values[n - 1]);
+
+   case AUC:
+      // Trapezoidal rule over sample cycles.
+      for (i = 1, sum = 0.0; i < n; i++)
+      {
+         sum += 0.5 * (double)(values[i - 1] + values[i]) *
+                (double)(stats[i].cycle - stats[i - 1].cycle);
+      }
+      return((float)sum);
+
+   case MEAN:
+   case STABILITY:
+      for (i = 0, sum = sum2 = 0.0; i < n; i++)
+      {
+         sum  += (double)values[i];
+         sum2 += (double)values[i] * (double)values[i];
+      }
+      mean = sum / (double)n;
+      if (type == MEAN)
+      {
+         return((float)mean);
+      }
+      sum2 = (sum2 / (double)n) - (mean * mean);
+      if (sum2 < 0.0)
+      {
+         sum2 = 0.0;
+      }
+      return((float)(mean - sqrt(sum2)));
+   }
+   return(0.0f);
+}
+
+
+// Get aggregate by name.
+bool Census::getAggregate(char *name, AGGREGATE& type)
+{
+   for (int i = 0; AggregateNames[i] != NULL; i++)
+   {
+      if (strcmp(name, AggregateNames[i]) == 0)
+      {
+         type = (AGGREGATE)i;
+         return(true);
+      }
+   }
+   return(false);
+}
+
+
+// Get aggregate name.
+const char *Census::getAggregateName(AGGREGATE type)
+{
+   return(AggregateNames[(int)type]);
+}
+
+
+// Print samples.
+void Census::print(FILE *fp)
+{
+   int i, i2, j, j2;
+
+   fprintf(fp, "Census:\n");
+   for (i = 0, i2 = (int)stats.size(); i < i2; i++)
+   {
+      MoleculeStats& s = stats[i];
+      fprintf(fp, "cycle=%d molecules=%d closed=%d types=%d closedTypes=%d aveSize=%f aveClosedSize=%f",
+              s.cycle, s.num, s.numClosed, s.numTypes, s.numClosedTypes,
+              s.aveSize, s.aveClosedSize);
+      for (j = 0, j2 = (int)motifCounts[i].size(); j < j2; j++)
+      {
+         fprintf(fp, " %d", motifCounts[i][j]);
+      }
+      fprintf(fp, "\n");
+   }
+}
@@ -0,0 +1,80 @@
+/*
+ * This software is provided under the terms of the GNU General
+ * Public License as published by the Free Software Foundation.
+ *
+ * Copyright (c) 2006-2007 Tom Portegys, All Rights Reserved.
+ * Permission to use, copy, modify, and distribute this software
+ * and its documentation for NON-COMMERCIAL purposes and without
+ * fee is hereby granted provided that this copyright notice
+ * appears in all copies.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.
+ */
+
+
+/*
+ * Census: molecule statistics and motif counts sampled over a run,
+ * with aggregates of a sampled value over the run time series.
+ */
+
+#ifndef __CENSUS__
+#define __CENSUS__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <vector>
+#include <assert.h>
+#include "statsService.hpp"
+using namespace std;
+
+namespace affinity
+{
+class Census
+{
+public:
+
+   // Time series aggregates.
+   enum AGGREGATE
+   {
+      FINAL     = 0,                              // last sample
+      MEAN      = 1,                              // sample mean
+      AUC       = 2,                              // area under curve over cycles
+      STABILITY = 3                               // mean less standard deviation
+   };
+
+   // Update cycles between samples.
+   static const int DEFAULT_SAMPLE_FREQ;
+   int              sampleFreq;
+
+   // Samples: molecule statistics, stamped with update cycle,
+   // and counts of the chemistry motifs.
+   vector<MoleculeStats> stats;
+   vector<vector<int> >  motifCounts;
+
+   // Constructor.
+   Census(int sampleFreq = DEFAULT_SAMPLE_FREQ);
+
+   // Clear samples.
+   void clear();
+
+   // Sample chemistry if due at its update cycle,
+   // or unconditionally if forced. Returns true if sampled.
+   bool sample(Chemistry *chemistry, bool force = false);
+
+   // Aggregate sampled values.
+   float aggregate(vector<float>& values, AGGREGATE type);
+
+   // Get aggregate by name (false=unknown).
+   static bool getAggregate(char *name, AGGREGATE& type);
+   static const char *getAggregateName(AGGREGATE type);
+
+   // Print samples.
+   void print(FILE *fp = stdout);
+};
+}
+#endif
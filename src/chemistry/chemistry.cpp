@@ -21,6 +21,21 @@
 #include "chemistry.hpp"
 using namespace affinity;
 
+// Energy minimization defaults.
+const float Chemistry::DEFAULT_MINIMIZE_TOLERANCE = 0.01f;
+const int   Chemistry::DEFAULT_MINIMIZE_STEPS     = 1000;
+
+// FIRE (fast inertial relaxation engine) minimization constants.
+#define FIRE_MIN_POSITIVE_STEPS    5
+#define FIRE_STEP_INCREASE         1.1f
+#define FIRE_STEP_DECREASE         0.5f
+#define FIRE_MAX_STEP_SCALE        10.0f
+#define FIRE_ALPHA_START           0.1f
+#define FIRE_ALPHA_DECREASE        0.99f
+
+// Minimum molecule work items for threads to share.
+#define MIN_PARALLEL_MOLECULES     256
+
 // Constructor.
 #ifdef THREADS
 Chemistry::Chemistry(float vesselRadius, RANDOM randomSeed, int numThreads)
@@ -30,17 +45,34 @@ Chemistry::Chemistry(float vesselRadius, RANDOM randomSeed)
 {
    parameters = new Parameters();
    assert(parameters != NULL);
-   this->vesselRadius = vesselRadius;
-   this->randomSeed   = randomSeed;
-   randomizer         = NULL;
-   bodyTracker        = NULL;
-   bondUpdate         = false;
+   this->vesselRadius  = vesselRadius;
+   this->randomSeed    = randomSeed;
+   randomizer          = NULL;
+   bodyTracker         = NULL;
+   bondUpdate          = false;
+   bondEvents          = NULL;
+   bondCadence         = 1;
+   bondSearchCountdown = 0;
+   minUpdateStep       = maxUpdateStep = 0.0f;
+   updateStep          = parameters->UPDATE_STEP;
+   updateTime          = 0.0;
+   updateCycle         = 0;
+   maxAcceleration     = maxSpeed = 0.0f;
+   moleculeTracker     = new MoleculeTracker(this);
+   assert(moleculeTracker != NULL);
+   motifIndex = new MotifIndex(this);
+   assert(motifIndex != NULL);
+   speciesRegistry = new SpeciesRegistry();
+   assert(speciesRegistry != NULL);
+   reactionNetwork = NULL;
+   moleculeTask    = NO_MOLECULE_TASK;
 
 #ifdef THREADS
    // Start additional chemistry update threads.
    assert(numThreads > 0);
    terminate        = false;
    this->numThreads = numThreads;
+   bondCandidates.resize(numThreads);
    if (numThreads > 1)
    {
       if (pthread_barrier_init(&updateBarrier, NULL, numThreads) != 0)
@@ -69,6 +101,8 @@ Chemistry::Chemistry(float vesselRadius, RANDOM randomSeed)
          }
       }
    }
+#else
+   bondCandidates.resize(1);
 #endif
 }
 
@@ -79,6 +113,10 @@ void Chemistry::init(int numAtoms)
    int i, n;
 
    clear();
+   parameters->buildCovalentForces();
+   updateStep  = parameters->UPDATE_STEP;
+   updateTime  = 0.0;
+   updateCycle = 0;
    randomizer = new Random(randomSeed);
    assert(randomizer != NULL);
    bodyTracker = new Octree(0.0f, 0.0f, 0.0f,
@@ -169,6 +207,17 @@ Chemistry::~Chemistry()
    }
 #endif
    clear();
+   delete moleculeTracker;
+   delete motifIndex;
+   if (reactionNetwork != NULL)
+   {
+      delete reactionNetwork;
+   }
+   delete speciesRegistry;
+   if (bondEvents != NULL)
+   {
+      delete bondEvents;
+   }
    if (parameters != NULL)
    {
       delete parameters;
@@ -182,6 +231,7 @@ void Chemistry::clear()
    int i, j;
 
    atomIDfactory = 0;
+   resetBondSearch();
    for (i = 0, j = (int)molecules.size(); i < j; i++)
    {
       if (molecules[i] != NULL)
@@ -190,6 +240,16 @@ void Chemistry::clear()
       }
    }
    molecules.clear();
+   rootMolecules.clear();
+   atomIndex.clear();
+   moleculeTracker->clear();
+   motifIndex->clear();
+   if (reactionNetwork != NULL)
+   {
+      reactionNetwork->clear();
+   }
+   speciesRegistry->clear();
+   bonds.clear();
    bodies.clear();
    if (bodyTracker != NULL)
    {
@@ -243,6 +303,10 @@ Atom *Chemistry::createAtom(int protons, int id)
       assert(atom != NULL);
    }
    atoms.push_back(atom);
+   indexAtom(atom);
+   moleculeTracker->addAtom(atom->getID());
+   motifIndex->addAtom(atom->getID());
+   resetBondSearch();
    atom->nucleus.position.x = (float)randomizer->RAND_INTERVAL(-1.0f, 1.0f);
    atom->nucleus.position.y = (float)randomizer->RAND_INTERVAL(-1.0f, 1.0f);
    atom->nucleus.position.z = (float)randomizer->RAND_INTERVAL(-1.0f, 1.0f);
@@ -289,6 +353,10 @@ int Chemistry::addAtom(Atom *atom)
    atomIDfactory++;
    atom->setParameters(parameters);
    atoms.push_back(atom);
+   indexAtom(atom);
+   moleculeTracker->addAtom(atom->getID());
+   motifIndex->addAtom(atom->getID());
+   resetBondSearch();
    b = new OctObject(atom->nucleus.position, (void *)&atom->nucleus);
    assert(b != NULL);
    bodies.push_back(b);
@@ -321,21 +389,18 @@ void Chemistry::removeAtom(int id)
    {
       init(0);
    }
+   resetBondSearch();
    for (i = 0, j = (int)bodies.size(); i < j; i++)
    {
       body = (Body *)bodies[i]->client;
       if (body->id == id)
       {
+         removeBond(body);
          bodyTracker->remove(bodies[i]);
       }
       else
       {
          tmpBodies.push_back(bodies[i]);
-         if ((body->covalentBody != NULL) && (body->covalentBody->id == id))
-         {
-            body->covalentBody->covalentBody = NULL;
-            body->covalentBody = NULL;
-         }
       }
    }
    bodies.clear();
@@ -343,6 +408,7 @@ void Chemistry::removeAtom(int id)
    {
       bodies.push_back(tmpBodies[i]);
    }
+   motifIndex->removeAtom(id);
    for (i = 0, j = (int)atoms.size(); i < j; i++)
    {
       if (atoms[i]->getID() != id)
@@ -359,26 +425,147 @@ void Chemistry::removeAtom(int id)
    {
       atoms.push_back(tmpAtoms[i]);
    }
+   if ((id >= 0) && (id < (int)atomIndex.size()))
+   {
+      atomIndex[id] = NULL;
+   }
+   moleculeTracker->removeAtom(id);
 }
 
 
 // Get atom by ID.
 Atom *Chemistry::getAtom(int id)
 {
-   int i, j;
-
    if (bodyTracker == NULL)
    {
       init(0);
    }
-   for (i = 0, j = (int)atoms.size(); i < j; i++)
+   if ((id < 0) || (id >= (int)atomIndex.size()))
+   {
+      return(NULL);
+   }
+   return(atomIndex[id]);
+}
+
+
+// Index atom by ID.
+void Chemistry::indexAtom(Atom *atom)
+{
+   int id, n;
+
+   id = atom->getID();
+   assert(id >= 0);
+   if (id >= (int)atomIndex.size())
    {
-      if (atoms[i]->getID() == id)
+      n = id + 1;
+      if (n < 2 * (int)atomIndex.size())
       {
-         return(atoms[i]);
+         n = 2 * (int)atomIndex.size();
       }
+      atomIndex.resize(n, NULL);
+   }
+   atomIndex[id] = atom;
+}
+
+
+// Get body by atom ID, shell and orbital (-1=nucleus).
+// Resolves through the atom index in constant time (NULL=invalid).
+Body *Chemistry::getBody(int id, int shell, int orbital)
+{
+   Atom *atom;
+
+   if ((atom = getAtom(id)) == NULL)
+   {
+      return(NULL);
+   }
+   if ((shell == -1) && (orbital == -1))
+   {
+      return(&atom->nucleus);
+   }
+   if ((shell < 0) || (shell >= (int)atom->shells.size()) || (orbital < 0) ||
+       (orbital >= (int)atom->shells[shell].orbitals.size()))
+   {
+      return(NULL);
+   }
+   return(&atom->shells[shell].orbitals[orbital]);
+}
+
+
+// Create covalent bond between orbital bodies.
+void Chemistry::createBond(Body *body1, Body *body2, int threadNum)
+{
+   assert(body1->covalentBody == NULL || body1->covalentBody == body2);
+   assert(body2->covalentBody == NULL || body2->covalentBody == body1);
+   motifIndex->unlink(body1->id, body2->id);
+   body1->covalentBody = body2;
+   body2->covalentBody = body1;
+   body1->bond         = body2->bond = (int)bonds.size();
+   bonds.push_back(Bond(body1, body2, body1->getCovalentForce(body2)));
+   moleculeTracker->bond(body1->id, body2->id);
+   motifIndex->link(body1->id, body2->id);
+   if (bondEvents != NULL)
+   {
+      BondEvent event(updateCycle, BondEvent::FORM, body1, body2, bonds.back().force);
+      bondEvents->record(threadNum, event);
+   }
+}
+
+
+// Remove covalent bond of body.
+// The last bond fills the vacated slot.
+void Chemistry::removeBond(Body *body, int threadNum)
+{
+   int  i, j, id, id2;
+   Bond *bond;
+
+   if (body->covalentBody == NULL)
+   {
+      return;
+   }
+   i = body->bond;
+   assert(i >= 0 && i < (int)bonds.size());
+   id  = body->id;
+   id2 = body->covalentBody->id;
+   moleculeTracker->unbond(id, id2);
+   motifIndex->unlink(id, id2);
+   if (bondEvents != NULL)
+   {
+      BondEvent event(updateCycle, BondEvent::BREAK, bonds[i].body1, bonds[i].body2, bonds[i].force);
+      bondEvents->record(threadNum, event);
+   }
+   body->covalentBody->covalentBody = NULL;
+   body->covalentBody->bond         = -1;
+   body->covalentBody = NULL;
+   body->bond         = -1;
+   j = (int)bonds.size() - 1;
+   if (i < j)
+   {
+      bonds[i]           = bonds[j];
+      bond               = &bonds[i];
+      bond->body1->bond  = bond->body2->bond = i;
+   }
+   bonds.pop_back();
+   motifIndex->link(id, id2);
+}
+
+
+// Enable or disable bond event log.
+void Chemistry::logBondEvents(bool enable, int capacity)
+{
+   if (bondEvents != NULL)
+   {
+      delete bondEvents;
+      bondEvents = NULL;
+   }
+   if (enable)
+   {
+#ifdef THREADS
+      bondEvents = new BondEventLog(numThreads, capacity);
+#else
+      bondEvents = new BondEventLog(1, capacity);
+#endif
+      assert(bondEvents != NULL);
    }
-   return(NULL);
 }
 
 
@@ -418,18 +605,80 @@ void Chemistry::update()
 }
 
 
+// Get bonding pair search guard band:
+// Between searches each body moves at most MAX_TEMPERATURE times the
+// largest update step per update, so a pair can close by twice that.
+// Random shifts of coincident bodies and vessel containment are not covered.
+float Chemistry::getBondGuardBand()
+{
+   float step;
+
+   if (bondCadence <= 1)
+   {
+      return(0.0f);
+   }
+   step = parameters->UPDATE_STEP;
+   if ((maxUpdateStep > 0.0f) && (maxUpdateStep > step))
+   {
+      step = maxUpdateStep;
+   }
+   return(2.0f * parameters->MAX_TEMPERATURE * step * (float)(bondCadence - 1));
+}
+
+
+// Get adaptive update step:
+// Solve (speed + (acceleration * step / UPDATE_STEP)) * step =
+// MAX_TEMPERATURE * UPDATE_STEP for step and clamp to bounds.
+float Chemistry::getAdaptiveUpdateStep(float acceleration, float speed)
+{
+   float step, d, c;
+
+   d = parameters->MAX_TEMPERATURE * parameters->UPDATE_STEP;
+   if (acceleration > tol)
+   {
+      c    = acceleration / parameters->UPDATE_STEP;
+      step = (float)((-speed + sqrt((speed * speed) + (4.0f * c * d))) /
+                     (2.0f * c));
+   }
+   else if (speed > tol)
+   {
+      step = d / speed;
+   }
+   else
+   {
+      step = maxUpdateStep;
+   }
+   if (step < minUpdateStep)
+   {
+      step = minUpdateStep;
+   }
+   if (step > maxUpdateStep)
+   {
+      step = maxUpdateStep;
+   }
+   return(step);
+}
+
+
+// Force bonding pair search on next update.
+void Chemistry::resetBondSearch()
+{
+   bondSearchCountdown = 0;
+}
+
+
 void Chemistry::update(int threadNum)
 {
-   int    i, i2, j, j2, k;
-   float  b, d, s;
+   int    i, i2, j, j2;
+   float  b, d, s, r, a, step;
+   bool   bondSearch;
    Vector x, f, n, v, p, m;
    Body   *b1, *b2;
 
+   vector<pair<Body *, Body *> > *candidates;
+
    list<OctObject *>           searchList;
    list<OctObject *>::iterator searchItr;
-   enum {
-      BODY_SHIFT_TRIES = 10
-   };
 #ifdef THREADS
    vector<Body *> unbond;
    vector<Body *> bond1, bond2;
@@ -460,11 +709,26 @@ void Chemistry::update(int threadNum)
          }
          pthread_exit(NULL);
       }
+
+      // Share molecule task between updates.
+      if (moleculeTask != NO_MOLECULE_TASK)
+      {
+         runMoleculeTask(threadNum, numThreads);
+         i = pthread_barrier_wait(&updateBarrier);
+         if ((i != PTHREAD_BARRIER_SERIAL_THREAD) && (i != 0))
+         {
+            fprintf(stderr, "pthread_barrier_wait failed, errno=%d\n", errno);
+            exit(1);
+         }
+         return;
+      }
    }
 #endif
+   bondSearch = (bondSearchCountdown <= 0);
 
    // Break over-extended bonds.
-   for (i = 0, i2 = (int)bodies.size(); i < i2; i++)
+   // Scan down so removals only displace visited bonds.
+   for (i = (int)bonds.size() - 1; i >= 0; i--)
    {
 #ifdef THREADS
       // Divide work among threads.
@@ -474,30 +738,22 @@ void Chemistry::update(int threadNum)
       }
 #endif
 
-      b1 = (Body *)bodies[i]->client;
-      if ((b1->covalentBody != NULL) && (b1->id < b1->covalentBody->id))
+      if (bonds[i].getLength() > parameters->COVALENT_BONDING_RANGE)
       {
-         x = b1->covalentBody->position - b1->position;
-         d = x.Magnitude();
-         if (d > parameters->COVALENT_BONDING_RANGE)
-         {
 #ifdef THREADS
-            if (numThreads > 1)
-            {
-               unbond.push_back(b1);
-            }
-            else
-            {
-               b1->covalentBody->covalentBody = NULL;
-               b1->covalentBody = NULL;
-               bondUpdate       = true;
-            }
+         if (numThreads > 1)
+         {
+            unbond.push_back(bonds[i].body1);
+         }
+         else
+         {
+            removeBond(bonds[i].body1, threadNum);
+            bondUpdate = true;
+         }
 #else
-            b1->covalentBody->covalentBody = NULL;
-            b1->covalentBody = NULL;
-            bondUpdate       = true;
+         removeBond(bonds[i].body1, threadNum);
+         bondUpdate = true;
 #endif
-         }
       }
    }
 #ifdef THREADS
@@ -505,13 +761,13 @@ void Chemistry::update(int threadNum)
    if (numThreads > 1)
    {
       pthread_barrier_wait(&updateBarrier);
+      pthread_mutex_lock(&updateMutex);
       for (i = 0, i2 = (int)unbond.size(); i < i2; i++)
       {
-         b1 = unbond[i];
-         b1->covalentBody->covalentBody = NULL;
-         b1->covalentBody = NULL;
-         bondUpdate       = true;
+         removeBond(unbond[i], threadNum);
+         bondUpdate = true;
       }
+      pthread_mutex_unlock(&updateMutex);
    }
 #endif
 
@@ -526,75 +782,94 @@ void Chemistry::update(int threadNum)
       pthread_barrier_wait(&updateBarrier);
    }
 #endif
-   for (i = 0, i2 = (int)bodies.size(); i < i2; i++)
+   candidates = &bondCandidates[threadNum];
+   if (bondSearch)
    {
-#ifdef THREADS
-      // Divide work among threads.
-      if ((i % numThreads) != threadNum)
-      {
-         continue;
-      }
-#endif
-
-      // Bond to nearby orbitals.
-      b1 = (Body *)bodies[i]->client;
-      searchList.clear();
-      bodyTracker->search(b1->position, parameters->MAX_BODY_RANGE, searchList);
-      for (searchItr = searchList.begin();
-           searchItr != searchList.end(); searchItr++)
+      // Find nearby orbital pairs.
+      candidates->clear();
+      r = parameters->COVALENT_BONDING_RANGE + getBondGuardBand();
+      for (i = 0, i2 = (int)bodies.size(); i < i2; i++)
       {
-         b2 = (Body *)(*searchItr)->client;
-         if (b1->id == b2->id)
-         {
-            continue;
-         }
-         if (!b1->hasValence || !b2->hasValence)
-         {
-            continue;
-         }
-         x = b2->position - b1->position;
-         d = x.Magnitude();
-         if (d > parameters->COVALENT_BONDING_RANGE)
-         {
-            continue;
-         }
-         b = b1->getCovalentForce(b2);
-         if ((b1->covalentBody != NULL) && (b <= b1->getCovalentForce(b1->covalentBody)))
+#ifdef THREADS
+         // Divide work among threads.
+         if ((i % numThreads) != threadNum)
          {
             continue;
          }
-         if ((b2->covalentBody != NULL) && (b <= b2->getCovalentForce(b2->covalentBody)))
+#endif
+         b1 = (Body *)bodies[i]->client;
+         if (!b1->hasValence)
          {
             continue;
          }
-         if (b1->covalentBody != NULL)
-         {
-            b1->covalentBody->covalentBody = NULL;
-            b1->covalentBody = NULL;
-         }
-         if (b2->covalentBody != NULL)
+         searchList.clear();
+         bodyTracker->search(b1->position,
+                             (r > parameters->MAX_BODY_RANGE ? r : parameters->MAX_BODY_RANGE),
+                             searchList);
+         for (searchItr = searchList.begin();
+              searchItr != searchList.end(); searchItr++)
          {
-            b2->covalentBody->covalentBody = NULL;
-            b2->covalentBody = NULL;
+            b2 = (Body *)(*searchItr)->client;
+            if (b1->id == b2->id)
+            {
+               continue;
+            }
+            if (!b2->hasValence)
+            {
+               continue;
+            }
+            x = b2->position - b1->position;
+            if (x.Magnitude() > r)
+            {
+               continue;
+            }
+            candidates->push_back(pair<Body *, Body *>(b1, b2));
          }
+      }
+   }
+   for (i = 0, i2 = (int)candidates->size(); i < i2; i++)
+   {
+      // Bond to nearby orbitals.
+      b1 = (*candidates)[i].first;
+      b2 = (*candidates)[i].second;
+      x = b2->position - b1->position;
+      d = x.Magnitude();
+      if (d > parameters->COVALENT_BONDING_RANGE)
+      {
+         continue;
+      }
+      b = b1->getCovalentForce(b2);
+      if ((b1->covalentBody != NULL) && (b <= b1->getCovalentForce(b1->covalentBody)))
+      {
+         continue;
+      }
+      if ((b2->covalentBody != NULL) && (b <= b2->getCovalentForce(b2->covalentBody)))
+      {
+         continue;
+      }
 #ifdef THREADS
-         if (numThreads > 1)
-         {
-            bond1.push_back(b1);
-            bond2.push_back(b2);
-         }
-         else
-         {
-            b1->covalentBody = b2;
-            b2->covalentBody = b1;
-            bondUpdate       = true;
-         }
+      if (numThreads > 1)
+      {
+         pthread_mutex_lock(&updateMutex);
+         removeBond(b1, threadNum);
+         removeBond(b2, threadNum);
+         pthread_mutex_unlock(&updateMutex);
+         bond1.push_back(b1);
+         bond2.push_back(b2);
+      }
+      else
+      {
+         removeBond(b1, threadNum);
+         removeBond(b2, threadNum);
+         createBond(b1, b2, threadNum);
+         bondUpdate = true;
+      }
 #else
-         b1->covalentBody = b2;
-         b2->covalentBody = b1;
-         bondUpdate       = true;
+      removeBond(b1, threadNum);
+      removeBond(b2, threadNum);
+      createBond(b1, b2, threadNum);
+      bondUpdate = true;
 #endif
-      }
    }
 #ifdef THREADS
    // Re-group threads before performing actual bonding.
@@ -610,81 +885,78 @@ void Chemistry::update(int threadNum)
          pthread_mutex_lock(&updateMutex);
          if ((b1->covalentBody == NULL) && (b2->covalentBody == NULL))
          {
-            b1->covalentBody = b2;
-            b2->covalentBody = b1;
-            bondUpdate       = true;
+            createBond(b1, b2, threadNum);
+            bondUpdate = true;
          }
          pthread_mutex_unlock(&updateMutex);
       }
    }
 #endif
 
-   // Do charge forces.
+   // Do charge, nuclear repulsion and bond forces.
 #ifdef THREADS
    if (numThreads > 1)
    {
       pthread_barrier_wait(&updateBarrier);
    }
+   updateForces(threadNum, numThreads);
+#else
+   updateForces(threadNum, 1);
 #endif
-   for (i = 0, i2 = (int)bodies.size(); i < i2; i++)
+
+   // Choose update step.
+   step = parameters->UPDATE_STEP;
+   if (maxUpdateStep > 0.0f)
    {
 #ifdef THREADS
-      if ((i % numThreads) != threadNum)
+      if (numThreads > 1)
       {
-         continue;
+         pthread_barrier_wait(&updateBarrier);
       }
 #endif
-      b1 = (Body *)bodies[i]->client;
-      searchList.clear();
-      bodyTracker->search(b1->position, parameters->MAX_BODY_RANGE, searchList);
-      for (searchItr = searchList.begin();
-           searchItr != searchList.end(); searchItr++)
+      a = s = 0.0f;
+      for (i = 0, i2 = (int)bodies.size(); i < i2; i++)
       {
-         b2 = (Body *)(*searchItr)->client;
-         if (b1 == b2)
+#ifdef THREADS
+         if ((i % numThreads) != threadNum)
          {
             continue;
          }
-         if ((b1->id == b2->id) && (b1->shell != b2->shell))
+#endif
+         b1 = (Body *)bodies[i]->client;
+         d  = b1->forces.Magnitude() / b1->mass;
+         if (d > a)
          {
-            continue;
+            a = d;
          }
-         if (b1->covalentBody == b2)
+         d = b1->velocity.Magnitude();
+         if (d > s)
          {
-            continue;
+            s = d;
          }
-
-         // Prevent overlapping bodies.
-         for (k = 0; k < BODY_SHIFT_TRIES; k++)
+      }
+#ifdef THREADS
+      if (numThreads > 1)
+      {
+         pthread_mutex_lock(&updateMutex);
+         if (a > maxAcceleration)
          {
-            x = b2->position - b1->position;
-            d = x.Magnitude();
-            if (d > tol)
-            {
-               break;
-            }
-            d = parameters->ORBITAL_BODY_RADIUS * 0.1f;
-            b1->position.x += (float)randomizer->RAND_INTERVAL(-d, d);
-            b1->position.y += (float)randomizer->RAND_INTERVAL(-d, d);
-            b1->position.z += (float)randomizer->RAND_INTERVAL(-d, d);
-            b2->position.x += (float)randomizer->RAND_INTERVAL(-d, d);
-            b2->position.y += (float)randomizer->RAND_INTERVAL(-d, d);
-            b2->position.z += (float)randomizer->RAND_INTERVAL(-d, d);
+            maxAcceleration = a;
          }
-         x.Normalize();
-
-         // Charge force: gaussian with max=charge product.
-         f = x * (b1->charge * b2->charge) *
-             (float)exp(-(double)((d * d) /
-                                  (parameters->CHARGE_GAUSSIAN_SPREAD *
-                                   parameters->CHARGE_GAUSSIAN_SPREAD)));
-         b1->forces -= f;
-         b2->forces += f;
+         if (s > maxSpeed)
+         {
+            maxSpeed = s;
+         }
+         pthread_mutex_unlock(&updateMutex);
+         pthread_barrier_wait(&updateBarrier);
+         a = maxAcceleration;
+         s = maxSpeed;
       }
+#endif
+      step = getAdaptiveUpdateStep(a, s);
    }
 
-   // Do nuclear repulsion forces:
-   // A nucleus repulses "foreign" bodies within its outer shell.
+   // Update atom velocities and positions.
    for (i = 0, i2 = (int)atoms.size(); i < i2; i++)
    {
 #ifdef THREADS
@@ -693,77 +965,14 @@ void Chemistry::update(int threadNum)
          continue;
       }
 #endif
-      b1 = &atoms[i]->nucleus;
-      searchList.clear();
-      bodyTracker->search(b1->position, parameters->MAX_BODY_RANGE, searchList);
-      for (searchItr = searchList.begin();
-           searchItr != searchList.end(); searchItr++)
-      {
-         b2 = (Body *)(*searchItr)->client;
-         if (b1->id == b2->id)
-         {
-            continue;
-         }
-         x = b2->position - b1->position;
-         d = x.Magnitude() - (parameters->BOND_LENGTH *
-                              (float)(atoms[i]->shells.size() + 1));
-         if (d > 0.0f)
-         {
-            continue;
-         }
-         x.Normalize();
-         f = (-parameters->NUCLEAR_REPULSION_STIFFNESS *
-              (float)atoms[i]->number * d * x);
-         b1->forces -= f;
-         b2->forces += f;
-      }
-   }
-
-   // Update orbital bond forces.
-   for (i = 0, i2 = (int)atoms.size(); i < i2; i++)
-   {
-#ifdef THREADS
-      if ((i % numThreads) != threadNum)
-      {
-         continue;
-      }
-#endif
-      atoms[i]->updateOrbitalBonds();
-   }
-
-   // Update covalent bond forces.
-   for (i = 0, i2 = (int)bodies.size(); i < i2; i++)
-   {
-#ifdef THREADS
-      if ((i % numThreads) != threadNum)
-      {
-         continue;
-      }
-#endif
-      b1 = (Body *)bodies[i]->client;
-      if ((b1->covalentBody != NULL) && (b1->id < b1->covalentBody->id))
-      {
-         b1->updateCovalentBond();
-      }
-   }
-
-   // Update atom velocities and positions.
-   for (i = 0, i2 = (int)atoms.size(); i < i2; i++)
-   {
-#ifdef THREADS
-      if ((i % numThreads) != threadNum)
-      {
-         continue;
-      }
-#endif
-      atoms[i]->update(parameters->UPDATE_STEP);
-   }
-
-   // Contain bodies inside vessel.
-   for (i = 0, i2 = (int)bodies.size(); i < i2; i++)
-   {
-#ifdef THREADS
-      if ((i % numThreads) != threadNum)
+      atoms[i]->update(step);
+   }
+
+   // Contain bodies inside vessel.
+   for (i = 0, i2 = (int)bodies.size(); i < i2; i++)
+   {
+#ifdef THREADS
+      if ((i % numThreads) != threadNum)
       {
          continue;
       }
@@ -774,7 +983,7 @@ void Chemistry::update(int threadNum)
       {
          b1->position.Normalize(vesselRadius - b1->radius);
       }
-      p = b1->position + (b1->velocity * parameters->UPDATE_STEP);
+      p = b1->position + (b1->velocity * step);
       if ((d >= (vesselRadius - b1->radius)) && (d < p.Magnitude()))
       {
          if (d > tol)
@@ -874,6 +1083,277 @@ void Chemistry::update(int threadNum)
       pthread_barrier_wait(&updateBarrier);
    }
 #endif
+
+   // Count down to next bonding pair search and advance time.
+   if (threadNum == 0)
+   {
+      maxAcceleration = maxSpeed = 0.0f;
+      updateStep      = step;
+      updateTime     += (double)step;
+      updateCycle++;
+      if (bondSearch)
+      {
+         bondSearchCountdown = bondCadence - 1;
+      }
+      else
+      {
+         bondSearchCountdown--;
+      }
+   }
+}
+
+
+// Accumulate body forces:
+// Charge, nuclear repulsion, orbital bond and covalent bond forces.
+// Work is divided among threadCount threads.
+void Chemistry::updateForces(int threadNum, int threadCount)
+{
+   int    i, i2, k;
+   float  d;
+   Vector x, f;
+   Body   *b1, *b2;
+
+   list<OctObject *>           searchList;
+   list<OctObject *>::iterator searchItr;
+   enum {
+      BODY_SHIFT_TRIES = 10
+   };
+
+   // Do charge forces.
+   for (i = 0, i2 = (int)bodies.size(); i < i2; i++)
+   {
+#ifdef THREADS
+      if ((i % threadCount) != threadNum)
+      {
+         continue;
+      }
+#endif
+      b1 = (Body *)bodies[i]->client;
+      searchList.clear();
+      bodyTracker->search(b1->position, parameters->MAX_BODY_RANGE, searchList);
+      for (searchItr = searchList.begin();
+           searchItr != searchList.end(); searchItr++)
+      {
+         b2 = (Body *)(*searchItr)->client;
+         if (b1 == b2)
+         {
+            continue;
+         }
+         if ((b1->id == b2->id) && (b1->shell != b2->shell))
+         {
+            continue;
+         }
+         if (b1->covalentBody == b2)
+         {
+            continue;
+         }
+
+         // Prevent overlapping bodies.
+         for (k = 0; k < BODY_SHIFT_TRIES; k++)
+         {
+            x = b2->position - b1->position;
+            d = x.Magnitude();
+            if (d > tol)
+            {
+               break;
+            }
+            d = parameters->ORBITAL_BODY_RADIUS * 0.1f;
+            b1->position.x += (float)randomizer->RAND_INTERVAL(-d, d);
+            b1->position.y += (float)randomizer->RAND_INTERVAL(-d, d);
+            b1->position.z += (float)randomizer->RAND_INTERVAL(-d, d);
+            b2->position.x += (float)randomizer->RAND_INTERVAL(-d, d);
+            b2->position.y += (float)randomizer->RAND_INTERVAL(-d, d);
+            b2->position.z += (float)randomizer->RAND_INTERVAL(-d, d);
+         }
+         x.Normalize();
+
+         // Charge force: gaussian with max=charge product.
+         f = x * (b1->charge * b2->charge) *
+             (float)exp(-(double)((d * d) /
+                                  (parameters->CHARGE_GAUSSIAN_SPREAD *
+                                   parameters->CHARGE_GAUSSIAN_SPREAD)));
+         b1->forces -= f;
+         b2->forces += f;
+      }
+   }
+
+   // Do nuclear repulsion forces:
+   // A nucleus repulses "foreign" bodies within its outer shell.
+   for (i = 0, i2 = (int)atoms.size(); i < i2; i++)
+   {
+#ifdef THREADS
+      if ((i % threadCount) != threadNum)
+      {
+         continue;
+      }
+#endif
+      b1 = &atoms[i]->nucleus;
+      searchList.clear();
+      bodyTracker->search(b1->position, parameters->MAX_BODY_RANGE, searchList);
+      for (searchItr = searchList.begin();
+           searchItr != searchList.end(); searchItr++)
+      {
+         b2 = (Body *)(*searchItr)->client;
+         if (b1->id == b2->id)
+         {
+            continue;
+         }
+         x = b2->position - b1->position;
+         d = x.Magnitude() - (parameters->BOND_LENGTH *
+                              (float)(atoms[i]->shells.size() + 1));
+         if (d > 0.0f)
+         {
+            continue;
+         }
+         x.Normalize();
+         f = (-parameters->NUCLEAR_REPULSION_STIFFNESS *
+              (float)atoms[i]->number * d * x);
+         b1->forces -= f;
+         b2->forces += f;
+      }
+   }
+
+   // Update orbital bond forces.
+   for (i = 0, i2 = (int)atoms.size(); i < i2; i++)
+   {
+#ifdef THREADS
+      if ((i % threadCount) != threadNum)
+      {
+         continue;
+      }
+#endif
+      atoms[i]->updateOrbitalBonds();
+   }
+
+   // Update covalent bond forces.
+   for (i = 0, i2 = (int)bonds.size(); i < i2; i++)
+   {
+#ifdef THREADS
+      if ((i % threadCount) != threadNum)
+      {
+         continue;
+      }
+#endif
+      bonds[i].update();
+   }
+}
+
+
+// Minimize energy using FIRE:
+// Bodies follow the update forces with velocities mixed toward the
+// force direction while the forces do positive work; otherwise the
+// bodies stop and the step shrinks. Bonds are not formed or broken.
+int Chemistry::minimize(float tolerance, int maxSteps)
+{
+   int    i, i2, n, positiveSteps;
+   float  dt, dtMax, alpha, power, vNorm, fNorm, fMax, d, r;
+   Vector p;
+   Body   *b;
+
+   assert(tolerance > 0.0f);
+   if (bodyTracker == NULL)
+   {
+      init(0);
+   }
+   for (i = 0, i2 = (int)bodies.size(); i < i2; i++)
+   {
+      b = (Body *)bodies[i]->client;
+      b->velocity.Zero();
+      b->forces.Zero();
+   }
+   dt            = parameters->UPDATE_STEP;
+   dtMax         = dt * FIRE_MAX_STEP_SCALE;
+   alpha         = FIRE_ALPHA_START;
+   positiveSteps = 0;
+   for (n = 0; n < maxSteps; n++)
+   {
+      updateForces(0, 1);
+
+      // Check convergence and get power of forces.
+      power = vNorm = fNorm = fMax = 0.0f;
+      for (i = 0, i2 = (int)bodies.size(); i < i2; i++)
+      {
+         b = (Body *)bodies[i]->client;
+         d = b->forces.Magnitude();
+         if (d > fMax)
+         {
+            fMax = d;
+         }
+         fNorm += d * d;
+         vNorm += b->velocity * b->velocity;
+         power += b->forces * b->velocity;
+      }
+      if (fMax < tolerance)
+      {
+         break;
+      }
+      fNorm = sqrt(fNorm);
+      vNorm = sqrt(vNorm);
+
+      // Steer velocities toward forces, or stop if going uphill.
+      if (power > 0.0f)
+      {
+         d = alpha * vNorm / fNorm;
+         for (i = 0, i2 = (int)bodies.size(); i < i2; i++)
+         {
+            b           = (Body *)bodies[i]->client;
+            b->velocity = (b->velocity * (1.0f - alpha)) + (b->forces * d);
+         }
+         positiveSteps++;
+         if (positiveSteps > FIRE_MIN_POSITIVE_STEPS)
+         {
+            dt *= FIRE_STEP_INCREASE;
+            if (dt > dtMax)
+            {
+               dt = dtMax;
+            }
+            alpha *= FIRE_ALPHA_DECREASE;
+         }
+      }
+      else
+      {
+         for (i = 0, i2 = (int)bodies.size(); i < i2; i++)
+         {
+            b = (Body *)bodies[i]->client;
+            b->velocity.Zero();
+         }
+         positiveSteps = 0;
+         dt           *= FIRE_STEP_DECREASE;
+         alpha         = FIRE_ALPHA_START;
+      }
+
+      // Move bodies, keeping them inside vessel and within
+      // the temperature bound as in update.
+      for (i = 0, i2 = (int)bodies.size(); i < i2; i++)
+      {
+         b            = (Body *)bodies[i]->client;
+         b->velocity += (b->forces / b->mass) * (dt / parameters->UPDATE_STEP);
+         if (b->velocity.Magnitude() > parameters->MAX_TEMPERATURE)
+         {
+            b->velocity.Normalize(parameters->MAX_TEMPERATURE);
+         }
+         p = b->position + (b->velocity * dt);
+         r            = vesselRadius - b->radius;
+         if (p.Magnitude() > r)
+         {
+            p.Normalize(r);
+            b->velocity.Zero();
+         }
+         b->position = p;
+         b->forces.Zero();
+         bodies[i]->move(b->position);
+      }
+   }
+
+   // Leave bodies at rest.
+   for (i = 0, i2 = (int)bodies.size(); i < i2; i++)
+   {
+      b = (Body *)bodies[i]->client;
+      b->velocity.Zero();
+      b->forces.Zero();
+   }
+   resetBondSearch();
+   return(n);
 }
 
 
@@ -908,72 +1388,329 @@ void Chemistry::clearAtomMarks()
 }
 
 
-// Mark molecule.
-void Chemistry::markMolecule(Atom *atom, vector<int>& atomCounts, int mark)
+// Get sorted IDs of atoms in molecule containing atom.
+// Breadth-first search over covalent bonds.
+void Chemistry::getMoleculeIDs(Atom *atom, vector<int>& ids)
 {
-   int  s, s2, o, o2;
+   int  i, i2, s, s2, o, o2;
    Body *body;
 
-   if (atom->mark != -1)
+   if (atomVisits.size() < atomIndex.size())
    {
-      return;
+      atomVisits.resize(atomIndex.size(), false);
    }
-   atom->mark = mark;
-   atomCounts[atom->number]++;
-   for (s = 0, s2 = (int)atom->shells.size(); s < s2; s++)
+   ids.clear();
+   ids.push_back(atom->getID());
+   atomVisits[atom->getID()] = true;
+   for (i = 0; i < (int)ids.size(); i++)
    {
-      for (o = 0, o2 = (int)atom->shells[s].orbitals.size(); o < o2; o++)
+      atom = atomIndex[ids[i]];
+      for (s = 0, s2 = (int)atom->shells.size(); s < s2; s++)
       {
-         if ((body = atom->shells[s].orbitals[o].covalentBody) != NULL)
+         for (o = 0, o2 = (int)atom->shells[s].orbitals.size(); o < o2; o++)
          {
-            markMolecule(getAtom(body->id), atomCounts, mark);
+            if (((body = atom->shells[s].orbitals[o].covalentBody) != NULL) &&
+                !atomVisits[body->id])
+            {
+               atomVisits[body->id] = true;
+               ids.push_back(body->id);
+            }
          }
       }
    }
+   for (i = 0, i2 = (int)ids.size(); i < i2; i++)
+   {
+      atomVisits[ids[i]] = false;
+   }
+   sort(ids.begin(), ids.end());
 }
 
 
-// Generate molecules.
-void Chemistry::generateMolecules()
+void Chemistry::getMoleculeIDs(Atom *atom, vector<int>& ids, vector<int>& atomCounts)
 {
-   int i, i2, j, j2, k;
-
-   vector<int> atomCounts;
-   Molecule    *molecule;
+   int i, i2;
 
-   for (i = 0, i2 = (int)molecules.size(); i < i2; i++)
+   getMoleculeIDs(atom, ids);
+   atomCounts.clear();
+   atomCounts.resize(parameters->MAX_NUCLEUS_PROTONS + 1, 0);
+   for (i = 0, i2 = (int)ids.size(); i < i2; i++)
    {
-      if (molecules[i] != NULL)
-      {
-         delete molecules[i];
-      }
+      atomCounts[atomIndex[ids[i]]->number]++;
    }
-   molecules.clear();
-   clearAtomMarks();
-   atomCounts.resize(parameters->MAX_NUCLEUS_PROTONS + 1);
-   for (i = k = 0, i2 = (int)atoms.size(); i < i2; i++)
+}
+
+
+// Mark molecule.
+void Chemistry::markMolecule(Atom *atom, vector<int>& atomCounts, int mark)
+{
+   int i, i2;
+
+   vector<int> ids;
+
+   if (atom->mark != -1)
+   {
+      return;
+   }
+   getMoleculeIDs(atom, ids);
+   for (i = 0, i2 = (int)ids.size(); i < i2; i++)
    {
-      if (atoms[i]->mark == -1)
+      atom       = atomIndex[ids[i]];
+      atom->mark = mark;
+      atomCounts[atom->number]++;
+   }
+}
+
+
+// Generate molecules.
+// Molecules of changed roots are replaced unless still current, and
+// their species counts updated.
+void Chemistry::generateMolecules()
+{
+   int i, i2, id;
+
+   vector<int> changed;
+   Molecule    *molecule;
+
+   moleculeTracker->refresh(changed);
+   for (i = 0, i2 = (int)changed.size(); i < i2; i++)
+   {
+      id = changed[i];
+      if ((id >= (int)rootMolecules.size()) || ((molecule = rootMolecules[id]) == NULL))
       {
-         for (j = 0, j2 = (int)atomCounts.size(); j < j2; j++)
-         {
-            atomCounts[j] = 0;
-         }
-         markMolecule(atoms[i], atomCounts, k);
-         k++;
-         molecule = new Molecule(this, atoms[i]);
+         continue;
+      }
+      if (moleculeTracker->isRoot(id) &&
+          (molecule->version == moleculeTracker->getVersion(id)))
+      {
+         continue;
+      }
+      rootMolecules[id] = NULL;
+      if (reactionNetwork != NULL)
+      {
+         reactionNetwork->consume(molecule);
+      }
+      speciesRegistry->remove(molecule);
+      molecules[molecule->index]        = molecules.back();
+      molecules[molecule->index]->index = molecule->index;
+      molecules.pop_back();
+      delete molecule;
+   }
+   moleculeRoots.clear();
+   for (i = 0, i2 = (int)changed.size(); i < i2; i++)
+   {
+      id = changed[i];
+      if (!moleculeTracker->isRoot(id))
+      {
+         continue;
+      }
+      if (id >= (int)rootMolecules.size())
+      {
+         rootMolecules.resize(id + 1, NULL);
+      }
+      if (rootMolecules[id] != NULL)
+      {
+         continue;
+      }
+      moleculeRoots.push_back(id);
+   }
+
+   // Build new molecules, in parallel if many,
+   // then register them in root order.
+   moleculeBuilds.resize(moleculeRoots.size());
+   runMoleculeTask(BUILD_MOLECULES, (int)moleculeRoots.size());
+   for (i = 0, i2 = (int)moleculeRoots.size(); i < i2; i++)
+   {
+      id       = moleculeRoots[i];
+      molecule = moleculeBuilds[i];
+      molecule->index   = (int)molecules.size();
+      molecules.push_back(molecule);
+      rootMolecules[id] = molecule;
+      speciesRegistry->add(molecule, updateCycle);
+      if (reactionNetwork != NULL)
+      {
+         reactionNetwork->produce(molecule);
+      }
+   }
+   moleculeRoots.clear();
+   moleculeBuilds.clear();
+   if (reactionNetwork != NULL)
+   {
+      reactionNetwork->update(updateCycle);
+   }
+}
+
+
+// Generate codes of all molecules, in parallel if many.
+void Chemistry::codeMolecules()
+{
+   runMoleculeTask(CODE_MOLECULES, (int)molecules.size());
+}
+
+
+// Run molecule task over work items.
+// Update threads waiting for the next update share the task
+// if there are enough items to be worth it.
+void Chemistry::runMoleculeTask(MOLECULE_TASK task, int numItems)
+{
+   moleculeTask = task;
+#ifdef THREADS
+   int i;
+
+   if ((numThreads > 1) && (numItems >= MIN_PARALLEL_MOLECULES))
+   {
+      i = pthread_barrier_wait(&updateBarrier);
+      if ((i != PTHREAD_BARRIER_SERIAL_THREAD) && (i != 0))
+      {
+         fprintf(stderr, "pthread_barrier_wait failed, errno=%d\n", errno);
+         exit(1);
+      }
+      runMoleculeTask(0, numThreads);
+      i = pthread_barrier_wait(&updateBarrier);
+      if ((i != PTHREAD_BARRIER_SERIAL_THREAD) && (i != 0))
+      {
+         fprintf(stderr, "pthread_barrier_wait failed, errno=%d\n", errno);
+         exit(1);
+      }
+   }
+   else
+   {
+      runMoleculeTask(0, 1);
+   }
+#else
+   runMoleculeTask(0, 1);
+#endif
+   moleculeTask = NO_MOLECULE_TASK;
+}
+
+
+// Run thread share of molecule task.
+// Molecules are built from tracked molecule members and coded
+// independently, touching only their own atoms.
+void Chemistry::runMoleculeTask(int threadNum, int threadCount)
+{
+   int      i, i2;
+   Molecule *molecule;
+
+   switch (moleculeTask)
+   {
+   case BUILD_MOLECULES:
+      for (i = threadNum, i2 = (int)moleculeRoots.size(); i < i2; i += threadCount)
+      {
+         molecule = new Molecule(this, moleculeTracker->getMembers(moleculeRoots[i]));
          assert(molecule != NULL);
-         molecules.push_back(molecule);
+         molecule->version = moleculeTracker->getVersion(moleculeRoots[i]);
+         moleculeBuilds[i] = molecule;
       }
+      break;
+
+   case CODE_MOLECULES:
+      for (i = threadNum, i2 = (int)molecules.size(); i < i2; i += threadCount)
+      {
+         molecules[i]->generateCode();
+      }
+      break;
+
+   default:
+      break;
+   }
+}
+
+
+// Align snapshot section offset.
+static int alignSnapshot(int offset)
+{
+   return((offset + 7) & ~7);
+}
+
+
+// Check snapshot section lies within snapshot.
+static bool checkSnapshotSection(SnapshotHeader& header, int offset, int count, int recordSize)
+{
+   if ((offset < header.headerSize) || (count < 0) || ((offset % 8) != 0))
+   {
+      return(false);
    }
+   return(((long long)offset + ((long long)count * (long long)recordSize)) <= (long long)header.size);
 }
 
 
-// Load chemistry.
+// Load chemistry, detecting its format.
 void Chemistry::load(FILE *fp)
 {
-   int       i, j, p, q, id, id2, s, s2, o, o2;
+   int  c, version;
+   long position;
+   char magic[SNAPSHOT_MAGIC_SIZE];
+
+#ifndef BINARY_FILE_FORMAT
+   // Skip white space left by preceding text fields.
+   while ((c = getc(fp)) != EOF && isspace(c))
+   {
+   }
+   if (c != EOF)
+   {
+      ungetc(c, fp);
+   }
+#endif
+   position = ftell(fp);
+   if (fread(magic, SNAPSHOT_MAGIC_SIZE, 1, fp) != 1)
+   {
+      memset(magic, 0, SNAPSHOT_MAGIC_SIZE);
+   }
+   if (memcmp(magic, SNAPSHOT_MAGIC, SNAPSHOT_MAGIC_SIZE) == 0)
+   {
+      fseek(fp, position, SEEK_SET);
+      loadSnapshot(fp);
+   }
+   else if (memcmp(magic, TEXT_FORMAT_MAGIC, SNAPSHOT_MAGIC_SIZE) == 0)
+   {
+      FREAD_INT(&version, fp);
+      if ((version < 1) || (version > TEXT_FORMAT_VERSION))
+      {
+         fprintf(stderr, "Text format version %d not supported\n", version);
+         exit(1);
+      }
+      loadText(fp, version);
+   }
+   else
+   {
+      fseek(fp, position, SEEK_SET);
+      loadText(fp, 0);
+   }
+}
+
+
+// Insert loaded atom and its bodies.
+void Chemistry::insertAtom(Atom *atom)
+{
+   int       s, s2, o, o2;
    OctObject *b;
+
+   atoms.push_back(atom);
+   indexAtom(atom);
+   moleculeTracker->addAtom(atom->getID());
+   motifIndex->addAtom(atom->getID());
+   b = new OctObject(atom->nucleus.position, (void *)&atom->nucleus);
+   assert(b != NULL);
+   bodies.push_back(b);
+   bodyTracker->insert(b);
+   for (s = 0, s2 = (int)atom->shells.size(); s < s2; s++)
+   {
+      for (o = 0, o2 = (int)atom->shells[s].orbitals.size(); o < o2; o++)
+      {
+         b = new OctObject(atom->shells[s].orbitals[o].position,
+                           (void *)&atom->shells[s].orbitals[o]);
+         assert(b != NULL);
+         bodies.push_back(b);
+         bodyTracker->insert(b);
+      }
+   }
+}
+
+
+// Load chemistry in text format.
+void Chemistry::loadText(FILE *fp, int version)
+{
+   int       i, j, id, id2, s, s2, o, o2;
    Atom      *atom;
    Body      *b1, *b2;
    Thermal   *thermal;
@@ -982,6 +1719,21 @@ void Chemistry::load(FILE *fp)
    parameters->load(fp);
    FREAD_INT(&atomIDfactory, fp);
    FREAD_FLOAT(&vesselRadius, fp);
+   if (version >= 1)
+   {
+      FREAD_FLOAT(&minUpdateStep, fp);
+      FREAD_FLOAT(&maxUpdateStep, fp);
+      FREAD_FLOAT(&updateStep, fp);
+      FREAD_DOUBLE(&updateTime, fp);
+      FREAD_INT(&updateCycle, fp);
+   }
+   else
+   {
+      minUpdateStep = maxUpdateStep = 0.0f;
+      updateStep    = parameters->UPDATE_STEP;
+      updateTime    = 0.0;
+      updateCycle   = 0;
+   }
    randomizer->RAND_LOAD(fp);
    FREAD_INT(&j, fp);
    for (i = 0; i < j; i++)
@@ -989,22 +1741,7 @@ void Chemistry::load(FILE *fp)
       atom = new Atom(parameters);
       assert(atom != NULL);
       atom->load(fp);
-      atoms.push_back(atom);
-      b = new OctObject(atom->nucleus.position, (void *)&atom->nucleus);
-      assert(b != NULL);
-      bodies.push_back(b);
-      bodyTracker->insert(b);
-      for (s = 0, s2 = (int)atom->shells.size(); s < s2; s++)
-      {
-         for (o = 0, o2 = (int)atom->shells[s].orbitals.size(); o < o2; o++)
-         {
-            b = new OctObject(atom->shells[s].orbitals[o].position,
-                              (void *)&atom->shells[s].orbitals[o]);
-            assert(b != NULL);
-            bodies.push_back(b);
-            bodyTracker->insert(b);
-         }
-      }
+      insertAtom(atom);
    }
    FREAD_INT(&j, fp);
    for (i = 0; i < j; i++)
@@ -1012,45 +1749,295 @@ void Chemistry::load(FILE *fp)
       FREAD_INT(&id, fp);
       FREAD_INT(&s, fp);
       FREAD_INT(&o, fp);
-      for (p = 0, q = (int)bodies.size(); p < q; p++)
-      {
-         b1 = (Body *)bodies[p]->client;
-         if ((b1->id == id) && (b1->shell == s) && (b1->orbital == o))
-         {
-            break;
-         }
-      }
-      assert(p < q);
       FREAD_INT(&id2, fp);
       FREAD_INT(&s2, fp);
       FREAD_INT(&o2, fp);
-      for (p = 0, q = (int)bodies.size(); p < q; p++)
+      b1 = getBody(id, s, o);
+      b2 = getBody(id2, s2, o2);
+      assert(b1 != NULL && b2 != NULL);
+      createBond(b1, b2);
+   }
+   FREAD_INT(&j, fp);
+   for (i = 0; i < j; i++)
+   {
+      thermal = new Thermal(parameters);
+      assert(thermal != NULL);
+      thermal->load(fp);
+      thermals.push_back(thermal);
+   }
+}
+
+
+// Load chemistry snapshot.
+void Chemistry::loadSnapshot(FILE *fp)
+{
+   int            i, i2, j, k, n, shellIndex, bodyIndex;
+   SnapshotHeader header;
+   Atom           *atom;
+   Body           *b1, *b2;
+   Thermal        *thermal;
+
+   vector<char> buffer;
+
+   // Read header and sections.
+   if (fread(&header, sizeof(header), 1, fp) != 1)
+   {
+      fprintf(stderr, "Cannot read snapshot header\n");
+      exit(1);
+   }
+   if (header.byteOrder != SNAPSHOT_BYTE_ORDER)
+   {
+      fprintf(stderr, "Snapshot byte order not supported\n");
+      exit(1);
+   }
+   if (header.version != SNAPSHOT_VERSION)
+   {
+      fprintf(stderr, "Snapshot version %d not supported\n", header.version);
+      exit(1);
+   }
+   if ((header.headerSize != (int)sizeof(header)) || (header.size < header.headerSize) ||
+       !checkSnapshotSection(header, header.parametersOffset, 1, sizeof(SnapshotParameters)) ||
+       !checkSnapshotSection(header, header.stateOffset, 1, sizeof(SnapshotState)) ||
+       (header.randomSize != RAND_N) ||
+       !checkSnapshotSection(header, header.randomOffset, header.randomSize, sizeof(unsigned int)) ||
+       !checkSnapshotSection(header, header.atomsOffset, header.numAtoms, sizeof(SnapshotAtom)) ||
+       !checkSnapshotSection(header, header.shellsOffset, header.numShells, sizeof(SnapshotShell)) ||
+       !checkSnapshotSection(header, header.bodiesOffset, header.numBodies, sizeof(SnapshotBody)) ||
+       !checkSnapshotSection(header, header.bondsOffset, header.numBonds, sizeof(SnapshotBond)) ||
+       !checkSnapshotSection(header, header.thermalsOffset, header.numThermals, sizeof(SnapshotThermal)))
+   {
+      fprintf(stderr, "Invalid snapshot header\n");
+      exit(1);
+   }
+   buffer.resize(header.size);
+   memcpy(&buffer[0], &header, sizeof(header));
+   n = header.size - header.headerSize;
+   if ((n > 0) && (fread(&buffer[header.headerSize], n, 1, fp) != 1))
+   {
+      fprintf(stderr, "Cannot read snapshot\n");
+      exit(1);
+   }
+   SnapshotState   *state    = (SnapshotState *)&buffer[header.stateOffset];
+   SnapshotAtom    *atomRecs = (SnapshotAtom *)&buffer[header.atomsOffset];
+   SnapshotShell   *shells   = (SnapshotShell *)&buffer[header.shellsOffset];
+   SnapshotBody    *bodyRecs = (SnapshotBody *)&buffer[header.bodiesOffset];
+   SnapshotBond    *bondRecs = (SnapshotBond *)&buffer[header.bondsOffset];
+   SnapshotThermal *thermalRecs = (SnapshotThermal *)&buffer[header.thermalsOffset];
+
+   // Restore state.
+   init(0);
+   parameters->load(*(SnapshotParameters *)&buffer[header.parametersOffset]);
+   if ((parameters->MIN_NUCLEUS_PROTONS < Parameters::DEFAULT_MIN_NUCLEUS_PROTONS) ||
+       (parameters->MAX_NUCLEUS_PROTONS > Parameters::DEFAULT_MAX_NUCLEUS_PROTONS) ||
+       (parameters->MIN_NUCLEUS_PROTONS > parameters->MAX_NUCLEUS_PROTONS))
+   {
+      fprintf(stderr, "Invalid snapshot parameters\n");
+      exit(1);
+   }
+   atomIDfactory = state->atomIDfactory;
+   vesselRadius  = state->vesselRadius;
+   minUpdateStep = state->minUpdateStep;
+   maxUpdateStep = state->maxUpdateStep;
+   updateStep    = state->updateStep;
+   updateTime    = state->updateTime;
+   updateCycle   = state->updateCycle;
+   randomizer->RAND_SET_STATE((unsigned int *)&buffer[header.randomOffset], state->randomIndex);
+
+   // Restore atoms.
+   // Atom IDs must be unique and issued, and records consistent.
+   for (i = shellIndex = bodyIndex = 0; i < header.numAtoms; i++)
+   {
+      k = shellIndex + atomRecs[i].numShells;
+      if ((atomRecs[i].numShells < 0) || (k > header.numShells))
+      {
+         fprintf(stderr, "Invalid snapshot atom %d\n", i);
+         exit(1);
+      }
+      for (j = shellIndex, n = 1; j < k; j++)
       {
-         b2 = (Body *)bodies[p]->client;
-         if ((b2->id == id2) && (b2->shell == s2) && (b2->orbital == o2))
+         if (shells[j].numOrbitals < 0)
          {
-            break;
+            fprintf(stderr, "Invalid snapshot atom %d\n", i);
+            exit(1);
          }
+         n += shells[j].numOrbitals;
+      }
+      if (((bodyIndex + n) > header.numBodies) ||
+          (bodyRecs[bodyIndex].id < 0) || (bodyRecs[bodyIndex].id >= atomIDfactory) ||
+          (getAtom(bodyRecs[bodyIndex].id) != NULL))
+      {
+         fprintf(stderr, "Invalid snapshot atom %d\n", i);
+         exit(1);
+      }
+      atom = new Atom(parameters);
+      assert(atom != NULL);
+      if (!atom->load(atomRecs[i], &shells[shellIndex], &bodyRecs[bodyIndex]))
+      {
+         fprintf(stderr, "Invalid snapshot atom %d\n", i);
+         exit(1);
       }
-      assert(p < q);
-      b1->covalentBody = b2;
-      b2->covalentBody = b1;
+      insertAtom(atom);
+      shellIndex = k;
+      bodyIndex += n;
    }
-   FREAD_INT(&j, fp);
-   for (i = 0; i < j; i++)
+
+   // Restore bonds.
+   // Bonds join orbitals of different atoms, each bonded once.
+   for (i = 0, i2 = header.numBonds; i < i2; i++)
+   {
+      b1 = getBody(bondRecs[i].id1, bondRecs[i].shell1, bondRecs[i].orbital1);
+      b2 = getBody(bondRecs[i].id2, bondRecs[i].shell2, bondRecs[i].orbital2);
+      if ((b1 == NULL) || (b2 == NULL) || (b1->shell == -1) || (b2->shell == -1) ||
+          (b1->id == b2->id) || (b1->covalentBody != NULL) || (b2->covalentBody != NULL))
+      {
+         fprintf(stderr, "Invalid snapshot bond %d\n", i);
+         exit(1);
+      }
+      createBond(b1, b2);
+   }
+
+   // Restore thermals.
+   for (i = 0, i2 = header.numThermals; i < i2; i++)
    {
       thermal = new Thermal(parameters);
       assert(thermal != NULL);
-      thermal->load(fp);
+      thermal->load(thermalRecs[i]);
       thermals.push_back(thermal);
    }
 }
 
 
-// Save chemistry.
+// Save chemistry as binary snapshot.
 void Chemistry::save(FILE *fp)
 {
-   int     i, j, k;
+   vector<char> buffer;
+
+   save(buffer);
+   if (fwrite(&buffer[0], buffer.size(), 1, fp) != 1)
+   {
+      fprintf(stderr, "Cannot write snapshot\n");
+      exit(1);
+   }
+}
+
+
+// Save chemistry as binary snapshot appended to buffer.
+void Chemistry::save(vector<char>& buffer)
+{
+   int            i, i2, size, base;
+   SnapshotHeader header;
+   SnapshotState  state;
+   SnapshotBond   bondRecord;
+   Body           *body;
+
+   SnapshotParameters      parametersRecord;
+   vector<unsigned int>    randomState;
+   vector<SnapshotAtom>    atomRecords;
+   vector<SnapshotShell>   shellRecords;
+   vector<SnapshotBody>    bodyRecords;
+   vector<SnapshotBond>    bondRecords;
+   vector<SnapshotThermal> thermalRecords;
+
+   if (bodyTracker == NULL)
+   {
+      init(0);
+   }
+
+   // Gather records.
+   parameters->save(parametersRecord);
+   memset(&state, 0, sizeof(state));
+   state.atomIDfactory = atomIDfactory;
+   state.vesselRadius  = vesselRadius;
+   state.minUpdateStep = minUpdateStep;
+   state.maxUpdateStep = maxUpdateStep;
+   state.updateStep    = updateStep;
+   state.updateTime    = updateTime;
+   state.updateCycle   = updateCycle;
+   randomState.resize(RAND_N);
+   randomizer->RAND_GET_STATE(&randomState[0], state.randomIndex);
+   atomRecords.resize(atoms.size());
+   for (i = 0, i2 = (int)atoms.size(); i < i2; i++)
+   {
+      atoms[i]->save(atomRecords[i], shellRecords, bodyRecords);
+   }
+   for (i = 0, i2 = (int)bonds.size(); i < i2; i++)
+   {
+      body                = bonds[i].body1;
+      bondRecord.id1      = body->id;
+      bondRecord.shell1   = body->shell;
+      bondRecord.orbital1 = body->orbital;
+      body                = bonds[i].body2;
+      bondRecord.id2      = body->id;
+      bondRecord.shell2   = body->shell;
+      bondRecord.orbital2 = body->orbital;
+      bondRecords.push_back(bondRecord);
+   }
+   thermalRecords.resize(thermals.size());
+   for (i = 0, i2 = (int)thermals.size(); i < i2; i++)
+   {
+      thermals[i]->save(thermalRecords[i]);
+   }
+
+   // Lay out sections.
+   memset(&header, 0, sizeof(header));
+   memcpy(header.magic, SNAPSHOT_MAGIC, SNAPSHOT_MAGIC_SIZE);
+   header.version          = SNAPSHOT_VERSION;
+   header.byteOrder        = SNAPSHOT_BYTE_ORDER;
+   header.headerSize       = (int)sizeof(header);
+   header.numAtoms         = (int)atomRecords.size();
+   header.numShells        = (int)shellRecords.size();
+   header.numBodies        = (int)bodyRecords.size();
+   header.numBonds         = (int)bondRecords.size();
+   header.numThermals      = (int)thermalRecords.size();
+   header.randomSize       = RAND_N;
+   size                    = alignSnapshot(header.headerSize);
+   header.parametersOffset = size;
+   size                    = alignSnapshot(size + (int)sizeof(SnapshotParameters));
+   header.stateOffset      = size;
+   size                    = alignSnapshot(size + (int)sizeof(SnapshotState));
+   header.randomOffset     = size;
+   size                    = alignSnapshot(size + (RAND_N * (int)sizeof(unsigned int)));
+   header.atomsOffset      = size;
+   size                    = alignSnapshot(size + (header.numAtoms * (int)sizeof(SnapshotAtom)));
+   header.shellsOffset     = size;
+   size                    = alignSnapshot(size + (header.numShells * (int)sizeof(SnapshotShell)));
+   header.bodiesOffset     = size;
+   size                    = alignSnapshot(size + (header.numBodies * (int)sizeof(SnapshotBody)));
+   header.bondsOffset      = size;
+   size                    = alignSnapshot(size + (header.numBonds * (int)sizeof(SnapshotBond)));
+   header.thermalsOffset   = size;
+   size                    = alignSnapshot(size + (header.numThermals * (int)sizeof(SnapshotThermal)));
+   header.size             = size;
+
+   // Copy snapshot.
+   base = (int)buffer.size();
+   buffer.resize(base + size, 0);
+   memcpy(&buffer[base], &header, sizeof(header));
+   memcpy(&buffer[base + header.parametersOffset], &parametersRecord, sizeof(SnapshotParameters));
+   memcpy(&buffer[base + header.stateOffset], &state, sizeof(SnapshotState));
+   memcpy(&buffer[base + header.randomOffset], &randomState[0], RAND_N * sizeof(unsigned int));
+   if (header.numAtoms > 0)
+   {
+      memcpy(&buffer[base + header.atomsOffset], &atomRecords[0], header.numAtoms * sizeof(SnapshotAtom));
+      memcpy(&buffer[base + header.shellsOffset], &shellRecords[0], header.numShells * sizeof(SnapshotShell));
+      memcpy(&buffer[base + header.bodiesOffset], &bodyRecords[0], header.numBodies * sizeof(SnapshotBody));
+   }
+   if (header.numBonds > 0)
+   {
+      memcpy(&buffer[base + header.bondsOffset], &bondRecords[0], header.numBonds * sizeof(SnapshotBond));
+   }
+   if (header.numThermals > 0)
+   {
+      memcpy(&buffer[base + header.thermalsOffset], &thermalRecords[0],
+             header.numThermals * sizeof(SnapshotThermal));
+   }
+}
+
+
+// Save chemistry in text format.
+void Chemistry::saveText(FILE *fp)
+{
+   int     i, j, version;
    Atom    *atom;
    Body    *body;
    Thermal *thermal;
@@ -1059,9 +2046,21 @@ void Chemistry::save(FILE *fp)
    {
       init(0);
    }
+   version = TEXT_FORMAT_VERSION;
+   if (fwrite(TEXT_FORMAT_MAGIC, SNAPSHOT_MAGIC_SIZE, 1, fp) != 1)
+   {
+      fprintf(stderr, "Cannot write text format marker\n");
+      exit(1);
+   }
+   FWRITE_INT(&version, fp);
    parameters->save(fp);
    FWRITE_INT(&atomIDfactory, fp);
    FWRITE_FLOAT(&vesselRadius, fp);
+   FWRITE_FLOAT(&minUpdateStep, fp);
+   FWRITE_FLOAT(&maxUpdateStep, fp);
+   FWRITE_FLOAT(&updateStep, fp);
+   FWRITE_DOUBLE(&updateTime, fp);
+   FWRITE_INT(&updateCycle, fp);
    randomizer->RAND_SAVE(fp);
    j = (int)atoms.size();
    FWRITE_INT(&j, fp);
@@ -1070,27 +2069,18 @@ void Chemistry::save(FILE *fp)
       atom = atoms[i];
       atom->save(fp);
    }
-   for (i = k = 0, j = (int)bodies.size(); i < j; i++)
-   {
-      body = (Body *)bodies[i]->client;
-      if ((body->covalentBody != NULL) && (body->id < body->covalentBody->id))
-      {
-         k++;
-      }
-   }
-   FWRITE_INT(&k, fp);
-   for (i = 0, j = (int)bodies.size(); i < j; i++)
+   j = (int)bonds.size();
+   FWRITE_INT(&j, fp);
+   for (i = 0; i < j; i++)
    {
-      body = (Body *)bodies[i]->client;
-      if ((body->covalentBody != NULL) && (body->id < body->covalentBody->id))
-      {
-         FWRITE_INT(&body->id, fp);
-         FWRITE_INT(&body->shell, fp);
-         FWRITE_INT(&body->orbital, fp);
-         FWRITE_INT(&body->covalentBody->id, fp);
-         FWRITE_INT(&body->covalentBody->shell, fp);
-         FWRITE_INT(&body->covalentBody->orbital, fp);
-      }
+      body = bonds[i].body1;
+      FWRITE_INT(&body->id, fp);
+      FWRITE_INT(&body->shell, fp);
+      FWRITE_INT(&body->orbital, fp);
+      body = bonds[i].body2;
+      FWRITE_INT(&body->id, fp);
+      FWRITE_INT(&body->shell, fp);
+      FWRITE_INT(&body->orbital, fp);
    }
    j = (int)thermals.size();
    FWRITE_INT(&j, fp);
@@ -1103,12 +2093,17 @@ void Chemistry::save(FILE *fp)
 
 
 // Import chemistry into current one.
+// Bonds are resolved by atom, shell and orbital after the
+// imported atoms are given new IDs.
 void Chemistry::import(FILE *fp)
 {
-   int       i, j;
-   Chemistry *chemistry;
-   Atom      *atom;
-   Thermal   *thermal;
+   int                  i, j, k;
+   Chemistry            *chemistry;
+   Atom                 *atom;
+   Body                 *b1, *b2;
+   Thermal              *thermal;
+   vector<int>          ids;
+   vector<SnapshotBond> bondRecs;
 
 #ifdef THREADS
    chemistry = new Chemistry(vesselRadius, randomSeed, 1);
@@ -1118,10 +2113,34 @@ void Chemistry::import(FILE *fp)
    assert(chemistry != NULL);
    chemistry->load(fp);
 
+   // Record bond endpoints before atoms are given new IDs.
+   bondRecs.resize(chemistry->bonds.size());
+   for (i = 0, j = (int)chemistry->bonds.size(); i < j; i++)
+   {
+      b1 = chemistry->bonds[i].body1;
+      b2 = chemistry->bonds[i].body2;
+      bondRecs[i].id1      = b1->id;
+      bondRecs[i].shell1   = b1->shell;
+      bondRecs[i].orbital1 = b1->orbital;
+      bondRecs[i].id2      = b2->id;
+      bondRecs[i].shell2   = b2->shell;
+      bondRecs[i].orbital2 = b2->orbital;
+   }
+
+   ids.resize(chemistry->atomIndex.size(), -1);
    for (i = 0, j = (int)chemistry->atoms.size(); i < j; i++)
    {
       atom = chemistry->atoms[i];
-      addAtom(atom);
+      k    = atom->getID();
+      ids[k] = addAtom(atom);
+   }
+
+   for (i = 0, j = (int)bondRecs.size(); i < j; i++)
+   {
+      b1 = getBody(ids[bondRecs[i].id1], bondRecs[i].shell1, bondRecs[i].orbital1);
+      b2 = getBody(ids[bondRecs[i].id2], bondRecs[i].shell2, bondRecs[i].orbital2);
+      assert(b1 != NULL && b2 != NULL);
+      createBond(b1, b2);
    }
 
    for (i = 0, j = (int)chemistry->thermals.size(); i < j; i++)
@@ -1131,279 +2150,79 @@ void Chemistry::import(FILE *fp)
    }
 
    chemistry->atoms.clear();
+   chemistry->bonds.clear();
    chemistry->thermals.clear();
    delete chemistry;
 }
 
 
-// Get molecule statistics.
-void Chemistry::getMoleculeStats(int& num, int& numClosed,
-                                 int& numTypes, int& numClosedTypes,
-                                 float& aveSize, float& aveClosedSize)
+// Set species by formula only, recounting current molecules.
+void Chemistry::setSpeciesByFormula(bool byFormula)
 {
-   int      i, j, j2, s, cs;
-   Molecule *m;
-
-   vector<Molecule *> u, cu;
+   int i, i2;
 
-   generateMolecules();
-   s = cs = numClosed = numTypes = numClosedTypes = 0;
-   for (i = 0, num = (int)molecules.size(); i < num; i++)
-   {
-      m  = molecules[i];
-      s += m->size();
-      for (j = 0, j2 = (int)u.size(); j < j2; j++)
-      {
-         if (m->equals(u[j]))
-         {
-            break;
-         }
-      }
-      if (j == j2)
-      {
-         numTypes++;
-         u.push_back(m);
-      }
-      if (m->isClosed())
-      {
-         numClosed++;
-         cs += m->size();
-         for (j = 0, j2 = (int)cu.size(); j < j2; j++)
-         {
-            if (m->equals(cu[j]))
-            {
-               break;
-            }
-         }
-         if (j == j2)
-         {
-            numClosedTypes++;
-            cu.push_back(m);
-         }
-      }
-   }
-   if (num > 0)
+   if (speciesRegistry->byFormula == byFormula)
    {
-      aveSize = (float)s / (float)num;
+      return;
    }
-   else
+   for (i = 0, i2 = (int)molecules.size(); i < i2; i++)
    {
-      aveSize = 0.0f;
+      speciesRegistry->remove(molecules[i]);
    }
-   if (numClosed > 0)
+   speciesRegistry->clear();
+   speciesRegistry->byFormula = byFormula;
+   if (reactionNetwork != NULL)
    {
-      aveClosedSize = (float)cs / (float)numClosed;
+      reactionNetwork->clear();
    }
-   else
+   for (i = 0, i2 = (int)molecules.size(); i < i2; i++)
    {
-      aveClosedSize = 0.0f;
+      speciesRegistry->add(molecules[i], updateCycle);
    }
 }
 
 
-#if (O2_MOLECULES)
-// Count O2 molecules.
-int Chemistry::countO2()
+// Enable or disable reaction network.
+void Chemistry::trackReactions(bool enable)
 {
-   int  i, i2, j, j2, k, o2;
-   Atom *atom, *atom1, *atom2;
-   Body *body1, *body2;
-
-   for (i = o2 = 0, i2 = atoms.size(); i < i2; i++)
+   if (reactionNetwork != NULL)
    {
-      // Oxygen?
-      atom = atoms[i];
-      if (atom->number != 6)
-      {
-         continue;
-      }
-      body1 = body2 = NULL;
-      for (j = 0, j2 = atom->shells[0].orbitals.size(); j < j2; j++)
-      {
-         if (body1 == NULL)
-         {
-            body1 = &atom->shells[0].orbitals[j];
-            body1 = body1->covalentBody;
-         }
-         else if (body2 == NULL)
-         {
-            body2 = &atom->shells[0].orbitals[j];
-            body2 = body2->covalentBody;
-         }
-         else
-         {
-            break;
-         }
-      }
-      if ((body1 == NULL) || (body2 == NULL))
-      {
-         continue;
-      }
-      for (k = 0; k < i2; k++)
-      {
-         if (atoms[k]->getID() == body1->id)
-         {
-            atom1 = atoms[k];
-         }
-         if (atoms[k]->getID() == body2->id)
-         {
-            atom2 = atoms[k];
-         }
-      }
-      if ((atom1->number == 6) && (atom2->number == 6) &&
-          (atom1->getID() == atom2->getID()) &&
-          (atom->getID() > atom1->getID()))
-      {
-         o2++;
-      }
+      delete reactionNetwork;
+      reactionNetwork = NULL;
    }
-   return(o2);
-}
-
-
-#endif
-
-#if (H2O_MOLECULES)
-// Count H2O molecules
-int Chemistry::countH2O()
-{
-   int  i, i2, j, j2, k, h2o;
-   Atom *atom, *atom1, *atom2;
-   Body *body1, *body2;
-
-   h2o = 0;
-   for (i = 0, i2 = atoms.size(); i < i2; i++)
+   if (enable)
    {
-      atom = atoms[i];
-      if (atom->number != 6)
-      {
-         continue;                                // oxygen?
-      }
-      body1 = body2 = NULL;
-      for (j = 0, j2 = atom->shells[0].orbitals.size(); j < j2; j++)
-      {
-         if (body1 == NULL)
-         {
-            body1 = &atom->shells[0].orbitals[j];
-            body1 = body1->covalentBody;
-         }
-         else if (body2 == NULL)
-         {
-            body2 = &atom->shells[0].orbitals[j];
-            body2 = body2->covalentBody;
-         }
-         else
-         {
-            break;
-         }
-      }
-      if ((body1 == NULL) || (body2 == NULL))
-      {
-         continue;
-      }
-      for (k = 0; k < i2; k++)
-      {
-         if (atoms[k]->getID() == body1->id)
-         {
-            atom1 = atoms[k];
-         }
-         if (atoms[k]->getID() == body2->id)
-         {
-            atom2 = atoms[k];
-         }
-      }
-      if ((atom1->number == 1) && (atom2->number == 1))
-      {
-         h2o++;
-      }
+      reactionNetwork = new ReactionNetwork(speciesRegistry);
+      assert(reactionNetwork != NULL);
    }
-   return(h2o);
 }
 
 
-#endif
-
-#if (CO2_MOLECULES)
-// Count CO2 molecules.
-int Chemistry::countCO2()
+// Get molecule statistics.
+void Chemistry::getMoleculeStats(int& num, int& numClosed,
+                                 int& numTypes, int& numClosedTypes,
+                                 float& aveSize, float& aveClosedSize)
 {
-   int  i, i2, j, j2, k, co2;
-   Atom *atom, *atom1, *atom2, *atom3, *atom4;
-   Body *body1, *body2, *body3, *body4;
-
-   co2 = 0;
-   for (i = 0, i2 = atoms.size(); i < i2; i++)
+   generateMolecules();
+   num            = speciesRegistry->numMolecules;
+   numClosed      = speciesRegistry->numClosed;
+   numTypes       = (int)speciesRegistry->present.size();
+   numClosedTypes = speciesRegistry->numClosedTypes;
+   if (num > 0)
    {
-      atom = atoms[i];
-      if (atom->number != 4)
-      {
-         continue;                                // carbon?
-      }
-      body1 = body2 = body3 = body4 = NULL;
-      for (j = 0, j2 = atom->shells[0].orbitals.size(); j < j2; j++)
-      {
-         if (body1 == NULL)
-         {
-            body1 = &atom->shells[0].orbitals[j];
-            body1 = body1->covalentBody;
-         }
-         else if (body2 == NULL)
-         {
-            body2 = &atom->shells[0].orbitals[j];
-            body2 = body2->covalentBody;
-         }
-         else if (body3 == NULL)
-         {
-            body3 = &atom->shells[0].orbitals[j];
-            body3 = body3->covalentBody;
-         }
-         else if (body4 == NULL)
-         {
-            body4 = &atom->shells[0].orbitals[j];
-            body4 = body4->covalentBody;
-         }
-         else
-         {
-            break;
-         }
-      }
-      if ((body1 == NULL) || (body2 == NULL) ||
-          (body3 == NULL) || (body4 == NULL))
-      {
-         continue;
-      }
-      for (k = 0; k < i2; k++)
-      {
-         if (atoms[k]->getID() == body1->id)
-         {
-            atom1 = atoms[k];
-         }
-         if (atoms[k]->getID() == body2->id)
-         {
-            atom2 = atoms[k];
-         }
-         if (atoms[k]->getID() == body3->id)
-         {
-            atom3 = atoms[k];
-         }
-         if (atoms[k]->getID() == body4->id)
-         {
-            atom4 = atoms[k];
-         }
-      }
-      if ((atom1->number == 6) && (atom2->number == 6) &&
-          (atom3->number == 6) && (atom4->number == 6))
-      {
-         if (((atom1 == atom2) && (atom3 == atom4)) ||
-             ((atom1 == atom3) && (atom2 == atom4)) ||
-             ((atom1 == atom4) && (atom2 == atom3)))
-         {
-            co2++;
-         }
-      }
+      aveSize = (float)speciesRegistry->numAtoms / (float)num;
+   }
+   else
+   {
+      aveSize = 0.0f;
+   }
+   if (numClosed > 0)
+   {
+      aveClosedSize = (float)speciesRegistry->numClosedAtoms / (float)numClosed;
+   }
+   else
+   {
+      aveClosedSize = 0.0f;
    }
-   return(co2);
 }
 
-
-#endif
@@ -26,13 +26,22 @@
 #include <time.h>
 #include <assert.h>
 #include <errno.h>
+#include <string.h>
+#include <ctype.h>
 #include <vector>
+#include <utility>
 #ifdef THREADS
 #include <pthread.h>
 #endif
 #include "parameters.hpp"
 #include "atom.hpp"
+#include "bond.hpp"
+#include "bondEvent.hpp"
 #include "molecule.hpp"
+#include "moleculeTracker.hpp"
+#include "motif.hpp"
+#include "species.hpp"
+#include "reactionNetwork.hpp"
 #include "thermal.hpp"
 #include "../utility/random.hpp"
 #include "../utility/octree.hpp"
@@ -63,6 +72,10 @@ public:
    vector<OctObject *> bodies;
    Octree              *bodyTracker;
 
+   // Covalent bonds.
+   // Bodies index their bond for constant time removal.
+   vector<Bond> bonds;
+
    // Thermal objects.
    vector<Thermal *> thermals;
 
@@ -94,6 +107,17 @@ public:
    // Get atom by ID.
    Atom *getAtom(int id);
 
+   // Get body by atom ID, shell and orbital (-1=nucleus; NULL=invalid).
+   // Used to resolve saved and imported bond endpoints.
+   Body *getBody(int id, int shell, int orbital);
+
+   // Create covalent bond between orbital bodies.
+   // The thread number selects the bond event ring.
+   void createBond(Body *body1, Body *body2, int threadNum = 0);
+
+   // Remove covalent bond of body.
+   void removeBond(Body *body, int threadNum = 0);
+
    // Create thermal object.
    Thermal *createThermal(float radius, Vector& position, float temperature);
 
@@ -103,40 +127,145 @@ public:
    // Update system.
    void update();
 
+   // Bond formation cadence:
+   // Search for bonding pairs every bondCadence updates, keeping
+   // pairs within bonding range plus a guard band that covers how
+   // far bodies can close in the meantime; only those pairs are
+   // checked on the updates in between.
+   int bondCadence;
+   float getBondGuardBand();
+
+   // Force bonding pair search on next update (e.g. after moving bodies).
+   void resetBondSearch();
+
+   // Minimize energy:
+   // Relax bodies under the update forces until the largest body force
+   // is below tolerance or maxSteps is reached, leaving them at rest.
+   // Returns the number of steps taken.
+   static const float DEFAULT_MINIMIZE_TOLERANCE;
+   static const int   DEFAULT_MINIMIZE_STEPS;
+   int minimize(float tolerance = DEFAULT_MINIMIZE_TOLERANCE,
+                int maxSteps    = DEFAULT_MINIMIZE_STEPS);
+
+   // Adaptive update step:
+   // If maxUpdateStep > 0, each update chooses a step within
+   // [minUpdateStep, maxUpdateStep] from the maximum body speed and
+   // force/mass, so that no body moves further than it could at
+   // MAX_TEMPERATURE over UPDATE_STEP. Forces are impulses per
+   // UPDATE_STEP and are scaled to the chosen step.
+   float minUpdateStep;
+   float maxUpdateStep;
+   float getAdaptiveUpdateStep(float acceleration, float speed);
+
+   // Last update step, total simulated time and update cycles.
+   float  updateStep;
+   double updateTime;
+   int    updateCycle;
+
    // Bond updated?
    bool bondUpdate;
 
+   // Bond event log (NULL=disabled).
+   // Bond formations and breaks are recorded with the update cycle.
+   BondEventLog *bondEvents;
+   void logBondEvents(bool enable, int capacity = BondEventLog::DEFAULT_CAPACITY);
+
+   // Get sorted IDs of atoms in molecule containing atom,
+   // optionally with atom counts by atomic number.
+   void getMoleculeIDs(Atom *atom, vector<int>& ids);
+   void getMoleculeIDs(Atom *atom, vector<int>& ids, vector<int>& atomCounts);
+
    // Mark and count atoms in molecule.
    void clearAtomMarks();
    void markMolecule(Atom *atom, vector<int>& atomCounts, int mark);
 
    // Generate molecules.
+   // Molecules are tracked incrementally through bond changes, and only
+   // those whose bond graph version changed since the last generation
+   // are rebuilt and recounted by species.
    vector<Molecule *> molecules;
+   MoleculeTracker    *moleculeTracker;
    void generateMolecules();
 
+   // Generate codes of all molecules.
+   // Update threads share the work for large molecule sets.
+   void codeMolecules();
+
    // Load and save atoms.
+   // Saves are binary snapshots (see snapshot.hpp); loads also accept
+   // the versioned text format, which saveText still writes, and the
+   // earlier unversioned text format.
    void load(FILE *fp);
    void save(FILE *fp);
+   void saveText(FILE *fp);
    void import(FILE *fp);
 
+   // Save binary snapshot appended to buffer.
+   void save(vector<char>& buffer);
+
+   // Molecule species registry, counted by generateMolecules.
+   SpeciesRegistry *speciesRegistry;
+
+   // Set species by formula only (cheap stats without isomer detail).
+   void setSpeciesByFormula(bool byFormula);
+
+   // Reaction network (NULL=disabled), built from the molecules
+   // consumed and produced at each generateMolecules.
+   ReactionNetwork *reactionNetwork;
+   void trackReactions(bool enable);
+
    // Molecule detectors.
    void getMoleculeStats(int& num, int& numClosed,
                          int& numTypes, int& numClosedTypes,
                          float& aveSize, float& aveClosedSize);
 
-#if (O2_MOLECULES)
-   int countO2();
-#endif
-#if (H2O_MOLECULES)
-   int countH2O();
-#endif
-#if (CO2_MOLECULES)
-   int countCO2();
-#endif
+   // Molecular motif counts, kept current through bond changes.
+   MotifIndex *motifIndex;
 
 private:
 
    void update(int threadNum);
+   void updateForces(int threadNum, int threadCount);
+
+   // Bonding pair candidates by thread.
+   vector<vector<pair<Body *, Body *> > > bondCandidates;
+   int bondSearchCountdown;
+
+   // Molecules by root atom ID.
+   vector<Molecule *> rootMolecules;
+
+   // Molecule work shared by threads between updates:
+   // new molecules are built for roots, or molecules are coded.
+   enum MOLECULE_TASK
+   {
+      NO_MOLECULE_TASK = 0,
+      BUILD_MOLECULES  = 1,
+      CODE_MOLECULES   = 2
+   };
+   MOLECULE_TASK      moleculeTask;
+   vector<int>        moleculeRoots;
+   vector<Molecule *> moleculeBuilds;
+   void runMoleculeTask(MOLECULE_TASK task, int numItems);
+   void runMoleculeTask(int threadNum, int threadCount);
+
+   // Atoms by ID.
+   vector<Atom *> atomIndex;
+   void indexAtom(Atom *atom);
+
+   // Insert loaded atom and its bodies.
+   void insertAtom(Atom *atom);
+
+   // Load text and binary snapshot formats.
+   // Text version 0 is the earlier unmarked layout.
+   void loadText(FILE *fp, int version);
+   void loadSnapshot(FILE *fp);
+
+   // Atom visits by ID for molecule search.
+   vector<bool> atomVisits;
+
+   // Adaptive step maximums gathered from threads.
+   float maxAcceleration;
+   float maxSpeed;
 
 #ifdef THREADS
    pthread_barrier_t updateBarrier;
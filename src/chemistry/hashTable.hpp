@@ -0,0 +1,126 @@
+/*
+ * This software is provided under the terms of the GNU General
+ * Public License as published by the Free Software Foundation.
+ *
+ * Copyright (c) 2006-2007 Tom Portegys, All Rights Reserved.
+ * Permission to use, copy, modify, and distribute this software
+ * and its documentation for NON-COMMERCIAL purposes and without
+ * fee is hereby granted provided that this copyright notice
+ * appears in all copies.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.
+ */
+
+/*
+ * Hash table: items bucketed by a 64-bit key.
+ */
+
+#ifndef __HASH_TABLE__
+#define __HASH_TABLE__
+
+#include <vector>
+#include <assert.h>
+using namespace std;
+
+// Fibonacci hashing multiplier.
+#define HASH_TABLE_GOLDEN    0x9e3779b97f4a7c15ULL
+
+namespace affinity
+{
+// Hash table of item pointers bucketed by a 64-bit key.
+// The number of buckets is a power of 2, doubled when the items
+// outnumber the buckets. The bucket is taken from the high bits of
+// the key times the golden ratio, so keys with weak low bits spread.
+template<class T> class HashTable
+{
+public:
+
+   // Buckets.
+   vector<vector<T *> > buckets;
+
+   // Number of items.
+   int size;
+
+   // Constructor: initial number of buckets (power of 2)
+   // and function giving the key of an item.
+   HashTable(int initialBuckets, unsigned long long (*getKey)(T *))
+   {
+      assert(initialBuckets > 0 && (initialBuckets & (initialBuckets - 1)) == 0);
+      this->initialBuckets = initialBuckets;
+      this->getKey         = getKey;
+      clear();
+   }
+
+
+   // Clear.
+   void clear()
+   {
+      buckets.clear();
+      buckets.resize(initialBuckets);
+      for (bits = 0; (1 << bits) < initialBuckets; bits++)
+      {
+      }
+      size = 0;
+   }
+
+
+   // Get bucket of key.
+   vector<T *>& getBucket(unsigned long long key)
+   {
+      return(buckets[getIndex(key)]);
+   }
+
+
+   // Get bucket index of key.
+   int getIndex(unsigned long long key)
+   {
+      if (bits == 0)
+      {
+         return(0);
+      }
+      return((int)((key * HASH_TABLE_GOLDEN) >> (64 - bits)));
+   }
+
+
+   // Insert item.
+   void insert(T *item)
+   {
+      size++;
+      if (size > (int)buckets.size())
+      {
+         rehash();
+      }
+      getBucket(getKey(item)).push_back(item);
+   }
+
+
+private:
+
+   int bits;
+   int initialBuckets;
+   unsigned long long (*getKey)(T *);
+
+   // Double buckets.
+   void rehash()
+   {
+      int i, i2, j, j2;
+
+      vector<vector<T *> > old;
+
+      old.swap(buckets);
+      buckets.resize(old.size() * 2);
+      bits++;
+      for (i = 0, i2 = (int)old.size(); i < i2; i++)
+      {
+         for (j = 0, j2 = (int)old[i].size(); j < j2; j++)
+         {
+            getBucket(getKey(old[i][j])).push_back(old[i][j]);
+         }
+      }
+   }
+};
+}
+#endif
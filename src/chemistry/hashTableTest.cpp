@@ -0,0 +1,175 @@
+/*
+ * This software is provided under the terms of the GNU General
+ * Public License as published by the Free Software Foundation.
+ *
+ * Copyright (c) 2006-2007 Tom Portegys, All Rights Reserved.
+ * Permission to use, copy, modify, and distribute this software
+ * and its documentation for NON-COMMERCIAL purposes and without
+ * fee is hereby granted provided that this copyright notice
+ * appears in all copies.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.
+ */
+
+/**
+ * Hash table regression test.
+ * Species registered well past the initial number of buckets must
+ * stay findable and spread across the grown table, as must keys
+ * differing only in their high bits.
+ */
+
+#include "chemistry.hpp"
+using namespace affinity;
+
+// Number of species registered.
+#define NUM_SPECIES    (INITIAL_SPECIES_BUCKETS * 5)
+
+// Largest acceptable bucket.
+#define MAX_BUCKET     8
+
+// Keyed item.
+struct Item
+{
+   unsigned long long key;
+};
+
+// Get key of item.
+unsigned long long getItemKey(Item *item)
+{
+   return(item->key);
+}
+
+
+// Report failure.
+bool fail(const char *what)
+{
+   fprintf(stderr, "hashTableTest: %s\n", what);
+   return(false);
+}
+
+
+// Check items spread across buckets.
+template<class T> bool checkSpread(HashTable<T> *table, int n)
+{
+   int i, i2, used, largest;
+
+   if ((table->size != n) || ((int)table->buckets.size() < n) ||
+       ((table->buckets.size() & (table->buckets.size() - 1)) != 0))
+   {
+      return(fail("table not grown to a power of 2"));
+   }
+   used = largest = 0;
+   for (i = 0, i2 = (int)table->buckets.size(); i < i2; i++)
+   {
+      if (table->buckets[i].size() > 0)
+      {
+         used++;
+      }
+      if ((int)table->buckets[i].size() > largest)
+      {
+         largest = (int)table->buckets[i].size();
+      }
+   }
+   if ((used < n / 2) || (largest > MAX_BUCKET))
+   {
+      fprintf(stderr, "hashTableTest: %d items in %d of %d buckets, largest %d\n",
+              n, used, (int)table->buckets.size(), largest);
+      return(false);
+   }
+   return(true);
+}
+
+
+// Register species of distinct formulas and check spread.
+bool checkSpecies()
+{
+   int             i;
+   bool            result;
+   Chemistry       *chemistry;
+   SpeciesRegistry *registry;
+   Molecule        *molecule;
+
+   vector<int>        ids;
+   vector<Molecule *> molecules;
+
+#ifdef THREADS
+   chemistry = new Chemistry(15.0f, (RANDOM)7, 1);
+#else
+   chemistry = new Chemistry(15.0f, (RANDOM)7);
+#endif
+   assert(chemistry != NULL);
+   chemistry->init(NUM_SPECIES);
+   registry = new SpeciesRegistry(true);
+   assert(registry != NULL);
+
+   // Growing atom sets give distinct formulas.
+   for (i = 0; i < NUM_SPECIES; i++)
+   {
+      ids.push_back(chemistry->atoms[i]->getID());
+      molecule = new Molecule(chemistry, ids);
+      assert(molecule != NULL);
+      molecules.push_back(molecule);
+      registry->insert(molecule, false, 0);
+   }
+   result = true;
+   if ((int)registry->species.size() != NUM_SPECIES)
+   {
+      result = fail("species formulas collided");
+   }
+   for (i = 0; i < NUM_SPECIES && result; i++)
+   {
+      if (registry->find(molecules[i], false) != registry->species[i])
+      {
+         result = fail("species not found");
+      }
+   }
+   if (result)
+   {
+      result = checkSpread(registry->table, NUM_SPECIES);
+   }
+   for (i = 0; i < NUM_SPECIES; i++)
+   {
+      delete molecules[i];
+   }
+   delete registry;
+   delete chemistry;
+   return(result);
+}
+
+
+// Insert keys differing only in their high bits and check spread.
+bool checkHighBits()
+{
+   int             i;
+   bool            result;
+   HashTable<Item> *table;
+
+   vector<Item> items;
+
+   table = new HashTable<Item>(INITIAL_SPECIES_BUCKETS, getItemKey);
+   assert(table != NULL);
+   items.resize(NUM_SPECIES);
+   for (i = 0; i < NUM_SPECIES; i++)
+   {
+      items[i].key = (unsigned long long)i << 40;
+      table->insert(&items[i]);
+   }
+   result = checkSpread(table, NUM_SPECIES);
+   delete table;
+   return(result);
+}
+
+
+int
+main(int argc, char *argv[])
+{
+   if (!checkSpecies() || !checkHighBits())
+   {
+      return(1);
+   }
+   printf("hashTableTest passed\n");
+   return(0);
+}
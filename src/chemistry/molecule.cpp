@@ -22,40 +22,86 @@
 #include "chemistry.hpp"
 using namespace affinity;
 
+// Hash lanes: each 64-bit half of a molecule code is refined and
+// hashed in its own lane, with its own seed, offset and mixing.
+#define HASH_LANES    2
+static const unsigned long long HashSeed[HASH_LANES]   = { 0x243f6a8885a308d3ULL, 0x13198a2e03707344ULL };
+static const unsigned long long HashGolden[HASH_LANES] = { 0x9e3779b97f4a7c15ULL, 0xc2b2ae3d27d4eb4fULL };
+static const unsigned long long HashMix1[HASH_LANES]   = { 0xbf58476d1ce4e5b9ULL, 0xff51afd7ed558ccdULL };
+static const unsigned long long HashMix2[HASH_LANES]   = { 0x94d049bb133111ebULL, 0xc4ceb9fe1a85ec53ULL };
+static const int                HashShift1[HASH_LANES] = { 30, 33 };
+static const int                HashShift2[HASH_LANES] = { 27, 29 };
+static const int                HashShift3[HASH_LANES] = { 31, 32 };
+
+// Mix 64-bit hash in lane.
+static unsigned long long mixHash(unsigned long long h, int lane = 0)
+{
+   h ^= h >> HashShift1[lane];
+   h *= HashMix1[lane];
+   h ^= h >> HashShift2[lane];
+   h *= HashMix2[lane];
+   h ^= h >> HashShift3[lane];
+   return(h);
+}
+
+
+// Combine value into 64-bit hash in lane.
+static unsigned long long combineHash(unsigned long long h, unsigned long long v, int lane = 0)
+{
+   return(mixHash(h ^ mixHash(v + HashGolden[lane], lane), lane));
+}
+
+
+// Count distinct colors.
+static int countColors(vector<unsigned long long>& colors,
+                       vector<unsigned long long>& work)
+{
+   work = colors;
+   sort(work.begin(), work.end());
+   return((int)(unique(work.begin(), work.end()) - work.begin()));
+}
+
+
 // Constructor.
 // Analyze molecule given a component atom.
 Molecule::Molecule(Chemistry *chemistry, Atom *atom)
 {
-   int i, i2;
-
-   vector<Atom *> atoms;
-   AtomTree       *root, *child;
+   vector<int> atomCounts;
 
    // Save chemistry.
    this->chemistry = chemistry;
+   version         = -1;
+   species         = NULL;
+   index           = -1;
+   coded           = false;
+
+   // Get component atom IDs and formula.
+   chemistry->getMoleculeIDs(atom, atomIDs, atomCounts);
+   formula = getFormula(atomCounts);
+}
 
-   // Get component atom IDs.
-   getIDs(atom, atomIDs);
 
-   // Sort atoms by atomic number.
-   for (i = 0, i2 = (int)atomIDs.size(); i < i2; i++)
-   {
-      atoms.push_back(chemistry->getAtom(atomIDs[i]));
-   }
-   sort(atoms.begin(), atoms.end(), ltcmpAtoms);
+// Construct molecule from its atom IDs.
+// Uses no shared search state, so molecules may be built concurrently.
+Molecule::Molecule(Chemistry *chemistry, vector<int>& atomIDs)
+{
+   int i, i2;
 
-   // Generate code for molecule using atom trees for each atom.
-   root = new AtomTree(chemistry);
-   assert(root != NULL);
-   for (i = 0, i2 = (int)atoms.size(); i < i2; i++)
+   vector<int> atomCounts;
+
+   this->chemistry = chemistry;
+   version         = -1;
+   species         = NULL;
+   index           = -1;
+   coded           = false;
+   this->atomIDs   = atomIDs;
+   sort(this->atomIDs.begin(), this->atomIDs.end());
+   atomCounts.resize(chemistry->parameters->MAX_NUCLEUS_PROTONS + 1, 0);
+   for (i = 0, i2 = (int)this->atomIDs.size(); i < i2; i++)
    {
-      child = new AtomTree(chemistry, atoms[i]);
-      assert(child != NULL);
-      root->children.push_back(child);
+      atomCounts[chemistry->getAtom(this->atomIDs[i])->number]++;
    }
-   root->generateCode();
-   memcpy(code, root->code, MD5_SIZE);
-   delete root;
+   formula = getFormula(atomCounts);
 }
 
 
@@ -100,20 +146,13 @@ bool Molecule::contains(Body *body)
 // Molecule is "closed" (all bonds connected)?
 bool Molecule::isClosed()
 {
-   int  i, i2, j, j2, s;
-   Atom *atom;
+   int i, i2;
 
    for (i = 0, i2 = (int)atomIDs.size(); i < i2; i++)
    {
-      atom = chemistry->getAtom(atomIDs[i]);
-      s    = (int)atom->shells.size() - 1;
-      for (j = 0, j2 = (int)atom->shells[s].orbitals.size(); j < j2; j++)
+      if (isOpen(chemistry->getAtom(atomIDs[i])))
       {
-         if (atom->shells[s].orbitals[j].hasValence &&
-             (atom->shells[s].orbitals[j].covalentBody == NULL))
-         {
-            return(false);
-         }
+         return(false);
       }
    }
    return(true);
@@ -123,7 +162,13 @@ bool Molecule::isClosed()
 // Compare molecules by code.
 bool Molecule::equals(Molecule *molecule)
 {
-   if (memcmp(code, molecule->code, MD5_SIZE) == 0)
+   if (formula != molecule->formula)
+   {
+      return(false);
+   }
+   generateCode();
+   molecule->generateCode();
+   if (memcmp(code, molecule->code, MOLECULE_CODE_SIZE) == 0)
    {
       return(true);
    }
@@ -157,8 +202,9 @@ void Molecule::print(FILE *fp)
       fprintf(fp, "%d/%d ", atomIDs[i], chemistry->getAtom(atomIDs[i])->number);
    }
    fprintf(fp, "\n");
+   generateCode();
    fprintf(fp, "Code: ");
-   for (i = 0; i < MD5_SIZE; i++)
+   for (i = 0; i < MOLECULE_CODE_SIZE; i++)
    {
       fprintf(fp, "%d ", code[i]);
    }
@@ -169,266 +215,276 @@ void Molecule::print(FILE *fp)
 // Get component atom IDs.
 void Molecule::getIDs(Atom *atom, vector<int>& ids)
 {
-   int  i, i2, j, j2;
-   Body *body;
+   chemistry->getMoleculeIDs(atom, ids);
+}
+
+
+// Less-than comparison of molecules by lowest atom ID.
+bool Molecule::ltcmpMolecules(Molecule *a, Molecule *b)
+{
+   return(a->atomIDs[0] < b->atomIDs[0]);
+}
+
 
-   for (i = 0, i2 = (int)ids.size(); i < i2; i++)
+// Get bond graph.
+void Molecule::getGraph(MoleculeGraph& graph)
+{
+   int  i, i2, j, j2, k;
+   Atom *atom;
+
+   vector<int>             numbers, ids;
+   vector<pair<int, int> > bonds;
+
+   for (i = 0, i2 = (int)atomIDs.size(); i < i2; i++)
    {
-      if (ids[i] == atom->getID())
+      atom = chemistry->getAtom(atomIDs[i]);
+      numbers.push_back(atom->number);
+      getBondedIDs(atom, ids);
+      for (j = 0, j2 = (int)ids.size(); j < j2; j++)
       {
-         return;
+         k = (int)(lower_bound(atomIDs.begin(), atomIDs.end(), ids[j]) - atomIDs.begin());
+         if (i < k)
+         {
+            bonds.push_back(pair<int, int>(i, k));
+         }
       }
    }
-   ids.push_back(atom->getID());
-   sort(ids.begin(), ids.end());
+   graph.build(numbers, bonds);
+}
+
 
-   // Get connected atom IDs.
-   i = (int)atom->shells.size() - 1;
-   for (j = 0, j2 = (int)atom->shells[i].orbitals.size(); j < j2; j++)
+// Get IDs of atoms bonded to the outer shell of atom, an ID per bond.
+void Molecule::getBondedIDs(Atom *atom, vector<int>& ids)
+{
+   int  i, i2, s;
+   Body *body;
+
+   ids.clear();
+   s = (int)atom->shells.size() - 1;
+   for (i = 0, i2 = (int)atom->shells[s].orbitals.size(); i < i2; i++)
    {
-      if ((body = atom->shells[i].orbitals[j].covalentBody) != NULL)
+      if ((body = atom->shells[s].orbitals[i].covalentBody) != NULL)
       {
-         getIDs(chemistry->getAtom(body->id), ids);
+         ids.push_back(body->id);
       }
    }
 }
 
 
-// Less-than comparison atoms by atomic number.
-bool Molecule::ltcmpAtoms(Atom *a, Atom *b)
+// Atom has an unbonded valence orbital?
+bool Molecule::isOpen(Atom *atom)
 {
-   return(a->number < b->number);
+   int i, i2, s;
+
+   s = (int)atom->shells.size() - 1;
+   for (i = 0, i2 = (int)atom->shells[s].orbitals.size(); i < i2; i++)
+   {
+      if (atom->shells[s].orbitals[i].hasValence &&
+          (atom->shells[s].orbitals[i].covalentBody == NULL))
+      {
+         return(true);
+      }
+   }
+   return(false);
 }
 
 
-// Atom tree constructor.
-Molecule::AtomTree::AtomTree(Chemistry *chemistry, Atom *atom)
+// Generate code if not yet coded.
+void Molecule::generateCode()
 {
-   this->chemistry = chemistry;
-   this->atom      = atom;
-   if (atom == NULL)
-   {
-      parentBonds = 0;
-   }
-   else
+   MoleculeGraph graph;
+
+   if (!coded)
    {
-      parentBonds = 1;
+      getGraph(graph);
+      graph.generateCode(code);
+      coded = true;
    }
-   expanded = false;
 }
 
 
-// Atom tree destructor.
-Molecule::AtomTree::~AtomTree()
+// Get formula of atom counts by atomic number.
+unsigned long long Molecule::getFormula(vector<int>& atomCounts)
 {
-   int i, i2;
+   int                i, i2;
+   unsigned long long h;
 
-   for (i = 0, i2 = (int)children.size(); i < i2; i++)
+   h = HashSeed[0];
+   for (i = 0, i2 = (int)atomCounts.size(); i < i2; i++)
    {
-      delete children[i];
+      if (atomCounts[i] > 0)
+      {
+         h = combineHash(h, (unsigned long long)i);
+         h = combineHash(h, (unsigned long long)atomCounts[i]);
+      }
    }
-   children.clear();
+   return(h);
 }
 
 
-// Generate code.
-void Molecule::AtomTree::generateCode(bool hashNumbers)
+// Build from atomic numbers and bonds as atom index pairs.
+void MoleculeGraph::build(vector<int>& numbers, vector<pair<int, int> >& bonds)
 {
-   int               i, j, s;
-   struct MD5Context md5c;
-   unsigned char     *input;
+   int i, i2, a, n;
+
+   vector<pair<int, int> > edges;
 
-   // Root?
-   s = (int)children.size();
-   if (atom == NULL)
+   n = (int)numbers.size();
+   for (i = 0, i2 = (int)bonds.size(); i < i2; i++)
+   {
+      edges.push_back(pair<int, int>(bonds[i].first, bonds[i].second));
+      edges.push_back(pair<int, int>(bonds[i].second, bonds[i].first));
+   }
+   sort(edges.begin(), edges.end());
+   this->numbers = numbers;
+   edgeStart.resize(n + 1);
+   edgeAtom.clear();
+   edgeBonds.clear();
+   for (a = i = 0, i2 = (int)edges.size(); a < n; a++)
    {
-      // Iteratively expand children until either fully
-      // expanded or all have distinct codes.
-      vector<int> path;
-      while (true)
+      edgeStart[a] = (int)edgeAtom.size();
+      for ( ; (i < i2) && (edges[i].first == a); i++)
       {
-         // Generate codes without labels to encode structure at this point.
-         for (i = 0; i < s; i++)
+         if ((i > 0) && (edges[i] == edges[i - 1]))
          {
-            children[i]->generateCode(false);
+            edgeBonds.back()++;
          }
-         sort(children.begin(), children.end(), ltcmpCode);
-         for (i = 0; i < s - 1; i++)
+         else
          {
-            if (!children[i]->expanded && (ltcmpCode(children[i], children[i + 1]) == 0))
-            {
-               break;
-            }
-         }
-         if (i == s - 1)
-         {
-            break;
-         }
-         for (j = i + 2; j < s && ltcmpCode(children[i], children[j]) == 0; j++)
-         {
-         }
-         for ( ; i < j; i++)
-         {
-            path.clear();
-            children[i]->expand(path);
+            edgeAtom.push_back(edges[i].second);
+            edgeBonds.push_back(1);
          }
       }
    }
+   edgeStart[n] = (int)edgeAtom.size();
+}
 
-   // Recursively generate code.
-   for (i = 0; i < s; i++)
-   {
-      children[i]->generateCode();
-   }
-   sort(children.begin(), children.end(), ltcmpCode);
-   MD5Init(&md5c);
-   j = 0;
-   if (atom != NULL)
+
+// Get connected components.
+void MoleculeGraph::getComponents(vector<int>& start, vector<int>& atoms)
+{
+   int i, i2, j, k, k2, n;
+
+   vector<bool> visited;
+
+   n = (int)numbers.size();
+   start.clear();
+   atoms.clear();
+   visited.resize(n, false);
+   for (i = 0; i < n; i++)
    {
-      if (hashNumbers)
+      if (visited[i])
       {
-         j = 2;
+         continue;
       }
-      else
+      start.push_back((int)atoms.size());
+      atoms.push_back(i);
+      visited[i] = true;
+      for (j = start.back(); j < (int)atoms.size(); j++)
       {
-         j = 1;
+         for (k = edgeStart[atoms[j]], k2 = edgeStart[atoms[j] + 1]; k < k2; k++)
+         {
+            if (!visited[edgeAtom[k]])
+            {
+               visited[edgeAtom[k]] = true;
+               atoms.push_back(edgeAtom[k]);
+            }
+         }
       }
+      sort(atoms.begin() + start.back(), atoms.end());
    }
-   input = new unsigned char[(s * MD5_SIZE) + j];
-   assert(input != NULL);
-   if (atom != NULL)
+   start.push_back((int)atoms.size());
+}
+
+
+// Get subgraph of ascending atom indices.
+void MoleculeGraph::getSubgraph(vector<int>& atoms, int begin, int end,
+                                MoleculeGraph& subgraph)
+{
+   int i, j, j2, k;
+
+   subgraph.numbers.resize(end - begin);
+   subgraph.edgeStart.resize(end - begin + 1);
+   subgraph.edgeAtom.clear();
+   subgraph.edgeBonds.clear();
+   for (i = begin; i < end; i++)
    {
-      if (hashNumbers)
+      subgraph.numbers[i - begin]   = numbers[atoms[i]];
+      subgraph.edgeStart[i - begin] = (int)subgraph.edgeAtom.size();
+      for (j = edgeStart[atoms[i]], j2 = edgeStart[atoms[i] + 1]; j < j2; j++)
       {
-         input[0] = (unsigned char)atom->number;
-         input[1] = (unsigned char)parentBonds;
-      }
-      else
-      {
-         input[0] = (unsigned char)parentBonds;
+         k = (int)(lower_bound(atoms.begin() + begin, atoms.begin() + end,
+                               edgeAtom[j]) - atoms.begin());
+         if ((k < end) && (atoms[k] == edgeAtom[j]))
+         {
+            subgraph.edgeAtom.push_back(k - begin);
+            subgraph.edgeBonds.push_back(edgeBonds[j]);
+         }
       }
    }
-   for (i = 0; i < s; i++)
-   {
-      memcpy(&input[j], children[i]->code, MD5_SIZE);
-      j += MD5_SIZE;
-   }
-   MD5Update(&md5c, input, j);
-   MD5Final(code, &md5c);
-   delete input;
+   subgraph.edgeStart[end - begin] = (int)subgraph.edgeAtom.size();
 }
 
 
-// Expand tree one level deeper.
-void Molecule::AtomTree::expand(vector<int>& path)
+// Generate code by refining atom colors with bonded neighbor colors
+// until the coloring is stable, then hashing the sorted colors.
+// Each lane refines and hashes independently into its code half.
+void MoleculeGraph::generateCode(unsigned char *code)
 {
-   int      i, i2, j, j2, k, id;
-   Body     *body;
-   AtomTree *child;
+   int                i, i2, j, j2, n, lane, round, count, count2;
+   unsigned long long h;
 
-   vector<int>        path2;
-   vector<AtomTree *> tmpTree;
+   vector<unsigned long long> colors, colors2, work;
 
-   if (expanded)
-   {
-      return;
-   }
-   expanded = true;
-   if (children.size() == 0)
+   n = (int)numbers.size();
+   colors.resize(n);
+   colors2.resize(n);
+   for (lane = 0; lane < HASH_LANES; lane++)
    {
-      // Expand this level.
-      i = (int)atom->shells.size() - 1;
-      for (j = 0, j2 = (int)atom->shells[i].orbitals.size(); j < j2; j++)
+      for (i = 0; i < n; i++)
       {
-         if ((body = atom->shells[i].orbitals[j].covalentBody) != NULL)
-         {
-            child = new AtomTree(chemistry, chemistry->getAtom(body->id));
-            assert(child != NULL);
-            children.push_back(child);
-         }
+         colors[i] = mixHash((unsigned long long)numbers[i] + HashGolden[lane], lane);
       }
 
-      // Consolidate multiple bonds.
-      for (i = 0, i2 = (int)children.size(); i < i2; i++)
+      // Refine colors until the number of color classes stops growing.
+      count = countColors(colors, work);
+      for (round = 0; round < n; round++)
       {
-         if (children[i] == NULL)
-         {
-            continue;
-         }
-         for (j = i + 1, k = 0; j < i2; j++)
+         for (i = 0; i < n; i++)
          {
-            if (children[j] == NULL)
+            work.clear();
+            for (j = edgeStart[i], j2 = edgeStart[i + 1]; j < j2; j++)
             {
-               continue;
+               work.push_back(combineHash(colors[edgeAtom[j]],
+                                          (unsigned long long)edgeBonds[j], lane));
             }
-            if (children[i]->atom->getID() == children[j]->atom->getID())
+            sort(work.begin(), work.end());
+            h = colors[i];
+            for (j = 0, j2 = (int)work.size(); j < j2; j++)
             {
-               k++;
-               delete children[j];
-               children[j] = NULL;
+               h = combineHash(h, work[j], lane);
             }
+            colors2[i] = h;
          }
-         children[i]->parentBonds += k;
-      }
-      for (i = 0; i < i2; i++)
-      {
-         if (children[i] != NULL)
+         colors.swap(colors2);
+         count2 = countColors(colors, work);
+         if (count2 == count)
          {
-            tmpTree.push_back(children[i]);
+            break;
          }
+         count = count2;
       }
-      children.clear();
-      for (i = 0, i2 = (int)tmpTree.size(); i < i2; i++)
-      {
-         children.push_back(tmpTree[i]);
-      }
-      if (children.size() > 0)
-      {
-         expanded = false;
-      }
-   }
-   else
-   {
-      // Expand deeper.
-      id = atom->getID();
-      for (i = 0, i2 = (int)path.size(); i < i2; i++)
+
+      // Hash sorted colors into the lane's code half.
+      sort(colors.begin(), colors.end());
+      h = HashSeed[lane];
+      for (i = 0, i2 = (int)colors.size(); i < i2; i++)
       {
-         if (id == path[i])
-         {
-            break;
-         }
+         h = combineHash(h, colors[i], lane);
       }
-      if (i == i2)
+      for (i = 0; i < 8; i++)
       {
-         path.push_back(id);
-         for (i = 0, i2 = (int)children.size(); i < i2; i++)
-         {
-            id = children[i]->atom->getID();
-            path2.clear();
-            for (j = 0, j2 = (int)path.size(); j < j2; j++)
-            {
-               path2.push_back(path[j]);
-            }
-            children[i]->expand(path2);
-            if (!children[i]->expanded)
-            {
-               expanded = false;
-            }
-         }
+         code[(lane * 8) + i] = (unsigned char)(h >> (i * 8));
       }
    }
 }
-
-
-// Less-than comparison by code.
-bool Molecule::AtomTree::ltcmpCode(AtomTree *a, AtomTree *b)
-{
-   if (memcmp(a->code, b->code, MD5_SIZE) < 0)
-   {
-      return(true);
-   }
-   else
-   {
-      return(false);
-   }
-}
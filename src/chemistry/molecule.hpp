@@ -25,14 +25,51 @@
 #include <stdlib.h>
 #include <vector>
 #include <algorithm>
+#include <utility>
 #include <assert.h>
 #include "atom.hpp"
-#include "../utility/md5.h"
 using namespace std;
 
+// Molecule code size (128 bits).
+#define MOLECULE_CODE_SIZE    16
+
 namespace affinity
 {
 class Chemistry;
+class Species;
+
+// Molecule graph: flat bond graph over atom indices.
+class MoleculeGraph
+{
+public:
+
+   // Atomic numbers.
+   vector<int> numbers;
+
+   // Bonds of atom i are edgeStart[i] to edgeStart[i+1]-1,
+   // giving bonded atom index and bond multiplicity.
+   vector<int> edgeStart;
+   vector<int> edgeAtom;
+   vector<int> edgeBonds;
+
+   // Build from atomic numbers and bonds as atom index pairs, a pair
+   // per bond. Bonds between the same atoms merge into a multiplicity.
+   void build(vector<int>& numbers, vector<pair<int, int> >& bonds);
+
+   // Get connected components as runs of ascending atom indices:
+   // component i is atoms[start[i]] to atoms[start[i+1]-1].
+   void getComponents(vector<int>& start, vector<int>& atoms);
+
+   // Get subgraph of ascending atom indices atoms[begin] to
+   // atoms[end-1], indexed by position in the run.
+   void getSubgraph(vector<int>& atoms, int begin, int end,
+                    MoleculeGraph& subgraph);
+
+   // Generate code by refining atom colors with bonded neighbor colors
+   // until the coloring is stable, then hashing the sorted colors.
+   // Each 64-bit code half comes from its own independent hash lane.
+   void generateCode(unsigned char *code);
+};
 
 // Molecule: a bonded graph of atoms.
 class Molecule
@@ -42,11 +79,23 @@ public:
    // Molecule atom IDs.
    vector<int> atomIDs;
 
-   // Unique molecule code.
-   unsigned char code[MD5_SIZE];
+   // Formula: hash of atom counts by atomic number.
+   unsigned long long formula;
+
+   // Unique molecule code, generated on demand.
+   unsigned char code[MOLECULE_CODE_SIZE];
+   bool          coded;
+
+   // Bond graph version the code was generated from.
+   int version;
 
-   // Constructor.
+   // Species and index in chemistry molecules (-1=none).
+   Species *species;
+   int     index;
+
+   // Constructors.
    Molecule(Chemistry *chemistry, Atom *atom);
+   Molecule(Chemistry *chemistry, vector<int>& atomIDs);
 
    // Destructor.
    ~Molecule();
@@ -69,36 +118,29 @@ public:
    // Print.
    void print(FILE *fp = stdout);
 
+   // Less-than comparison of molecules by lowest atom ID.
+   static bool ltcmpMolecules(Molecule *a, Molecule *b);
+
    // Chemistry.
    Chemistry *chemistry;
 
    // Get component atom IDs.
    void getIDs(Atom *, vector<int>& ids);
 
-   // Less-than comparison of atoms by atomic number.
-   static bool ltcmpAtoms(Atom *a, Atom *b);
-
-   // Atom with its subtree of atoms.
-   class AtomTree
-   {
-public:
+   // Get bond graph.
+   void getGraph(MoleculeGraph& graph);
 
-      Chemistry          *chemistry;
-      Atom               *atom;
-      int                parentBonds;
-      unsigned char      code[MD5_SIZE];
-      vector<AtomTree *> children;
-      AtomTree(Chemistry *, Atom *atom = NULL);
-      ~AtomTree();
-      void generateCode(bool hashNumbers = true);
+   // Generate code if not yet coded.
+   void generateCode();
 
-      bool expanded;
-      void expand(vector<int>& path);
+   // Get formula of atom counts by atomic number.
+   static unsigned long long getFormula(vector<int>& atomCounts);
 
-private:
+   // Get IDs of atoms bonded to the outer shell of atom, an ID per bond.
+   static void getBondedIDs(Atom *atom, vector<int>& ids);
 
-      static bool ltcmpCode(AtomTree *a, AtomTree *b);
-   };
+   // Atom has an unbonded valence orbital?
+   static bool isOpen(Atom *atom);
 };
 }
 #endif
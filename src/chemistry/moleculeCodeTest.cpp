@@ -0,0 +1,137 @@
+/*
+ * This software is provided under the terms of the GNU General
+ * Public License as published by the Free Software Foundation.
+ *
+ * Copyright (c) 2006-2007 Tom Portegys, All Rights Reserved.
+ * Permission to use, copy, modify, and distribute this software
+ * and its documentation for NON-COMMERCIAL purposes and without
+ * fee is hereby granted provided that this copyright notice
+ * appears in all copies.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.
+ */
+
+/**
+ * Molecule code regression test.
+ * The corpus holds molecule bond graphs from seeded runs, each with
+ * the code the earlier MD5 atom tree scheme gave it, and each also
+ * with its atoms relabeled. Color refinement codes must divide the
+ * corpus into the same equivalence classes as the MD5 codes.
+ *
+ * Corpus line: <MD5 code hex> <atoms> <atomic numbers>
+ *              <bonds> <atom index> <atom index> <multiplicity>...
+ */
+
+#include "molecule.hpp"
+#include <map>
+#include <string>
+using namespace affinity;
+
+// Default corpus file.
+#define CORPUS_FILE    "moleculeCodes.txt"
+
+// Read corpus graph (false=end).
+bool readGraph(FILE *fp, string& md5code, MoleculeGraph& graph)
+{
+   int  i, j, n, m, a, b, bonds;
+   char hex[MOLECULE_CODE_SIZE * 2 + 1];
+
+   vector<vector<pair<int, int> > > edges;
+
+   if (fscanf(fp, "%32s %d", hex, &n) != 2)
+   {
+      return(false);
+   }
+   md5code = hex;
+   graph.numbers.resize(n);
+   for (i = 0; i < n; i++)
+   {
+      if (fscanf(fp, "%d", &graph.numbers[i]) != 1)
+      {
+         return(false);
+      }
+   }
+   if (fscanf(fp, "%d", &m) != 1)
+   {
+      return(false);
+   }
+   edges.resize(n);
+   for (i = 0; i < m; i++)
+   {
+      if ((fscanf(fp, "%d %d %d", &a, &b, &bonds) != 3) ||
+          (a < 0) || (a >= n) || (b < 0) || (b >= n))
+      {
+         return(false);
+      }
+      edges[a].push_back(pair<int, int>(b, bonds));
+      edges[b].push_back(pair<int, int>(a, bonds));
+   }
+   graph.edgeStart.resize(n + 1);
+   graph.edgeAtom.clear();
+   graph.edgeBonds.clear();
+   for (i = 0; i < n; i++)
+   {
+      sort(edges[i].begin(), edges[i].end());
+      graph.edgeStart[i] = (int)graph.edgeAtom.size();
+      for (j = 0; j < (int)edges[i].size(); j++)
+      {
+         graph.edgeAtom.push_back(edges[i][j].first);
+         graph.edgeBonds.push_back(edges[i][j].second);
+      }
+   }
+   graph.edgeStart[n] = (int)graph.edgeAtom.size();
+   return(true);
+}
+
+
+int
+main(int argc, char *argv[])
+{
+   int           count;
+   FILE          *fp;
+   string        md5code, code;
+   MoleculeGraph graph;
+   unsigned char buf[MOLECULE_CODE_SIZE];
+
+   map<string, string> md5ToCode, codeToMd5;
+   map<string, string>::iterator itr;
+
+   if ((fp = fopen(argc > 1 ? argv[1] : CORPUS_FILE, "r")) == NULL)
+   {
+      fprintf(stderr, "moleculeCodeTest: cannot open corpus\n");
+      return(1);
+   }
+   for (count = 0; readGraph(fp, md5code, graph); count++)
+   {
+      graph.generateCode(buf);
+      code = string((char *)buf, MOLECULE_CODE_SIZE);
+
+      // Each MD5 class must map to one code, and each code to one MD5 class.
+      if (((itr = md5ToCode.find(md5code)) != md5ToCode.end()) && (itr->second != code))
+      {
+         fprintf(stderr, "moleculeCodeTest: graph %d: MD5 class split\n", count);
+         fclose(fp);
+         return(1);
+      }
+      if (((itr = codeToMd5.find(code)) != codeToMd5.end()) && (itr->second != md5code))
+      {
+         fprintf(stderr, "moleculeCodeTest: graph %d: MD5 classes merged\n", count);
+         fclose(fp);
+         return(1);
+      }
+      md5ToCode[md5code] = code;
+      codeToMd5[code]    = md5code;
+   }
+   if (!feof(fp) || (count == 0))
+   {
+      fprintf(stderr, "moleculeCodeTest: invalid corpus\n");
+      fclose(fp);
+      return(1);
+   }
+   fclose(fp);
+   printf("moleculeCodeTest passed: %d graphs, %d classes\n", count, (int)md5ToCode.size());
+   return(0);
+}
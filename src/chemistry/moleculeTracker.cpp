@@ -0,0 +1,266 @@
+/*
+ * This software is provided under the terms of the GNU General
+ * Public License as published by the Free Software Foundation.
+ *
+ * Copyright (c) 2006-2007 Tom Portegys, All Rights Reserved.
+ * Permission to use, copy, modify, and distribute this software
+ * and its documentation for NON-COMMERCIAL purposes and without
+ * fee is hereby granted provided that this copyright notice
+ * appears in all copies.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.
+ */
+
+
+/*
+ * Molecule tracker: incremental connected components of bonded atoms.
+ */
+
+#include "moleculeTracker.hpp"
+#include "chemistry.hpp"
+using namespace affinity;
+
+// Constructor.
+MoleculeTracker::MoleculeTracker(Chemistry *chemistry)
+{
+   this->chemistry = chemistry;
+   versionFactory  = 0;
+}
+
+
+// Clear.
+void MoleculeTracker::clear()
+{
+   roots.clear();
+   members.clear();
+   versions.clear();
+   changedRoots.clear();
+   changed.clear();
+   brokenRoots.clear();
+   broken.clear();
+}
+
+
+// Grow tables to contain atom ID.
+void MoleculeTracker::grow(int id)
+{
+   int n;
+
+   assert(id >= 0);
+   if (id >= (int)roots.size())
+   {
+      n = id + 1;
+      if (n < 2 * (int)roots.size())
+      {
+         n = 2 * (int)roots.size();
+      }
+      roots.resize(n, -1);
+      members.resize(n);
+      versions.resize(n, -1);
+      changed.resize(n, false);
+      broken.resize(n, false);
+   }
+}
+
+
+// Note changed molecule.
+void MoleculeTracker::setChanged(int root)
+{
+   versions[root] = versionFactory;
+   versionFactory++;
+   if (!changed[root])
+   {
+      changed[root] = true;
+      changedRoots.push_back(root);
+   }
+}
+
+
+// Add atom as its own molecule.
+void MoleculeTracker::addAtom(int id)
+{
+   grow(id);
+   roots[id] = id;
+   members[id].clear();
+   members[id].push_back(id);
+   setChanged(id);
+}
+
+
+// Remove atom.
+// The atom is expected to have no bonds; it is dropped when its
+// molecule is next re-split.
+void MoleculeTracker::removeAtom(int id)
+{
+   int root;
+
+   if ((root = getRoot(id)) == -1)
+   {
+      return;
+   }
+   roots[id] = -1;
+   if (!broken[root])
+   {
+      broken[root] = true;
+      brokenRoots.push_back(root);
+   }
+   setChanged(root);
+}
+
+
+// Bond atoms, uniting their molecules.
+void MoleculeTracker::bond(int id, int id2)
+{
+   int i, i2, root, root2, t;
+
+   root  = getRoot(id);
+   root2 = getRoot(id2);
+   assert(root != -1 && root2 != -1);
+   setChanged(root);
+   if (root == root2)
+   {
+      return;
+   }
+   setChanged(root2);
+
+   // Relabel smaller molecule.
+   if (members[root].size() < members[root2].size())
+   {
+      t     = root;
+      root  = root2;
+      root2 = t;
+   }
+   vector<int>& from = members[root2];
+   vector<int>& to   = members[root];
+   for (i = 0, i2 = (int)from.size(); i < i2; i++)
+   {
+      if (roots[from[i]] == root2)
+      {
+         roots[from[i]] = root;
+      }
+      to.push_back(from[i]);
+   }
+   from.clear();
+   if (broken[root2])
+   {
+      broken[root2] = false;
+      if (!broken[root])
+      {
+         broken[root] = true;
+         brokenRoots.push_back(root);
+      }
+   }
+}
+
+
+// Unbond atoms, flagging their molecule for re-split.
+void MoleculeTracker::unbond(int id, int id2)
+{
+   int root;
+
+   root = getRoot(id);
+   assert(root != -1 && root == getRoot(id2));
+   if (!broken[root])
+   {
+      broken[root] = true;
+      brokenRoots.push_back(root);
+   }
+   setChanged(root);
+}
+
+
+// Re-split broken molecule into connected molecules.
+void MoleculeTracker::split(int root)
+{
+   int         i, i2, j, j2, id;
+   vector<int> ids;
+
+   // Unlabel members, dropping removed atoms.
+   ids.swap(members[root]);
+   for (i = 0, i2 = (int)ids.size(); i < i2; i++)
+   {
+      if (roots[ids[i]] != -1)
+      {
+         roots[ids[i]] = -2;
+      }
+   }
+
+   // Relabel molecules found from unlabeled members.
+   for (i = 0, i2 = (int)ids.size(); i < i2; i++)
+   {
+      id = ids[i];
+      if (roots[id] != -2)
+      {
+         continue;
+      }
+      vector<int>& molecule = members[id];
+      chemistry->getMoleculeIDs(chemistry->getAtom(id), molecule);
+      for (j = 0, j2 = (int)molecule.size(); j < j2; j++)
+      {
+         roots[molecule[j]] = id;
+      }
+      setChanged(id);
+   }
+}
+
+
+// Refresh molecules, returning IDs of changed molecule roots.
+void MoleculeTracker::refresh(vector<int>& changedIDs)
+{
+   int i, i2, root;
+
+   for (i = 0, i2 = (int)brokenRoots.size(); i < i2; i++)
+   {
+      root = brokenRoots[i];
+      if (broken[root])
+      {
+         broken[root] = false;
+         split(root);
+      }
+   }
+   brokenRoots.clear();
+   changedIDs.clear();
+   for (i = 0, i2 = (int)changedRoots.size(); i < i2; i++)
+   {
+      changed[changedRoots[i]] = false;
+      changedIDs.push_back(changedRoots[i]);
+   }
+   changedRoots.clear();
+}
+
+
+// Get molecule root ID of atom (-1=none).
+int MoleculeTracker::getRoot(int id)
+{
+   if ((id < 0) || (id >= (int)roots.size()))
+   {
+      return(-1);
+   }
+   return(roots[id]);
+}
+
+
+// Is atom a molecule root?
+bool MoleculeTracker::isRoot(int id)
+{
+   return(getRoot(id) == id);
+}
+
+
+// Get molecule atom IDs by root.
+vector<int>& MoleculeTracker::getMembers(int root)
+{
+   assert(isRoot(root));
+   return(members[root]);
+}
+
+
+// Get bond graph version of molecule by root.
+int MoleculeTracker::getVersion(int root)
+{
+   assert(isRoot(root));
+   return(versions[root]);
+}
@@ -0,0 +1,102 @@
+/*
+ * This software is provided under the terms of the GNU General
+ * Public License as published by the Free Software Foundation.
+ *
+ * Copyright (c) 2006-2007 Tom Portegys, All Rights Reserved.
+ * Permission to use, copy, modify, and distribute this software
+ * and its documentation for NON-COMMERCIAL purposes and without
+ * fee is hereby granted provided that this copyright notice
+ * appears in all copies.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.
+ */
+
+
+/*
+ * Molecule tracker: incremental connected components of bonded atoms.
+ */
+
+#ifndef __MOLECULE_TRACKER__
+#define __MOLECULE_TRACKER__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include <assert.h>
+using namespace std;
+
+namespace affinity
+{
+class Chemistry;
+
+// Molecule tracker.
+// Atoms are grouped into molecules by atom ID. Bond formation unites
+// two molecules by relabeling the smaller one (union by size). A bond
+// break flags its molecule, which is re-split by searching only its
+// own atoms on the next refresh. Molecules changed since the last
+// refresh are reported so that only they need to be re-analyzed.
+class MoleculeTracker
+{
+public:
+
+   // Constructor.
+   MoleculeTracker(Chemistry *chemistry);
+
+   // Clear.
+   void clear();
+
+   // Add and remove atom.
+   void addAtom(int id);
+   void removeAtom(int id);
+
+   // Bond and unbond atoms.
+   void bond(int id, int id2);
+   void unbond(int id, int id2);
+
+   // Refresh molecules, returning IDs of changed molecule roots.
+   // Changed roots that are no longer roots mark defunct molecules.
+   void refresh(vector<int>& changed);
+
+   // Get molecule root ID of atom (-1=none).
+   int getRoot(int id);
+
+   // Is atom a molecule root?
+   bool isRoot(int id);
+
+   // Get molecule atom IDs by root.
+   vector<int>& getMembers(int root);
+
+   // Get bond graph version of molecule by root.
+   // The version changes whenever the molecule changes.
+   int getVersion(int root);
+
+   // Chemistry.
+   Chemistry *chemistry;
+
+private:
+
+   // Root by atom ID (-1=no atom).
+   vector<int> roots;
+
+   // Member atom IDs by root.
+   vector<vector<int> > members;
+
+   // Bond graph versions by root and version factory.
+   vector<int> versions;
+   int         versionFactory;
+
+   // Changed and broken molecule roots.
+   vector<int>  changedRoots;
+   vector<bool> changed;
+   vector<int>  brokenRoots;
+   vector<bool> broken;
+
+   void grow(int id);
+   void setChanged(int root);
+   void split(int root);
+};
+}
+#endif
@@ -0,0 +1,617 @@
+/*
+ * This software is provided under the terms of the GNU General
+ * Public License as published by the Free Software Foundation.
+ *
+ * Copyright (c) 2006-2007 Tom Portegys, All Rights Reserved.
+ * Permission to use, copy, modify, and distribute this software
+ * and its documentation for NON-COMMERCIAL purposes and without
+ * fee is hereby granted provided that this copyright notice
+ * appears in all copies.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.
+ */
+
+
+
+/*
+ * Motif index: runtime counts of small molecular patterns.
+ */
+
+#include "motif.hpp"
+#include "chemistry.hpp"
+using namespace affinity;
+
+// Built-in motifs.
+static const char *BuiltinMotifs[][2] =
+{
+   { "O2",  "6,6/0=1"           },
+   { "H2O", "6,1,1/0-1,0-2"     },
+   { "CO2", "4,6,6/0=1,0=2"     },
+   { NULL,  NULL                }
+};
+
+// Get number of matches.
+int Motif::getCount()
+{
+   return(embeddings / automorphisms);
+}
+
+
+// Get bond multiplicity between motif atoms.
+int Motif::getBonds(int atom, int atom2)
+{
+   int i, i2;
+
+   for (i = edgeStart[atom], i2 = edgeStart[atom + 1]; i < i2; i++)
+   {
+      if (edgeAtom[i] == atom2)
+      {
+         return(edgeBonds[i]);
+      }
+   }
+   return(0);
+}
+
+
+// Parse motif.
+Motif *Motif::parse(const char *motifSpec)
+{
+   int        i, i2, j, n, a, b, m;
+   char       *s, name[MAX_MOTIF_NAME + 1];
+   const char *spec;
+   Motif      *motif;
+
+   vector<int> bonds, mapping;
+
+   spec = strchr(motifSpec, '=');
+   n    = (spec == NULL ? (int)strlen(motifSpec) : (int)(spec - motifSpec));
+   if ((n == 0) || (n > MAX_MOTIF_NAME))
+   {
+      return(NULL);
+   }
+   memcpy(name, motifSpec, n);
+   name[n] = '\0';
+   if (spec != NULL)
+   {
+      spec++;
+   }
+   else
+   {
+      for (i = 0; BuiltinMotifs[i][0] != NULL; i++)
+      {
+         if (strcmp(name, BuiltinMotifs[i][0]) == 0)
+         {
+            spec = BuiltinMotifs[i][1];
+            break;
+         }
+      }
+      if (spec == NULL)
+      {
+         return(NULL);
+      }
+   }
+   motif = new Motif();
+   assert(motif != NULL);
+   strcpy(motif->name, name);
+   motif->exact      = false;
+   motif->embeddings = 0;
+
+   // Atomic numbers.
+   for ( ; ; )
+   {
+      n = (int)strtol(spec, &s, 10);
+      if ((s == spec) || (n < 1))
+      {
+         delete motif;
+         return(NULL);
+      }
+      motif->numbers.push_back(n);
+      spec = s;
+      if (*spec != ',')
+      {
+         break;
+      }
+      spec++;
+   }
+   n = (int)motif->numbers.size();
+
+   // Bonds.
+   if (*spec == '/')
+   {
+      for (spec++; ; spec++)
+      {
+         a = (int)strtol(spec, &s, 10);
+         if (s == spec)
+         {
+            delete motif;
+            return(NULL);
+         }
+         switch (*s)
+         {
+         case '-':
+            m = 1;
+            break;
+
+         case '=':
+            m = 2;
+            break;
+
+         case '#':
+            m = 3;
+            break;
+
+         case '$':
+            m = 4;
+            break;
+
+         default:
+            delete motif;
+            return(NULL);
+         }
+         spec = s + 1;
+         b    = (int)strtol(spec, &s, 10);
+         if ((s == spec) || (a < 0) || (a >= n) || (b < 0) || (b >= n) || (a == b))
+         {
+            delete motif;
+            return(NULL);
+         }
+         for (i = 0, i2 = (int)bonds.size(); i < i2; i += 3)
+         {
+            if (((bonds[i] == a) && (bonds[i + 1] == b)) ||
+                ((bonds[i] == b) && (bonds[i + 1] == a)))
+            {
+               delete motif;
+               return(NULL);
+            }
+         }
+         bonds.push_back(a);
+         bonds.push_back(b);
+         bonds.push_back(m);
+         spec = s;
+         if (*spec != ',')
+         {
+            break;
+         }
+      }
+   }
+   if (*spec == '!')
+   {
+      motif->exact = true;
+      spec++;
+   }
+   if (*spec != '\0')
+   {
+      delete motif;
+      return(NULL);
+   }
+
+   // Build bond graph.
+   motif->degrees.resize(n, 0);
+   motif->edgeStart.resize(n + 1, 0);
+   for (a = 0; a < n; a++)
+   {
+      motif->edgeStart[a] = (int)motif->edgeAtom.size();
+      for (i = 0, i2 = (int)bonds.size(); i < i2; i += 3)
+      {
+         if (bonds[i] == a)
+         {
+            b = bonds[i + 1];
+         }
+         else if (bonds[i + 1] == a)
+         {
+            b = bonds[i];
+         }
+         else
+         {
+            continue;
+         }
+         motif->edgeAtom.push_back(b);
+         motif->edgeBonds.push_back(bonds[i + 2]);
+         motif->degrees[a] += bonds[i + 2];
+      }
+   }
+   motif->edgeStart[n] = (int)motif->edgeAtom.size();
+
+   // Breadth-first search orders from each anchor atom.
+   motif->orders.resize(n);
+   motif->parents.resize(n);
+   for (a = 0; a < n; a++)
+   {
+      vector<int>& order  = motif->orders[a];
+      vector<int>& parent = motif->parents[a];
+      order.push_back(a);
+      parent.push_back(-1);
+      for (i = 0; i < (int)order.size(); i++)
+      {
+         for (j = motif->edgeStart[order[i]]; j < motif->edgeStart[order[i] + 1]; j++)
+         {
+            b = motif->edgeAtom[j];
+            if (find(order.begin(), order.end(), b) == order.end())
+            {
+               order.push_back(b);
+               parent.push_back(order[i]);
+            }
+         }
+      }
+      if ((int)order.size() != n)
+      {
+         // Not connected.
+         delete motif;
+         return(NULL);
+      }
+   }
+
+   mapping.resize(n, -1);
+   motif->automorphisms = motif->countAutomorphisms(mapping, 0);
+   return(motif);
+}
+
+
+// Count automorphisms by mapping atoms in turn.
+int Motif::countAutomorphisms(vector<int>& mapping, int atom)
+{
+   int i, j, j2, n, count;
+
+   n = (int)numbers.size();
+   if (atom == n)
+   {
+      return(1);
+   }
+   for (i = count = 0; i < n; i++)
+   {
+      if ((numbers[i] != numbers[atom]) || (degrees[i] != degrees[atom]) ||
+          (find(mapping.begin(), mapping.end(), i) != mapping.end()))
+      {
+         continue;
+      }
+      for (j = 0, j2 = atom; j < j2; j++)
+      {
+         if (getBonds(atom, j) != getBonds(i, mapping[j]))
+         {
+            break;
+         }
+      }
+      if (j < j2)
+      {
+         continue;
+      }
+      mapping[atom] = i;
+      count        += countAutomorphisms(mapping, atom + 1);
+      mapping[atom] = -1;
+   }
+   return(count);
+}
+
+
+// Print motif count.
+void Motif::print(FILE *fp)
+{
+   fprintf(fp, "%s = %d\n", name, getCount());
+}
+
+
+// Motif index constructor.
+MotifIndex::MotifIndex(Chemistry *chemistry)
+{
+   this->chemistry = chemistry;
+   fixedAtom       = fixedID = -1;
+}
+
+
+// Motif index destructor.
+MotifIndex::~MotifIndex()
+{
+   for (int i = 0, i2 = (int)motifs.size(); i < i2; i++)
+   {
+      delete motifs[i];
+   }
+   motifs.clear();
+}
+
+
+// Register motif.
+Motif *MotifIndex::add(const char *motif)
+{
+   int   i, i2;
+   Motif *m, *m2;
+
+   if ((m = Motif::parse(motif)) == NULL)
+   {
+      return(NULL);
+   }
+   if ((m2 = find(m->name)) != NULL)
+   {
+      delete m;
+      return(m2);
+   }
+   for (i = 0, i2 = (int)chemistry->atoms.size(); i < i2; i++)
+   {
+      m->embeddings += countEmbeddings(m, 0, chemistry->atoms[i]->getID(), -1);
+   }
+   motifs.push_back(m);
+   return(m);
+}
+
+
+// Find motif by name.
+Motif *MotifIndex::find(const char *name)
+{
+   for (int i = 0, i2 = (int)motifs.size(); i < i2; i++)
+   {
+      if (strcmp(motifs[i]->name, name) == 0)
+      {
+         return(motifs[i]);
+      }
+   }
+   return(NULL);
+}
+
+
+// Get number of matches of motif by name.
+int MotifIndex::getCount(const char *name)
+{
+   Motif *m;
+
+   if ((m = find(name)) == NULL)
+   {
+      return(-1);
+   }
+   return(m->getCount());
+}
+
+
+// Clear counts.
+void MotifIndex::clear()
+{
+   for (int i = 0, i2 = (int)motifs.size(); i < i2; i++)
+   {
+      motifs[i]->embeddings = 0;
+   }
+}
+
+
+// Atom added.
+void MotifIndex::addAtom(int id)
+{
+   for (int i = 0, i2 = (int)motifs.size(); i < i2; i++)
+   {
+      motifs[i]->embeddings += countMatches(motifs[i], id, -1);
+   }
+}
+
+
+// Atom about to be removed.
+void MotifIndex::removeAtom(int id)
+{
+   for (int i = 0, i2 = (int)motifs.size(); i < i2; i++)
+   {
+      motifs[i]->embeddings -= countMatches(motifs[i], id, -1);
+   }
+}
+
+
+// Bond between atoms about to change.
+// Only matches with a motif bond between the atoms depend on the bond,
+// except that exact matches also depend on the total bonds of each atom.
+void MotifIndex::unlink(int id, int id2)
+{
+   for (int i = 0, i2 = (int)motifs.size(); i < i2; i++)
+   {
+      if (motifs[i]->exact)
+      {
+         motifs[i]->embeddings -= countMatches(motifs[i], id, id2);
+      }
+      else
+      {
+         motifs[i]->embeddings -= countBondMatches(motifs[i], id, id2);
+      }
+   }
+}
+
+
+// Bond between atoms changed.
+void MotifIndex::link(int id, int id2)
+{
+   for (int i = 0, i2 = (int)motifs.size(); i < i2; i++)
+   {
+      if (motifs[i]->exact)
+      {
+         motifs[i]->embeddings += countMatches(motifs[i], id, id2);
+      }
+      else
+      {
+         motifs[i]->embeddings += countBondMatches(motifs[i], id, id2);
+      }
+   }
+}
+
+
+// Count embeddings containing either atom (id2: -1=none).
+int MotifIndex::countMatches(Motif *motif, int id, int id2)
+{
+   int i, n, count;
+
+   n = (int)motif->numbers.size();
+   for (i = count = 0; i < n; i++)
+   {
+      count += countEmbeddings(motif, i, id, -1);
+      if ((id2 != -1) && (id2 != id))
+      {
+         count += countEmbeddings(motif, i, id2, id);
+      }
+   }
+   return(count);
+}
+
+
+// Count embeddings with a motif bond between the atoms.
+// Each embedding maps exactly one ordered motif bond onto the atoms.
+int MotifIndex::countBondMatches(Motif *motif, int id, int id2)
+{
+   int i, n, e, e2, count;
+
+   if (id == id2)
+   {
+      return(0);
+   }
+   n = (int)motif->numbers.size();
+   for (i = count = 0; i < n; i++)
+   {
+      for (e = motif->edgeStart[i], e2 = motif->edgeStart[i + 1]; e < e2; e++)
+      {
+         fixedAtom = motif->edgeAtom[e];
+         fixedID   = id2;
+         count    += countEmbeddings(motif, i, id, -1);
+      }
+   }
+   fixedAtom = fixedID = -1;
+   return(count);
+}
+
+
+// Count embeddings with motif atom at chemistry atom, excluding an atom.
+int MotifIndex::countEmbeddings(Motif *motif, int anchor, int id, int excludeID)
+{
+   Atom *atom;
+
+   if ((id == excludeID) || ((atom = chemistry->getAtom(id)) == NULL) ||
+       (atom->number != motif->numbers[anchor]))
+   {
+      return(0);
+   }
+   mapping.assign(motif->numbers.size(), -1);
+   mapping[anchor] = id;
+   if (!fits(motif, anchor, id))
+   {
+      return(0);
+   }
+   return(extend(motif, anchor, 1, excludeID));
+}
+
+
+// Extend embedding with k-th atom in anchor search order.
+int MotifIndex::extend(Motif *motif, int anchor, int k, int excludeID)
+{
+   int  i, i2, m, id, count;
+   Atom *atom;
+
+   vector<pair<int, int> > neighbors;
+
+   if (k == (int)motif->numbers.size())
+   {
+      return(1);
+   }
+   m = motif->orders[anchor][k];
+   getNeighbors(mapping[motif->parents[anchor][k]], neighbors);
+   for (i = count = 0, i2 = (int)neighbors.size(); i < i2; i++)
+   {
+      id = neighbors[i].first;
+      if ((id == excludeID) || ((m == fixedAtom) && (id != fixedID)) ||
+          (std::find(mapping.begin(), mapping.end(), id) != mapping.end()))
+      {
+         continue;
+      }
+      atom = chemistry->getAtom(id);
+      if ((atom == NULL) || (atom->number != motif->numbers[m]))
+      {
+         continue;
+      }
+      mapping[m] = id;
+      if (fits(motif, m, id))
+      {
+         count += extend(motif, anchor, k + 1, excludeID);
+      }
+      mapping[m] = -1;
+   }
+   return(count);
+}
+
+
+// Chemistry atom fits motif atom bonds to atoms mapped so far?
+bool MotifIndex::fits(Motif *motif, int atom, int id)
+{
+   int i, i2, id2;
+
+   if (motif->exact && (getDegree(id) != motif->degrees[atom]))
+   {
+      return(false);
+   }
+   for (i = motif->edgeStart[atom], i2 = motif->edgeStart[atom + 1]; i < i2; i++)
+   {
+      id2 = mapping[motif->edgeAtom[i]];
+      if ((id2 != -1) && (getBonds(id, id2) != motif->edgeBonds[i]))
+      {
+         return(false);
+      }
+   }
+   return(true);
+}
+
+
+// Get bonded atoms and bond multiplicities.
+void MotifIndex::getNeighbors(int id, vector<pair<int, int> >& neighbors)
+{
+   int  i, i2, j, j2;
+   Atom *atom;
+
+   neighbors.clear();
+   if ((atom = chemistry->getAtom(id)) == NULL)
+   {
+      return;
+   }
+   Molecule::getBondedIDs(atom, bondedIDs);
+   for (i = 0, i2 = (int)bondedIDs.size(); i < i2; i++)
+   {
+      for (j = 0, j2 = (int)neighbors.size(); j < j2; j++)
+      {
+         if (neighbors[j].first == bondedIDs[i])
+         {
+            neighbors[j].second++;
+            break;
+         }
+      }
+      if (j == j2)
+      {
+         neighbors.push_back(pair<int, int>(bondedIDs[i], 1));
+      }
+   }
+}
+
+
+// Get bond multiplicity between atoms.
+int MotifIndex::getBonds(int id, int id2)
+{
+   int  i, i2, bonds;
+   Atom *atom;
+
+   if ((atom = chemistry->getAtom(id)) == NULL)
+   {
+      return(0);
+   }
+   Molecule::getBondedIDs(atom, bondedIDs);
+   for (i = bonds = 0, i2 = (int)bondedIDs.size(); i < i2; i++)
+   {
+      if (bondedIDs[i] == id2)
+      {
+         bonds++;
+      }
+   }
+   return(bonds);
+}
+
+
+// Get total bonds of atom.
+int MotifIndex::getDegree(int id)
+{
+   Atom *atom;
+
+   if ((atom = chemistry->getAtom(id)) == NULL)
+   {
+      return(0);
+   }
+   Molecule::getBondedIDs(atom, bondedIDs);
+   return((int)bondedIDs.size());
+}
@@ -0,0 +1,167 @@
+/*
+ * This software is provided under the terms of the GNU General
+ * Public License as published by the Free Software Foundation.
+ *
+ * Copyright (c) 2006-2007 Tom Portegys, All Rights Reserved.
+ * Permission to use, copy, modify, and distribute this software
+ * and its documentation for NON-COMMERCIAL purposes and without
+ * fee is hereby granted provided that this copyright notice
+ * appears in all copies.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.
+ */
+
+
+
+/*
+ * Motif index: runtime counts of small molecular patterns.
+ */
+
+#ifndef __MOTIF__
+#define __MOTIF__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include <utility>
+#include <assert.h>
+using namespace std;
+
+// Maximum motif name length.
+#define MAX_MOTIF_NAME    31
+
+namespace affinity
+{
+class Chemistry;
+
+// Motif: a connected graph of atomic numbers with bond multiplicities.
+// Specified as "<numbers>/<bonds>", with atomic numbers separated by
+// commas and bonds between atom indices as i-j, i=j, i#j or i$j for
+// 1 to 4 bonds, e.g. "6,1,1/0-1,0-2". A trailing '!' requires matched
+// atoms to have no bonds outside the motif.
+class Motif
+{
+public:
+
+   // Name.
+   char name[MAX_MOTIF_NAME + 1];
+
+   // Atomic numbers.
+   vector<int> numbers;
+
+   // Bonds of atom i are edgeStart[i] to edgeStart[i+1]-1,
+   // giving bonded motif atom and bond multiplicity.
+   vector<int> edgeStart;
+   vector<int> edgeAtom;
+   vector<int> edgeBonds;
+
+   // Total bonds by atom.
+   vector<int> degrees;
+
+   // No bonds outside motif?
+   bool exact;
+
+   // Matches and automorphisms:
+   // each match is found once per automorphism.
+   int embeddings;
+   int automorphisms;
+
+   // Search order and parents from each anchor atom.
+   vector<vector<int> > orders;
+   vector<vector<int> > parents;
+
+   // Get number of matches.
+   int getCount();
+
+   // Get bond multiplicity between motif atoms.
+   int getBonds(int atom, int atom2);
+
+   // Parse motif as "<name>=<specification>" (NULL=invalid).
+   // A built-in motif (O2, H2O, CO2) may be given by name alone.
+   static Motif *parse(const char *motif);
+
+   // Print.
+   void print(FILE *fp = stdout);
+
+private:
+
+   // Count automorphisms.
+   int countAutomorphisms(vector<int>& mapping, int atom);
+};
+
+// Motif index.
+// Registered motifs are matched against the outer shell bond graph, as
+// for molecules, and their counts are kept current as atoms and bonds
+// change by recounting only the matches that contain the changed atoms,
+// or for a changed bond, only the matches containing the bond.
+class MotifIndex
+{
+public:
+
+   // Motifs.
+   vector<Motif *> motifs;
+
+   // Constructor.
+   MotifIndex(Chemistry *chemistry);
+
+   // Destructor.
+   ~MotifIndex();
+
+   // Register motif, counting its current matches.
+   // Returns the motif already registered by the name, or NULL if invalid.
+   Motif *add(const char *motif);
+
+   // Find motif by name.
+   Motif *find(const char *name);
+
+   // Get number of matches of motif by name (-1=unknown).
+   int getCount(const char *name);
+
+   // Clear counts.
+   void clear();
+
+   // Atom added or about to be removed.
+   void addAtom(int id);
+   void removeAtom(int id);
+
+   // Bond between atoms about to change and changed.
+   void unlink(int id, int id2);
+   void link(int id, int id2);
+
+   // Chemistry.
+   Chemistry *chemistry;
+
+private:
+
+   // Count matches containing either atom.
+   int countMatches(Motif *motif, int id, int id2);
+
+   // Count matches with a motif bond between the atoms.
+   int countBondMatches(Motif *motif, int id, int id2);
+
+   // Count embeddings with motif atom at chemistry atom, excluding an atom.
+   int countEmbeddings(Motif *motif, int anchor, int id, int excludeID);
+   int extend(Motif *motif, int anchor, int k, int excludeID);
+   bool fits(Motif *motif, int atom, int id);
+
+   // Get bonded atoms and bond multiplicities, and total bonds.
+   void getNeighbors(int id, vector<pair<int, int> >& neighbors);
+   int getBonds(int id, int id2);
+   int getDegree(int id);
+
+   // Motif atom to chemistry atom mapping.
+   vector<int> mapping;
+
+   // Motif atom restricted to chemistry atom during extension (-1=none).
+   int fixedAtom;
+   int fixedID;
+
+   // Bonded atom IDs work list.
+   vector<int> bondedIDs;
+};
+}
+#endif
@@ -18,7 +18,9 @@
  * Affinity chemistry parameters.
  */
 
+#include <math.h>
 #include "parameters.hpp"
+#include "atom.hpp"
 using namespace affinity;
 
 // Default parameter values.
@@ -74,6 +76,30 @@ Parameters::Parameters()
    MIN_THERMAL_TEMPERATURE       = DEFAULT_MIN_THERMAL_TEMPERATURE;
    MAX_TEMPERATURE               = DEFAULT_MAX_TEMPERATURE;
    UPDATE_STEP                   = DEFAULT_UPDATE_STEP;
+   buildCovalentForces();
+}
+
+
+// Build covalent bond force table.
+void Parameters::buildCovalentForces()
+{
+   int   i, j, n;
+   float valence[2], valence2[2];
+
+   n = covalentForceDimension = MAX_NUCLEUS_PROTONS + 1;
+   covalentForces.resize(n * n);
+   for (i = 0; i < n; i++)
+   {
+      Atom::getValence(i, valence[0], valence[1]);
+      for (j = 0; j < n; j++)
+      {
+         Atom::getValence(j, valence2[0], valence2[1]);
+         covalentForces[(i * n) + j] =
+            ((fabs((float)valence[0] - (float)valence2[0]) +
+              fabs((float)valence[1] - (float)valence2[1])) / 2.0f) +
+            MIN_COVALENT_BOND_FORCE;
+      }
+   }
 }
 
 
@@ -104,6 +130,7 @@ void Parameters::load(FILE *fp)
    FREAD_FLOAT(&MIN_THERMAL_TEMPERATURE, fp);
    FREAD_FLOAT(&MAX_TEMPERATURE, fp);
    FREAD_FLOAT(&UPDATE_STEP, fp);
+   buildCovalentForces();
 }
 
 
@@ -135,3 +162,64 @@ void Parameters::save(FILE *fp)
    FWRITE_FLOAT(&MAX_TEMPERATURE, fp);
    FWRITE_FLOAT(&UPDATE_STEP, fp);
 }
+
+
+// Load from snapshot record.
+void Parameters::load(SnapshotParameters& record)
+{
+   MIN_ATOM_INITIAL_FORCE        = record.MIN_ATOM_INITIAL_FORCE;
+   MAX_ATOM_INITIAL_FORCE        = record.MAX_ATOM_INITIAL_FORCE;
+   MIN_NUCLEUS_PROTONS           = record.MIN_NUCLEUS_PROTONS;
+   MAX_NUCLEUS_PROTONS           = record.MAX_NUCLEUS_PROTONS;
+   PROTON_MASS                   = record.PROTON_MASS;
+   ELECTRON_MASS                 = record.ELECTRON_MASS;
+   PROTON_CHARGE                 = record.PROTON_CHARGE;
+   ELECTRON_CHARGE               = record.ELECTRON_CHARGE;
+   CHARGE_GAUSSIAN_SPREAD        = record.CHARGE_GAUSSIAN_SPREAD;
+   NUCLEUS_BODY_RADIUS           = record.NUCLEUS_BODY_RADIUS;
+   ORBITAL_BODY_RADIUS           = record.ORBITAL_BODY_RADIUS;
+   MAX_BODY_RANGE                = record.MAX_BODY_RANGE;
+   BOND_LENGTH                   = record.BOND_LENGTH;
+   BOND_STIFFNESS                = record.BOND_STIFFNESS;
+   BOND_DAMPER                   = record.BOND_DAMPER;
+   NUCLEAR_REPULSION_STIFFNESS   = record.NUCLEAR_REPULSION_STIFFNESS;
+   COVALENT_BONDING_RANGE        = record.COVALENT_BONDING_RANGE;
+   MIN_COVALENT_BOND_FORCE       = record.MIN_COVALENT_BOND_FORCE;
+   COVALENT_BOND_STIFFNESS_SCALE = record.COVALENT_BOND_STIFFNESS_SCALE;
+   MIN_THERMAL_RADIUS            = record.MIN_THERMAL_RADIUS;
+   MAX_THERMAL_RADIUS            = record.MAX_THERMAL_RADIUS;
+   MIN_THERMAL_TEMPERATURE       = record.MIN_THERMAL_TEMPERATURE;
+   MAX_TEMPERATURE               = record.MAX_TEMPERATURE;
+   UPDATE_STEP                   = record.UPDATE_STEP;
+   buildCovalentForces();
+}
+
+
+// Save to snapshot record.
+void Parameters::save(SnapshotParameters& record)
+{
+   record.MIN_ATOM_INITIAL_FORCE        = MIN_ATOM_INITIAL_FORCE;
+   record.MAX_ATOM_INITIAL_FORCE        = MAX_ATOM_INITIAL_FORCE;
+   record.MIN_NUCLEUS_PROTONS           = MIN_NUCLEUS_PROTONS;
+   record.MAX_NUCLEUS_PROTONS           = MAX_NUCLEUS_PROTONS;
+   record.PROTON_MASS                   = PROTON_MASS;
+   record.ELECTRON_MASS                 = ELECTRON_MASS;
+   record.PROTON_CHARGE                 = PROTON_CHARGE;
+   record.ELECTRON_CHARGE               = ELECTRON_CHARGE;
+   record.CHARGE_GAUSSIAN_SPREAD        = CHARGE_GAUSSIAN_SPREAD;
+   record.NUCLEUS_BODY_RADIUS           = NUCLEUS_BODY_RADIUS;
+   record.ORBITAL_BODY_RADIUS           = ORBITAL_BODY_RADIUS;
+   record.MAX_BODY_RANGE                = MAX_BODY_RANGE;
+   record.BOND_LENGTH                   = BOND_LENGTH;
+   record.BOND_STIFFNESS                = BOND_STIFFNESS;
+   record.BOND_DAMPER                   = BOND_DAMPER;
+   record.NUCLEAR_REPULSION_STIFFNESS   = NUCLEAR_REPULSION_STIFFNESS;
+   record.COVALENT_BONDING_RANGE        = COVALENT_BONDING_RANGE;
+   record.MIN_COVALENT_BOND_FORCE       = MIN_COVALENT_BOND_FORCE;
+   record.COVALENT_BOND_STIFFNESS_SCALE = COVALENT_BOND_STIFFNESS_SCALE;
+   record.MIN_THERMAL_RADIUS            = MIN_THERMAL_RADIUS;
+   record.MAX_THERMAL_RADIUS            = MAX_THERMAL_RADIUS;
+   record.MIN_THERMAL_TEMPERATURE       = MIN_THERMAL_TEMPERATURE;
+   record.MAX_TEMPERATURE               = MAX_TEMPERATURE;
+   record.UPDATE_STEP                   = UPDATE_STEP;
+}
@@ -24,7 +24,10 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <assert.h>
+#include <vector>
 #include "../utility/fileio.h"
+#include "snapshot.hpp"
+using namespace std;
 
 // Define chemistry-specific compilation directives here.
 
@@ -95,12 +98,20 @@ public:
    static const float DEFAULT_UPDATE_STEP;
    float              UPDATE_STEP;
 
+   // Covalent bond forces indexed by element (atomic number) pair.
+   // Rebuild after changing MAX_NUCLEUS_PROTONS or MIN_COVALENT_BOND_FORCE.
+   vector<float> covalentForces;
+   int           covalentForceDimension;
+   void buildCovalentForces();
+
    // Constructor.
    Parameters();
 
    // Load and save parameters.
    void load(FILE *fp);
    void save(FILE *fp);
+   void load(SnapshotParameters& record);
+   void save(SnapshotParameters& record);
 };
 }
 #endif
@@ -14,409 +14,703 @@
  * DISCLAIMED.
  */
 
+
 /*
- * Molecule.
+ * Reaction: a recursive molecule decomposition into bonded components.
  */
 
-#include "molecule.hpp"
+#include "reaction.hpp"
 #include "chemistry.hpp"
 using namespace affinity;
 
-// Constructor.
-// Analyze molecule given a component atom.
-Molecule::Molecule(Chemistry *chemistry, Atom *atom)
+// Initial number of hash buckets (power of 2).
+#define INITIAL_RECIPE_BUCKETS    64
+
+// Recipe bond constructor.
+RecipeBond::RecipeBond(int atom1, int orbital1, int atom2, int orbital2, float force)
 {
-   int i, i2;
+   this->atom1    = atom1;
+   this->orbital1 = orbital1;
+   this->atom2    = atom2;
+   this->orbital2 = orbital2;
+   this->force    = force;
+}
 
-   vector<Atom *> atoms;
-   AtomTree       *root, *child;
 
-   // Save chemistry.
-   this->chemistry = chemistry;
+// Reaction constructor.
+Reaction::Reaction()
+{
+   id    = -1;
+   memset(code, 0, MOLECULE_CODE_SIZE);
+   force = 0.0f;
+   count = 0;
+   memo  = true;
+}
 
-   // Get component atom IDs.
-   getIDs(atom, atomIDs);
 
-   // Sort atoms by atomic number.
-   for (i = 0, i2 = atomIDs.size(); i < i2; i++)
+// Create molecule in chemistry at position:
+// Atoms are placed outward from the first along bonds,
+// with bonded orbitals drawn together.
+void Reaction::synthesize(Chemistry *chemistry, Vector& position, vector<int>& atomIDs)
+{
+   int    i, i2, j, n, a, b;
+   Atom   *atom, *atom2;
+   Body   *body, *body2;
+   Vector p, d;
+
+   vector<Atom *> atoms;
+   vector<bool>   placed;
+   vector<int>    frontier;
+
+   n = (int)numbers.size();
+   atomIDs.clear();
+   for (i = 0; i < n; i++)
+   {
+      atom = chemistry->createAtom(numbers[i]);
+      atoms.push_back(atom);
+      atomIDs.push_back(atom->getID());
+   }
+   placed.resize(n, false);
+   if (n > 0)
+   {
+      atoms[0]->setPosition(position);
+      placed[0] = true;
+      frontier.push_back(0);
+   }
+   for (i = 0; i < (int)frontier.size(); i++)
    {
-      atoms.push_back(chemistry->getAtom(atomIDs[i]));
+      a = frontier[i];
+      for (j = 0, i2 = (int)bonds.size(); j < i2; j++)
+      {
+         RecipeBond& bond = bonds[j];
+         if ((bond.atom1 != a) && (bond.atom2 != a))
+         {
+            continue;
+         }
+         b = (bond.atom1 == a ? bond.atom2 : bond.atom1);
+         if (placed[b])
+         {
+            continue;
+         }
+         atom  = atoms[a];
+         atom2 = atoms[b];
+         body  = &atom->shells.back().orbitals[bond.atom1 == a ? bond.orbital1 : bond.orbital2];
+         body2 = &atom2->shells.back().orbitals[bond.atom1 == a ? bond.orbital2 : bond.orbital1];
+         d     = body->getPosition() - atom->getPosition();
+         d.Normalize(chemistry->parameters->BOND_LENGTH);
+         p = body->getPosition() + d;
+         atom2->setPosition(p);
+         p = body->getPosition();
+         body2->setPosition(p);
+         placed[b] = true;
+         frontier.push_back(b);
+      }
+   }
+   for (i = 0, i2 = (int)bonds.size(); i < i2; i++)
+   {
+      body  = &atoms[bonds[i].atom1]->shells.back().orbitals[bonds[i].orbital1];
+      body2 = &atoms[bonds[i].atom2]->shells.back().orbitals[bonds[i].orbital2];
+      p     = (body->getPosition() + body2->getPosition()) / 2.0f;
+      body->setPosition(p);
+      body2->setPosition(p);
+      chemistry->createBond(body, body2);
    }
-   sort(atoms.begin(), atoms.end(), ltcmpAtoms);
+   chemistry->resetBondSearch();
+}
+
+
+// Print recipe.
+void Reaction::print(FILE *fp)
+{
+   int i, i2, j, j2;
 
-   // Generate code for molecule using atom trees for each atom.
-   root = new AtomTree(chemistry);
-   assert(root != NULL);
-   for (i = 0, i2 = atoms.size(); i < i2; i++)
+   fprintf(fp, "Recipe %d: atoms=%d, bonds=%d, split force=%f, count=%d\n",
+           id, (int)numbers.size(), (int)bonds.size(), force, count);
+   fprintf(fp, "Atoms:");
+   for (i = 0, i2 = (int)numbers.size(); i < i2; i++)
    {
-      child = new AtomTree(chemistry, atoms[i]);
-      assert(child != NULL);
-      root->children.push_back(child);
+      fprintf(fp, " %d", numbers[i]);
+   }
+   fprintf(fp, "\nBonds:");
+   for (i = 0, i2 = (int)bonds.size(); i < i2; i++)
+   {
+      fprintf(fp, " %d/%d-%d/%d(%f)", bonds[i].atom1, bonds[i].orbital1,
+              bonds[i].atom2, bonds[i].orbital2, bonds[i].force);
+   }
+   fprintf(fp, "\n");
+   for (i = 0, i2 = (int)components.size(); i < i2; i++)
+   {
+      fprintf(fp, "Component: recipe %d, atoms:", components[i]->id);
+      for (j = 0, j2 = (int)componentAtoms[i].size(); j < j2; j++)
+      {
+         fprintf(fp, " %d", componentAtoms[i][j]);
+      }
+      fprintf(fp, "\n");
+   }
+   if (joins.size() > 0)
+   {
+      fprintf(fp, "Joins:");
+      for (i = 0, i2 = (int)joins.size(); i < i2; i++)
+      {
+         fprintf(fp, " %d", joins[i]);
+      }
+      fprintf(fp, "\n");
    }
-   root->generateCode();
-   memcpy(code, root->code, MD5_SIZE);
-   delete root;
 }
 
 
-// Destructor.
-Molecule::~Molecule()
+// Recipe book constructor.
+RecipeBook::RecipeBook()
 {
-   atomIDs.clear();
+   table = new HashTable<Reaction>(INITIAL_RECIPE_BUCKETS, getKey);
+   assert(table != NULL);
 }
 
 
-// Get molecule size (number of atoms).
-int Molecule::size()
+// Recipe book destructor.
+RecipeBook::~RecipeBook()
 {
-   return(atomIDs.size());
+   clear();
+   delete table;
 }
 
 
-// Molecule contains atom?
-bool Molecule::contains(Atom *atom)
+// Clear recipes.
+void RecipeBook::clear()
 {
-   return(contains(&atom->nucleus));
+   for (int i = 0, i2 = (int)recipes.size(); i < i2; i++)
+   {
+      delete recipes[i];
+   }
+   recipes.clear();
+   table->clear();
 }
 
 
-// Molecule contains body?
-bool Molecule::contains(Body *body)
+// Get recipe of molecule.
+// A recipe found by code is used only if its graph matches; a code
+// shared by different graphs is decomposed privately.
+Reaction *RecipeBook::getRecipe(Molecule *molecule)
 {
-   int i, j;
+   int      i, j, j2, k, n;
+   Atom     *atom;
+   Body     *body;
+   Reaction *recipe;
 
-   for (i = 0, j = atomIDs.size(); i < j &&
-        atomIDs[i] <= body->id; i++)
+   vector<int>        numbers, mapping;
+   vector<RecipeBond> bonds;
+
+   // Get bond graph with covalent forces.
+   molecule->generateCode();
+   n = (int)molecule->atomIDs.size();
+   for (i = 0; i < n; i++)
    {
-      if (atomIDs[i] == body->id)
+      atom = molecule->chemistry->getAtom(molecule->atomIDs[i]);
+      numbers.push_back(atom->number);
+      for (j = 0, j2 = (int)atom->shells.back().orbitals.size(); j < j2; j++)
       {
-         return(true);
+         body = &atom->shells.back().orbitals[j];
+         if (body->covalentBody == NULL)
+         {
+            continue;
+         }
+         k = (int)(lower_bound(molecule->atomIDs.begin(), molecule->atomIDs.end(),
+                               body->covalentBody->id) - molecule->atomIDs.begin());
+         if (i < k)
+         {
+            bonds.push_back(RecipeBond(i, j, k, body->covalentBody->orbital,
+                                       body->getCovalentForce(body->covalentBody)));
+         }
       }
    }
-   return(false);
+   recipe = find(molecule->code);
+   if ((recipe == NULL) || !match(recipe, numbers, bonds, mapping))
+   {
+      recipe = decompose(numbers, bonds, molecule->code, recipe == NULL);
+   }
+   recipe->count++;
+   return(recipe);
 }
 
 
-// Molecule is "closed" (all bonds connected)?
-bool Molecule::isClosed()
+// Decompose molecule graph:
+// Break bonds from the weakest up until the molecule divides, then
+// decompose each component, reusing recipes of known components.
+Reaction *RecipeBook::decompose(vector<int>& numbers, vector<RecipeBond>& bonds,
+                                unsigned char *code, bool memo)
 {
-   int  i, i2, j, j2, s;
-   Atom *atom;
-
-   for (i = 0, i2 = atomIDs.size(); i < i2; i++)
+   int      i, i2, j, j2, a, b, n, c, level;
+   Reaction *recipe, *component;
+
+   vector<float>              forces;
+   vector<int>                labels, atoms, local, mapping;
+   vector<RecipeBond>         componentBonds;
+   vector<int>                componentNumbers;
+   unsigned char              componentCode[MOLECULE_CODE_SIZE];
+
+   recipe = new Reaction();
+   assert(recipe != NULL);
+   memcpy(recipe->code, code, MOLECULE_CODE_SIZE);
+   recipe->numbers = numbers;
+   recipe->bonds   = bonds;
+   recipe->memo    = memo;
+   n               = (int)numbers.size();
+   if (n > 1)
    {
-      atom = chemistry->getAtom(atomIDs[i]);
-      s    = atom->shells.size() - 1;
-      for (j = 0, j2 = atom->shells[s].orbitals.size(); j < j2; j++)
+      // Find weakest force level that divides molecule.
+      for (i = 0, i2 = (int)bonds.size(); i < i2; i++)
+      {
+         forces.push_back(bonds[i].force);
+      }
+      sort(forces.begin(), forces.end());
+      forces.erase(unique(forces.begin(), forces.end()), forces.end());
+      labels.resize(n);
+      for (level = 0; ; level++)
+      {
+         assert(level < (int)forces.size());
+         recipe->force = forces[level];
+         for (i = 0; i < n; i++)
+         {
+            labels[i] = i;
+         }
+         for (i = 0, i2 = (int)bonds.size(); i < i2; i++)
+         {
+            if (bonds[i].force <= recipe->force)
+            {
+               continue;
+            }
+            for (a = bonds[i].atom1; labels[a] != a; a = labels[a])
+            {
+            }
+            for (b = bonds[i].atom2; labels[b] != b; b = labels[b])
+            {
+            }
+            if (a != b)
+            {
+               labels[a > b ? a : b] = (a > b ? b : a);
+            }
+         }
+         for (i = c = 0; i < n; i++)
+         {
+            for (a = i; labels[a] != a; a = labels[a])
+            {
+            }
+            labels[i] = a;
+            if (a == i)
+            {
+               c++;
+            }
+         }
+         if (c > 1)
+         {
+            break;
+         }
+      }
+
+      // Decompose components.
+      local.resize(n);
+      for (c = 0; c < n; c++)
       {
-         if (atom->shells[s].orbitals[j].hasValence &&
-             (atom->shells[s].orbitals[j].covalentBody == NULL))
+         if (labels[c] != c)
          {
-            return(false);
+            continue;
+         }
+         atoms.clear();
+         componentNumbers.clear();
+         for (i = 0; i < n; i++)
+         {
+            if (labels[i] == c)
+            {
+               local[i] = (int)atoms.size();
+               atoms.push_back(i);
+               componentNumbers.push_back(numbers[i]);
+            }
+         }
+         componentBonds.clear();
+         for (i = 0, i2 = (int)bonds.size(); i < i2; i++)
+         {
+            if ((labels[bonds[i].atom1] == c) && (labels[bonds[i].atom2] == c))
+            {
+               componentBonds.push_back(RecipeBond(local[bonds[i].atom1], bonds[i].orbital1,
+                                                   local[bonds[i].atom2], bonds[i].orbital2,
+                                                   bonds[i].force));
+            }
+         }
+         generateCode(componentNumbers, componentBonds, componentCode);
+         component = find(componentCode);
+         if ((component != NULL) &&
+             match(component, componentNumbers, componentBonds, mapping))
+         {
+            for (j = 0, j2 = (int)mapping.size(); j < j2; j++)
+            {
+               mapping[j] = atoms[mapping[j]];
+            }
+            recipe->componentAtoms.push_back(mapping);
+         }
+         else
+         {
+            // A code shared by different graphs is decomposed privately.
+            component = decompose(componentNumbers, componentBonds, componentCode,
+                                  component == NULL);
+            recipe->componentAtoms.push_back(atoms);
+         }
+         recipe->components.push_back(component);
+      }
+      for (i = 0, i2 = (int)bonds.size(); i < i2; i++)
+      {
+         if (labels[bonds[i].atom1] != labels[bonds[i].atom2])
+         {
+            recipe->joins.push_back(i);
          }
       }
    }
-   return(true);
+   insert(recipe);
+   return(recipe);
 }
 
 
-// Compare molecules by code.
-bool Molecule::equals(Molecule *molecule)
+// Add recipe.
+void RecipeBook::insert(Reaction *recipe)
 {
-   if (memcmp(code, molecule->code, MD5_SIZE) == 0)
+   recipe->id = (int)recipes.size();
+   recipes.push_back(recipe);
+   if (!recipe->memo)
    {
-      return(true);
-   }
-   else
-   {
-      return(false);
+      return;
    }
+   table->insert(recipe);
 }
 
 
-bool Molecule::operator==(Molecule& molecule)
+// Find recipe by code.
+Reaction *RecipeBook::find(unsigned char *code)
 {
-   return(equals(&molecule));
+   int i, i2;
+
+   vector<Reaction *>& bucket = table->getBucket(getKey(code));
+   for (i = 0, i2 = (int)bucket.size(); i < i2; i++)
+   {
+      if (memcmp(bucket[i]->code, code, MOLECULE_CODE_SIZE) == 0)
+      {
+         return(bucket[i]);
+      }
+   }
+   return(NULL);
 }
 
 
-bool Molecule::operator!=(Molecule& molecule)
+// Get hash key of code.
+unsigned long long RecipeBook::getKey(unsigned char *code)
 {
-   return(!(*this == molecule));
+   unsigned long long h;
+
+   memcpy(&h, code, sizeof(h));
+   return(h);
 }
 
 
-// Print molecule.
-void Molecule::print(FILE *fp)
+// Get hash key of recipe.
+unsigned long long RecipeBook::getKey(Reaction *recipe)
 {
-   int i, j;
-
-   fprintf(fp, "Atom ID/Numbers: ");
-   for (i = 0, j = atomIDs.size(); i < j; i++)
-   {
-      fprintf(fp, "%d/%d ", atomIDs[i], chemistry->getAtom(atomIDs[i])->number);
-   }
-   fprintf(fp, "\n");
-   fprintf(fp, "Code: ");
-   for (i = 0; i < MD5_SIZE; i++)
-   {
-      fprintf(fp, "%d ", code[i]);
-   }
-   fprintf(fp, "\n");
+   return(getKey(recipe->code));
 }
 
 
-// Get component atom IDs.
-void Molecule::getIDs(Atom *atom, vector<int>& ids)
+// Map recipe atoms onto an isomorphic graph:
+// mapping[k] is the graph atom matching recipe atom k.
+bool RecipeBook::match(Reaction *recipe, vector<int>& numbers,
+                       vector<RecipeBond>& bonds, vector<int>& mapping)
 {
-   int  i, i2, j, j2;
-   Body *body;
+   int i, j, j2, s, n;
 
-   for (i = 0, i2 = ids.size(); i < i2; i++)
+   vector<int>   order, parents;
+   vector<bool>  used;
+   MoleculeGraph graph1, graph2;
+
+   n = (int)numbers.size();
+   if (((int)recipe->numbers.size() != n) || (recipe->bonds.size() != bonds.size()))
    {
-      if (ids[i] == atom->getID())
-      {
-         return;
-      }
+      return(false);
    }
-   ids.push_back(atom->getID());
-   sort(ids.begin(), ids.end());
+   getGraph(recipe->numbers, recipe->bonds, graph1);
+   getGraph(numbers, bonds, graph2);
 
-   // Get connected atom IDs.
-   i = atom->shells.size() - 1;
-   for (j = 0, j2 = atom->shells[i].orbitals.size(); j < j2; j++)
+   // Match recipe atoms in breadth-first order, each after
+   // a bonded parent when it has one.
+   used.resize(n, false);
+   for (s = 0; s < n; s++)
    {
-      if ((body = atom->shells[i].orbitals[j].covalentBody) != NULL)
+      if (used[s])
       {
-         getIDs(chemistry->getAtom(body->id), ids);
+         continue;
+      }
+      used[s] = true;
+      order.push_back(s);
+      parents.push_back(-1);
+      for (i = (int)order.size() - 1; i < (int)order.size(); i++)
+      {
+         for (j = graph1.edgeStart[order[i]], j2 = graph1.edgeStart[order[i] + 1]; j < j2; j++)
+         {
+            if (!used[graph1.edgeAtom[j]])
+            {
+               used[graph1.edgeAtom[j]] = true;
+               order.push_back(graph1.edgeAtom[j]);
+               parents.push_back(order[i]);
+            }
+         }
       }
    }
+   mapping.assign(n, -1);
+   used.assign(n, false);
+   return(match(order, parents, 0, graph1, graph2, mapping, used));
 }
 
 
-// Less-than comparison atoms by atomic number.
-bool Molecule::ltcmpAtoms(Atom *a, Atom *b)
+bool RecipeBook::match(vector<int>& order, vector<int>& parents, int k,
+                       MoleculeGraph& graph1, MoleculeGraph& graph2,
+                       vector<int>& mapping, vector<bool>& used)
 {
-   return(a->number < b->number);
-}
+   int a, b, c, c2, e, e2, p, n, count;
 
+   n = (int)graph1.numbers.size();
+   if (k == n)
+   {
+      return(true);
+   }
+   a = order[k];
+   p = parents[k];
 
-// Atom tree constructor.
-Molecule::AtomTree::AtomTree(Chemistry *chemistry, Atom *atom)
-{
-   this->chemistry = chemistry;
-   this->atom      = atom;
-   if (atom == NULL)
+   // Candidates are bonded to the parent's image, if any.
+   if (p == -1)
    {
-      parentBonds = 0;
+      c  = 0;
+      c2 = n;
    }
    else
    {
-      parentBonds = 1;
+      c  = graph2.edgeStart[mapping[p]];
+      c2 = graph2.edgeStart[mapping[p] + 1];
    }
-   expanded = false;
-}
-
-
-// Atom tree destructor.
-Molecule::AtomTree::~AtomTree()
-{
-   int i, i2;
-
-   for (i = 0, i2 = children.size(); i < i2; i++)
+   for ( ; c < c2; c++)
    {
-      delete children[i];
-   }
-   children.clear();
-}
-
-
-// Generate code.
-void Molecule::AtomTree::generateCode(bool hashNumbers)
-{
-   int               i, j, s;
-   struct MD5Context md5c;
-   unsigned char     *input;
+      b = (p == -1 ? c : graph2.edgeAtom[c]);
+      if (used[b] || (graph1.numbers[a] != graph2.numbers[b]) ||
+          (getDegree(graph1, a) != getDegree(graph2, b)))
+      {
+         continue;
+      }
 
-   // Root?
-   s = children.size();
-   if (atom == NULL)
-   {
-      // Iteratively expand children until either fully
-      // expanded or all have distinct codes.
-      vector<int> path;
-      while (true)
+      // Bonds to matched atoms must agree.
+      for (e = graph1.edgeStart[a], e2 = graph1.edgeStart[a + 1], count = 0; e < e2; e++)
       {
-         for (i = 0; i < s; i++)
-         {
-            children[i]->generateCode();
-         }
-         sort(children.begin(), children.end(), ltcmpCode);
-         for (i = 0; i < s - 1; i++)
+         if (mapping[graph1.edgeAtom[e]] == -1)
          {
-            if (!children[i]->expanded && (ltcmpCode(children[i], children[i + 1]) == 0))
-            {
-               break;
-            }
+            continue;
          }
-         if (i == s - 1)
+         if (getBonds(graph2, b, mapping[graph1.edgeAtom[e]]) != graph1.edgeBonds[e])
          {
             break;
          }
-         for (j = i + 2; j < s && ltcmpCode(children[i], children[j]) == 0; j++)
-         {
-         }
-         for ( ; i < j; i++)
+         count++;
+      }
+      if (e < e2)
+      {
+         continue;
+      }
+      for (e = graph2.edgeStart[b], e2 = graph2.edgeStart[b + 1]; e < e2; e++)
+      {
+         if (used[graph2.edgeAtom[e]])
          {
-            path.clear();
-            children[i]->expand(path);
+            count--;
          }
       }
+      if (count != 0)
+      {
+         continue;
+      }
+      mapping[a] = b;
+      used[b]    = true;
+      if (match(order, parents, k + 1, graph1, graph2, mapping, used))
+      {
+         return(true);
+      }
+      mapping[a] = -1;
+      used[b]    = false;
    }
+   return(false);
+}
 
-   // Recursively generate code.
-   for (i = 0; i < s; i++)
-   {
-      children[i]->generateCode();
-   }
-   sort(children.begin(), children.end(), ltcmpCode);
-   MD5Init(&md5c);
-   if (atom != NULL)
-   {
-      j = 2;
-   }
-   else
+
+// Get bond graph.
+void RecipeBook::getGraph(vector<int>& numbers, vector<RecipeBond>& bonds,
+                          MoleculeGraph& graph)
+{
+   int i, i2;
+
+   vector<pair<int, int> > pairs;
+
+   for (i = 0, i2 = (int)bonds.size(); i < i2; i++)
    {
-      j = 0;
+      pairs.push_back(pair<int, int>(bonds[i].atom1, bonds[i].atom2));
    }
-   input = new unsigned char[(s * MD5_SIZE) + j];
-   assert(input != NULL);
-   if (atom != NULL)
+   graph.build(numbers, pairs);
+}
+
+
+// Get number of bonds of graph atom.
+int RecipeBook::getDegree(MoleculeGraph& graph, int a)
+{
+   int i, i2, d;
+
+   for (i = graph.edgeStart[a], i2 = graph.edgeStart[a + 1], d = 0; i < i2; i++)
    {
-      input[0] = (unsigned char)atom->number;
-      input[1] = (unsigned char)parentBonds;
+      d += graph.edgeBonds[i];
    }
-   for (i = 0; i < s; i++)
+   return(d);
+}
+
+
+// Get bond multiplicity between graph atoms.
+int RecipeBook::getBonds(MoleculeGraph& graph, int a, int b)
+{
+   for (int i = graph.edgeStart[a], i2 = graph.edgeStart[a + 1]; i < i2; i++)
    {
-      memcpy(&input[j], children[i]->code, MD5_SIZE);
-      j += MD5_SIZE;
+      if (graph.edgeAtom[i] == b)
+      {
+         return(graph.edgeBonds[i]);
+      }
    }
-   MD5Update(&md5c, input, j);
-   MD5Final(code, &md5c);
-   delete input;
+   return(0);
 }
 
 
-// Expand tree one level deeper.
-void Molecule::AtomTree::expand(vector<int>& path)
+// Generate code of molecule graph, as for molecules.
+void RecipeBook::generateCode(vector<int>& numbers, vector<RecipeBond>& bonds,
+                              unsigned char *code)
 {
-   int      i, i2, j, j2, k, id;
-   Body     *body;
-   AtomTree *child;
+   MoleculeGraph graph;
 
-   vector<int>        path2;
-   vector<AtomTree *> tmpTree;
+   getGraph(numbers, bonds, graph);
+   graph.generateCode(code);
+}
 
-   if (expanded)
-   {
-      return;
-   }
-   expanded = true;
-   if (children.size() == 0)
+
+// Load recipes.
+void RecipeBook::load(FILE *fp)
+{
+   int      i, j, k, n, m, c;
+   Reaction *recipe;
+
+   clear();
+   FREAD_INT(&n, fp);
+   for (i = 0; i < n; i++)
    {
-      // Expand this level.
-      i = atom->shells.size() - 1;
-      for (j = 0, j2 = atom->shells[i].orbitals.size(); j < j2; j++)
+      recipe = new Reaction();
+      assert(recipe != NULL);
+      FREAD_BYTES(recipe->code, MOLECULE_CODE_SIZE, fp);
+      FREAD_INT(&m, fp);
+      recipe->numbers.resize(m);
+      for (j = 0; j < m; j++)
       {
-         if ((body = atom->shells[i].orbitals[j].covalentBody) != NULL)
-         {
-            child = new AtomTree(chemistry, chemistry->getAtom(body->id));
-            assert(child != NULL);
-            children.push_back(child);
-         }
+         FREAD_INT(&recipe->numbers[j], fp);
       }
-
-      // Consolidate multiple bonds.
-      for (i = 0, i2 = children.size(); i < i2; i++)
+      FREAD_INT(&m, fp);
+      recipe->bonds.resize(m);
+      for (j = 0; j < m; j++)
       {
-         if (children[i] == NULL)
-         {
-            continue;
-         }
-         for (j = i + 1, k = 0; j < i2; j++)
-         {
-            if (children[j] == NULL)
-            {
-               continue;
-            }
-            if (children[i]->atom->getID() == children[j]->atom->getID())
-            {
-               k++;
-               delete children[j];
-               children[j] = NULL;
-            }
-         }
-         children[i]->parentBonds += k;
+         FREAD_INT(&recipe->bonds[j].atom1, fp);
+         FREAD_INT(&recipe->bonds[j].orbital1, fp);
+         FREAD_INT(&recipe->bonds[j].atom2, fp);
+         FREAD_INT(&recipe->bonds[j].orbital2, fp);
+         FREAD_FLOAT(&recipe->bonds[j].force, fp);
       }
-      for (i = 0; i < i2; i++)
+      FREAD_FLOAT(&recipe->force, fp);
+      FREAD_INT(&recipe->count, fp);
+      FREAD_BOOL(&recipe->memo, fp);
+
+      // Regenerate code in case the file predates the current code scheme.
+      generateCode(recipe->numbers, recipe->bonds, recipe->code);
+      FREAD_INT(&m, fp);
+      recipe->componentAtoms.resize(m);
+      for (j = 0; j < m; j++)
       {
-         if (children[i] != NULL)
+         FREAD_INT(&c, fp);
+         assert(c >= 0 && c < i);
+         recipe->components.push_back(recipes[c]);
+         recipe->componentAtoms[j].resize(recipes[c]->numbers.size());
+         for (k = 0; k < (int)recipes[c]->numbers.size(); k++)
          {
-            tmpTree.push_back(children[i]);
+            FREAD_INT(&recipe->componentAtoms[j][k], fp);
          }
       }
-      children.clear();
-      for (i = 0, i2 = tmpTree.size(); i < i2; i++)
-      {
-         children.push_back(tmpTree[i]);
-      }
-      if (children.size() > 0)
+      FREAD_INT(&m, fp);
+      recipe->joins.resize(m);
+      for (j = 0; j < m; j++)
       {
-         expanded = false;
+         FREAD_INT(&recipe->joins[j], fp);
       }
+      insert(recipe);
    }
-   else
+}
+
+
+// Save recipes.
+void RecipeBook::save(FILE *fp)
+{
+   int      i, j, k, n, m;
+   Reaction *recipe;
+
+   n = (int)recipes.size();
+   FWRITE_INT(&n, fp);
+   for (i = 0; i < n; i++)
    {
-      // Expand deeper.
-      id = atom->getID();
-      for (i = 0, i2 = path.size(); i < i2; i++)
+      recipe = recipes[i];
+      FWRITE_BYTES(recipe->code, MOLECULE_CODE_SIZE, fp);
+      m = (int)recipe->numbers.size();
+      FWRITE_INT(&m, fp);
+      for (j = 0; j < m; j++)
       {
-         if (id == path[i])
-         {
-            break;
-         }
+         FWRITE_INT(&recipe->numbers[j], fp);
+      }
+      m = (int)recipe->bonds.size();
+      FWRITE_INT(&m, fp);
+      for (j = 0; j < m; j++)
+      {
+         FWRITE_INT(&recipe->bonds[j].atom1, fp);
+         FWRITE_INT(&recipe->bonds[j].orbital1, fp);
+         FWRITE_INT(&recipe->bonds[j].atom2, fp);
+         FWRITE_INT(&recipe->bonds[j].orbital2, fp);
+         FWRITE_FLOAT(&recipe->bonds[j].force, fp);
       }
-      if (i == i2)
+      FWRITE_FLOAT(&recipe->force, fp);
+      FWRITE_INT(&recipe->count, fp);
+      FWRITE_BOOL(&recipe->memo, fp);
+      m = (int)recipe->components.size();
+      FWRITE_INT(&m, fp);
+      for (j = 0; j < m; j++)
       {
-         path.push_back(id);
-         for (i = 0, i2 = children.size(); i < i2; i++)
+         FWRITE_INT(&recipe->components[j]->id, fp);
+         for (k = 0; k < (int)recipe->componentAtoms[j].size(); k++)
          {
-            id = children[i]->atom->getID();
-            path2.clear();
-            for (j = 0, j2 = path.size(); j < j2; j++)
-            {
-               path2.push_back(path[j]);
-            }
-            children[i]->expand(path2);
-            if (!children[i]->expanded)
-            {
-               expanded = false;
-            }
+            FWRITE_INT(&recipe->componentAtoms[j][k], fp);
          }
       }
+      m = (int)recipe->joins.size();
+      FWRITE_INT(&m, fp);
+      for (j = 0; j < m; j++)
+      {
+         FWRITE_INT(&recipe->joins[j], fp);
+      }
    }
 }
 
 
-// Less-than comparison by code.
-bool Molecule::AtomTree::ltcmpCode(AtomTree *a, AtomTree *b)
+// Print recipes.
+void RecipeBook::print(FILE *fp)
 {
-   if (memcmp(a->code, b->code, MD5_SIZE) < 0)
+   fprintf(fp, "Recipes:\n");
+   for (int i = 0, i2 = (int)recipes.size(); i < i2; i++)
    {
-      return(true);
-   }
-   else
-   {
-      return(false);
+      recipes[i]->print(fp);
    }
 }
@@ -14,10 +14,13 @@
  * DISCLAIMED.
  */
 
+
 /*
  * Reaction: a recursive molecule decomposition into bonded components.
  * At each level, the molecule is divided by the weakest bonds.
  * This can be used as a "recipe" to create the molecule from atoms.
+ * Recipes are kept in a book by molecule code, so that each species
+ * is decomposed once, and components are shared between recipes.
  */
 
 #ifndef __REACTION__
@@ -25,37 +28,133 @@
 
 #include <stdio.h>
 #include <stdlib.h>
-#include <pair>
+#include <string.h>
 #include <vector>
 #include <assert.h>
-#include "chemistry.hpp"
+#include "molecule.hpp"
+#include "hashTable.hpp"
+#include "../utility/vector.hpp"
 using namespace std;
 
 namespace affinity
 {
+// Recipe bond between atom outer shell orbitals.
+class RecipeBond
+{
+public:
+
+   int   atom1, orbital1;
+   int   atom2, orbital2;
+   float force;                                   // covalent bonding force
+
+   // Constructor.
+   RecipeBond(int atom1 = -1, int orbital1 = -1, int atom2 = -1, int orbital2 = -1,
+              float force = 0.0f);
+};
+
+// Reaction recipe.
 class Reaction
 {
 public:
 
-   // The molecule.
-   Chemistry *molecule;
+   // Index in recipe book.
+   int id;
+
+   // Molecule code.
+   unsigned char code[MOLECULE_CODE_SIZE];
+
+   // Atomic numbers and bonds.
+   vector<int>        numbers;
+   vector<RecipeBond> bonds;
+
+   // Bond force dividing the molecule (0=single atom):
+   // bonds this weak or weaker are broken to split it.
+   float force;
+
+   // Components: atom k of component c is atom componentAtoms[c][k].
+   vector<Reaction *>   components;
+   vector<vector<int> > componentAtoms;
+
+   // Bonds joining the components.
+   vector<int> joins;
+
+   // Molecules recipe was requested for.
+   int count;
+
+   // Shared by code?
+   bool memo;
+
+   // Constructor.
+   Reaction();
+
+   // Create molecule in chemistry at position, returning atom IDs.
+   void synthesize(Chemistry *chemistry, Vector& position, vector<int>& atomIDs);
 
-   // Components.
+   // Print.
+   void print(FILE *fp = stdout);
+};
 
-   vector<Chemistry *> components;
+// Recipe book.
+class RecipeBook
+{
+public:
+
+   // Recipes, components before the molecules they make.
+   vector<Reaction *> recipes;
 
    // Constructor.
-   Reaction(Molecule *molecule);
+   RecipeBook();
 
    // Destructor.
-   ~Reaction();
+   ~RecipeBook();
+
+   // Clear.
+   void clear();
+
+   // Get recipe of molecule, decomposing its live bond graph
+   // if its species has none yet or shares its code with another graph.
+   Reaction *getRecipe(Molecule *molecule);
 
-   // Load and save reaction.
+   // Find recipe by code (NULL=none).
+   Reaction *find(unsigned char *code);
+
+   // Load and save recipes.
    void load(FILE *fp);
    void save(FILE *fp);
 
    // Print.
    void print(FILE *fp = stdout);
+
+private:
+
+   // Decompose molecule graph.
+   Reaction *decompose(vector<int>& numbers, vector<RecipeBond>& bonds,
+                       unsigned char *code, bool memo);
+
+   // Add recipe.
+   void insert(Reaction *recipe);
+
+   // Map recipe atoms onto an isomorphic graph (false=none).
+   bool match(Reaction *recipe, vector<int>& numbers,
+              vector<RecipeBond>& bonds, vector<int>& mapping);
+   bool match(vector<int>& order, vector<int>& parents, int k,
+              MoleculeGraph& graph1, MoleculeGraph& graph2,
+              vector<int>& mapping, vector<bool>& used);
+
+   // Generate code of molecule graph.
+   static void generateCode(vector<int>& numbers, vector<RecipeBond>& bonds,
+                            unsigned char *code);
+
+   // Get bond graph as adjacency lists, atom degrees and bond multiplicities.
+   static void getGraph(vector<int>& numbers, vector<RecipeBond>& bonds,
+                        MoleculeGraph& graph);
+   static int getDegree(MoleculeGraph& graph, int a);
+   static int getBonds(MoleculeGraph& graph, int a, int b);
+
+   // Memoized recipes hashed by code.
+   HashTable<Reaction> *table;
+   static unsigned long long getKey(unsigned char *code);
+   static unsigned long long getKey(Reaction *recipe);
 };
 }
 #endif
@@ -0,0 +1,534 @@
+/*
+ * This software is provided under the terms of the GNU General
+ * Public License as published by the Free Software Foundation.
+ *
+ * Copyright (c) 2006-2007 Tom Portegys, All Rights Reserved.
+ * Permission to use, copy, modify, and distribute this software
+ * and its documentation for NON-COMMERCIAL purposes and without
+ * fee is hereby granted provided that this copyright notice
+ * appears in all copies.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.
+ */
+
+
+
+/*
+ * Reaction network: species transformed by reactions.
+ */
+
+#include "reactionNetwork.hpp"
+#include "chemistry.hpp"
+using namespace affinity;
+
+// Initial number of hash buckets (power of 2).
+#define INITIAL_REACTION_BUCKETS    64
+
+// FNV-1a hash parameters.
+#define HASH_OFFSET                 0xcbf29ce484222325ULL
+#define HASH_PRIME                  0x100000001b3ULL
+
+// Default rate decay window (cycles).
+const float ReactionNetwork::DEFAULT_RATE_WINDOW = 1000.0f;
+
+// Default longest autocatalytic cycle searched (reactions).
+const int ReactionNetwork::DEFAULT_MAX_CYCLE_LENGTH = 6;
+
+// Reaction type constructor.
+ReactionType::ReactionType(vector<int>& reactants, vector<int>& products,
+                           unsigned long long hash, int cycle)
+{
+   id              = -1;
+   this->reactants = reactants;
+   this->products  = products;
+   this->hash      = hash;
+   firstCycle      = lastCycle = rateCycle = cycle;
+   count           = 0;
+   rate            = 0.0f;
+}
+
+
+// Record occurrence at update cycle.
+void ReactionType::occur(int cycle, float rateWindow)
+{
+   rate      = getRate(cycle, rateWindow) + (1.0f / rateWindow);
+   rateCycle = lastCycle = cycle;
+   count++;
+}
+
+
+// Get rate decayed to update cycle.
+float ReactionType::getRate(int cycle, float rateWindow)
+{
+   return(rate * (float)exp(-(double)(cycle - rateCycle) / (double)rateWindow));
+}
+
+
+// Print reaction.
+void ReactionType::print(FILE *fp)
+{
+   int i, i2;
+
+   fprintf(fp, "R%d: ", id);
+   for (i = 0, i2 = (int)reactants.size(); i < i2; i++)
+   {
+      fprintf(fp, "%sS%d", (i > 0 ? " + " : ""), reactants[i]);
+   }
+   fprintf(fp, " -> ");
+   for (i = 0, i2 = (int)products.size(); i < i2; i++)
+   {
+      fprintf(fp, "%sS%d", (i > 0 ? " + " : ""), products[i]);
+   }
+   fprintf(fp, "\nCount=%d, first cycle=%d, last cycle=%d, rate=%f\n",
+           count, firstCycle, lastCycle, rate);
+}
+
+
+// Get hash of reactants and products.
+unsigned long long ReactionType::getHash(vector<int>& reactants, vector<int>& products)
+{
+   int                i, i2;
+   unsigned long long h;
+
+   h = HASH_OFFSET;
+   for (i = 0, i2 = (int)reactants.size(); i < i2; i++)
+   {
+      h = (h ^ (unsigned long long)reactants[i]) * HASH_PRIME;
+   }
+   h = (h ^ (unsigned long long)-1) * HASH_PRIME;
+   for (i = 0, i2 = (int)products.size(); i < i2; i++)
+   {
+      h = (h ^ (unsigned long long)products[i]) * HASH_PRIME;
+   }
+   return(h);
+}
+
+
+// Print autocatalytic cycle.
+void AutocatalyticCycle::print(FILE *fp)
+{
+   int i, i2;
+
+   fprintf(fp, "Cycle=%d, growth=%d: ", cycle, growth);
+   for (i = 0, i2 = (int)reactions.size(); i < i2; i++)
+   {
+      fprintf(fp, "S%d -R%d-> ", species[i], reactions[i]);
+   }
+   fprintf(fp, "S%d\n", species[0]);
+}
+
+
+// Network constructor.
+ReactionNetwork::ReactionNetwork(SpeciesRegistry *speciesRegistry,
+                                 float rateWindow, int maxCycleLength)
+{
+   assert(rateWindow > 0.0f && maxCycleLength > 0);
+   this->speciesRegistry = speciesRegistry;
+   this->rateWindow      = rateWindow;
+   this->maxCycleLength  = maxCycleLength;
+   table = new HashTable<ReactionType>(INITIAL_REACTION_BUCKETS, getKey);
+   assert(table != NULL);
+}
+
+
+// Network destructor.
+ReactionNetwork::~ReactionNetwork()
+{
+   clear();
+   delete table;
+}
+
+
+// Clear network.
+void ReactionNetwork::clear()
+{
+   int i, i2;
+
+   for (i = 0, i2 = (int)reactions.size(); i < i2; i++)
+   {
+      delete reactions[i];
+   }
+   reactions.clear();
+   for (i = 0, i2 = (int)cycles.size(); i < i2; i++)
+   {
+      delete cycles[i];
+   }
+   cycles.clear();
+   participantSpecies.clear();
+   participantSide.clear();
+   participantStart.clear();
+   participantAtoms.clear();
+   consumers.clear();
+   producers.clear();
+   speciesOnPath.clear();
+   pathReactions.clear();
+   pathSpecies.clear();
+   table->clear();
+}
+
+
+// Molecule consumed since last update.
+void ReactionNetwork::consume(Molecule *molecule)
+{
+   addParticipant(molecule, 0);
+}
+
+
+// Molecule produced since last update.
+void ReactionNetwork::produce(Molecule *molecule)
+{
+   addParticipant(molecule, 1);
+}
+
+
+// Add reaction participant.
+void ReactionNetwork::addParticipant(Molecule *molecule, int side)
+{
+   if (molecule->species == NULL)
+   {
+      return;
+   }
+   participantSpecies.push_back(molecule->species->id);
+   participantSide.push_back(side);
+   participantStart.push_back((int)participantAtoms.size());
+   participantAtoms.insert(participantAtoms.end(),
+                           molecule->atomIDs.begin(), molecule->atomIDs.end());
+}
+
+
+// Get participant group, halving paths.
+int ReactionNetwork::getGroup(int participant)
+{
+   while (participantGroups[participant] != participant)
+   {
+      participantGroups[participant] = participantGroups[participantGroups[participant]];
+      participant = participantGroups[participant];
+   }
+   return(participant);
+}
+
+
+// Group consumed and produced molecules into reactions at update cycle:
+// Molecules sharing atoms belong to the same reaction. Groups that
+// create or lose atoms, or whose species are unchanged, are not reactions.
+int ReactionNetwork::update(int cycle)
+{
+   int          i, i2, j, j2, n, g, id, occurrences;
+   int          atomBalance;
+   ReactionType *reaction;
+
+   vector<pair<int, int> > groups;
+   vector<int>             reactants, products;
+
+   n = (int)participantSpecies.size();
+   participantStart.push_back((int)participantAtoms.size());
+   participantGroups.resize(n);
+   for (i = 0; i < n; i++)
+   {
+      participantGroups[i] = i;
+   }
+   for (i = 0; i < n; i++)
+   {
+      for (j = participantStart[i], j2 = participantStart[i + 1]; j < j2; j++)
+      {
+         id = participantAtoms[j];
+         if (id >= (int)atomOwners.size())
+         {
+            atomOwners.resize(id + 1, -1);
+         }
+         if (atomOwners[id] == -1)
+         {
+            atomOwners[id] = i;
+         }
+         else
+         {
+            participantGroups[getGroup(i)] = getGroup(atomOwners[id]);
+         }
+      }
+   }
+   for (i = 0, i2 = (int)participantAtoms.size(); i < i2; i++)
+   {
+      atomOwners[participantAtoms[i]] = -1;
+   }
+   for (i = 0; i < n; i++)
+   {
+      groups.push_back(pair<int, int>(getGroup(i), i));
+   }
+   sort(groups.begin(), groups.end());
+
+   occurrences = 0;
+   for (i = 0; i < n; i = j)
+   {
+      g = groups[i].first;
+      reactants.clear();
+      products.clear();
+      atomBalance = 0;
+      for (j = i; j < n && groups[j].first == g; j++)
+      {
+         id = groups[j].second;
+         if (participantSide[id] == 0)
+         {
+            reactants.push_back(participantSpecies[id]);
+            atomBalance += participantStart[id + 1] - participantStart[id];
+         }
+         else
+         {
+            products.push_back(participantSpecies[id]);
+            atomBalance -= participantStart[id + 1] - participantStart[id];
+         }
+      }
+      if ((reactants.size() == 0) || (products.size() == 0) || (atomBalance != 0))
+      {
+         continue;
+      }
+      sort(reactants.begin(), reactants.end());
+      sort(products.begin(), products.end());
+      if (reactants == products)
+      {
+         continue;
+      }
+      reaction = insert(reactants, products, cycle);
+      reaction->occur(cycle, rateWindow);
+      occurrences++;
+   }
+
+   participantSpecies.clear();
+   participantSide.clear();
+   participantStart.clear();
+   participantAtoms.clear();
+   return(occurrences);
+}
+
+
+// Get hash key of reaction.
+unsigned long long ReactionNetwork::getKey(ReactionType *reaction)
+{
+   return(reaction->hash);
+}
+
+
+// Find reaction.
+ReactionType *ReactionNetwork::find(vector<int>& reactants, vector<int>& products)
+{
+   int                i, i2;
+   unsigned long long hash;
+   ReactionType       *r;
+
+   hash = ReactionType::getHash(reactants, products);
+   vector<ReactionType *>& bucket = table->getBucket(hash);
+   for (i = 0, i2 = (int)bucket.size(); i < i2; i++)
+   {
+      r = bucket[i];
+      if ((r->hash == hash) && (r->reactants == reactants) && (r->products == products))
+      {
+         return(r);
+      }
+   }
+   return(NULL);
+}
+
+
+// Find or add reaction.
+ReactionType *ReactionNetwork::insert(vector<int>& reactants, vector<int>& products, int cycle)
+{
+   int          i, i2;
+   ReactionType *r;
+
+   if ((r = find(reactants, products)) != NULL)
+   {
+      return(r);
+   }
+   r = new ReactionType(reactants, products,
+                        ReactionType::getHash(reactants, products), cycle);
+   assert(r != NULL);
+   r->id = (int)reactions.size();
+   reactions.push_back(r);
+   table->insert(r);
+
+   // Check for cycles closed by the reaction, then link it.
+   i = (int)speciesRegistry->species.size();
+   if ((int)consumers.size() < i)
+   {
+      consumers.resize(i);
+      producers.resize(i);
+      speciesOnPath.resize(i, false);
+   }
+   findCycles(r);
+   for (i = 0, i2 = (int)reactants.size(); i < i2; i++)
+   {
+      if ((i == 0) || (reactants[i] != reactants[i - 1]))
+      {
+         consumers[reactants[i]].push_back(r->id);
+      }
+   }
+   for (i = 0, i2 = (int)products.size(); i < i2; i++)
+   {
+      if ((i == 0) || (products[i] != products[i - 1]))
+      {
+         producers[products[i]].push_back(r->id);
+      }
+   }
+   return(r);
+}
+
+
+// Find autocatalytic cycles closed by a new reaction:
+// Enumerate simple paths in the species graph of up to maxCycleLength - 1
+// reactions from each product back to each reactant, keeping cycles
+// whose species gain on a turn.
+void ReactionNetwork::findCycles(ReactionType *reaction)
+{
+   int i, i2;
+
+   for (i = 0, i2 = (int)reaction->products.size(); i < i2; i++)
+   {
+      if ((i > 0) && (reaction->products[i] == reaction->products[i - 1]))
+      {
+         continue;
+      }
+      pathReactions.clear();
+      pathSpecies.clear();
+      findPaths(reaction, reaction->products[i]);
+   }
+}
+
+
+// Extend simple path at species, closing a cycle if it is a reactant.
+// Path reaction k consumes path species k.
+void ReactionNetwork::findPaths(ReactionType *reaction, int species)
+{
+   int                i, i2, j, j2;
+   ReactionType       *q;
+   AutocatalyticCycle *c;
+
+   if (binary_search(reaction->reactants.begin(), reaction->reactants.end(), species))
+   {
+      c = new AutocatalyticCycle();
+      assert(c != NULL);
+      c->reactions.push_back(reaction->id);
+      c->species.push_back(species);
+      c->reactions.insert(c->reactions.end(), pathReactions.begin(), pathReactions.end());
+      c->species.insert(c->species.end(), pathSpecies.begin(), pathSpecies.end());
+      c->growth = getGrowth(c->reactions, c->species);
+      c->cycle  = reaction->firstCycle;
+      if ((c->growth > 0) && !hasCycle(c->reactions))
+      {
+         cycles.push_back(c);
+      }
+      else
+      {
+         delete c;
+      }
+   }
+   if ((int)pathReactions.size() + 1 >= maxCycleLength)
+   {
+      return;
+   }
+   speciesOnPath[species] = true;
+   pathSpecies.push_back(species);
+   for (i = 0, i2 = (int)consumers[species].size(); i < i2; i++)
+   {
+      q = reactions[consumers[species][i]];
+      if (std::find(pathReactions.begin(), pathReactions.end(), q->id) != pathReactions.end())
+      {
+         continue;
+      }
+      pathReactions.push_back(q->id);
+      for (j = 0, j2 = (int)q->products.size(); j < j2; j++)
+      {
+         if (((j > 0) && (q->products[j] == q->products[j - 1])) ||
+             speciesOnPath[q->products[j]])
+         {
+            continue;
+         }
+         findPaths(reaction, q->products[j]);
+      }
+      pathReactions.pop_back();
+   }
+   pathSpecies.pop_back();
+   speciesOnPath[species] = false;
+}
+
+
+// Get net gain of cycle species when each cycle reaction occurs once.
+int ReactionNetwork::getGrowth(vector<int>& cycleReactions, vector<int>& cycleSpecies)
+{
+   int          i, i2, j, j2, growth;
+   ReactionType *r;
+
+   vector<int> species = cycleSpecies;
+
+   sort(species.begin(), species.end());
+   growth = 0;
+   for (i = 0, i2 = (int)cycleReactions.size(); i < i2; i++)
+   {
+      r = reactions[cycleReactions[i]];
+      for (j = 0, j2 = (int)r->products.size(); j < j2; j++)
+      {
+         if (binary_search(species.begin(), species.end(), r->products[j]))
+         {
+            growth++;
+         }
+      }
+      for (j = 0, j2 = (int)r->reactants.size(); j < j2; j++)
+      {
+         if (binary_search(species.begin(), species.end(), r->reactants[j]))
+         {
+            growth--;
+         }
+      }
+   }
+   return(growth);
+}
+
+
+// Cycle already found?
+bool ReactionNetwork::hasCycle(vector<int>& cycleReactions)
+{
+   int i, i2;
+
+   vector<int> a = cycleReactions, b;
+
+   sort(a.begin(), a.end());
+   for (i = 0, i2 = (int)cycles.size(); i < i2; i++)
+   {
+      if (cycles[i]->reactions.size() != a.size())
+      {
+         continue;
+      }
+      b = cycles[i]->reactions;
+      sort(b.begin(), b.end());
+      if (a == b)
+      {
+         return(true);
+      }
+   }
+   return(false);
+}
+
+
+// Print network.
+void ReactionNetwork::print(FILE *fp)
+{
+   int i, i2;
+
+   fprintf(fp, "Species:\n");
+   for (i = 0, i2 = (int)speciesRegistry->species.size(); i < i2; i++)
+   {
+      fprintf(fp, "S%d: ", i);
+      speciesRegistry->species[i]->print(fp);
+   }
+   fprintf(fp, "Reactions:\n");
+   for (i = 0, i2 = (int)reactions.size(); i < i2; i++)
+   {
+      reactions[i]->print(fp);
+   }
+   fprintf(fp, "Autocatalytic cycles:\n");
+   for (i = 0, i2 = (int)cycles.size(); i < i2; i++)
+   {
+      cycles[i]->print(fp);
+   }
+}
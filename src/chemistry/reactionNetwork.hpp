@@ -0,0 +1,188 @@
+/*
+ * This software is provided under the terms of the GNU General
+ * Public License as published by the Free Software Foundation.
+ *
+ * Copyright (c) 2006-2007 Tom Portegys, All Rights Reserved.
+ * Permission to use, copy, modify, and distribute this software
+ * and its documentation for NON-COMMERCIAL purposes and without
+ * fee is hereby granted provided that this copyright notice
+ * appears in all copies.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.
+ */
+
+
+
+/*
+ * Reaction network: species transformed by reactions.
+ * Molecules consumed and produced between molecule generations are
+ * grouped by shared atoms into reactions (reactant species to product
+ * species), which are counted as a persistent species/reaction graph.
+ * Each new reaction is checked for closing an autocatalytic cycle.
+ */
+
+#ifndef __REACTION_NETWORK__
+#define __REACTION_NETWORK__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <vector>
+#include <algorithm>
+#include <assert.h>
+#include "species.hpp"
+using namespace std;
+
+namespace affinity
+{
+// Reaction type: reactant species to product species.
+class ReactionType
+{
+public:
+
+   // Index in network reactions.
+   int id;
+
+   // Sorted reactant and product species IDs (repeated by multiplicity).
+   vector<int> reactants;
+   vector<int> products;
+
+   // Hash of reactants and products.
+   unsigned long long hash;
+
+   // Update cycles first and last seen.
+   int firstCycle;
+   int lastCycle;
+
+   // Occurrences.
+   int count;
+
+   // Decaying occurrence rate per cycle.
+   float rate;
+   int   rateCycle;
+
+   // Constructor.
+   ReactionType(vector<int>& reactants, vector<int>& products,
+                unsigned long long hash, int cycle);
+
+   // Record occurrence at update cycle.
+   void occur(int cycle, float rateWindow);
+
+   // Get rate decayed to update cycle.
+   float getRate(int cycle, float rateWindow);
+
+   // Print.
+   void print(FILE *fp = stdout);
+
+   // Get hash of reactants and products.
+   static unsigned long long getHash(vector<int>& reactants, vector<int>& products);
+};
+
+// Autocatalytic cycle:
+// Reactions each consuming a cycle species and producing the next,
+// with a net gain of cycle species when each reaction occurs once.
+class AutocatalyticCycle
+{
+public:
+
+   // Reactions and species around the cycle.
+   vector<int> reactions;
+   vector<int> species;
+
+   // Net gain of cycle species.
+   int growth;
+
+   // Update cycle detected.
+   int cycle;
+
+   // Print.
+   void print(FILE *fp = stdout);
+};
+
+// Reaction network.
+class ReactionNetwork
+{
+public:
+
+   static const float DEFAULT_RATE_WINDOW;
+   static const int   DEFAULT_MAX_CYCLE_LENGTH;
+
+   // Species registry giving species IDs.
+   SpeciesRegistry *speciesRegistry;
+
+   // Reactions in order first seen.
+   vector<ReactionType *> reactions;
+
+   // Autocatalytic cycles in order detected.
+   vector<AutocatalyticCycle *> cycles;
+
+   // Rate decay window (cycles) and longest cycle searched (reactions).
+   float rateWindow;
+   int   maxCycleLength;
+
+   // Constructor.
+   ReactionNetwork(SpeciesRegistry *speciesRegistry,
+                   float rateWindow   = DEFAULT_RATE_WINDOW,
+                   int maxCycleLength = DEFAULT_MAX_CYCLE_LENGTH);
+
+   // Destructor.
+   ~ReactionNetwork();
+
+   // Clear.
+   void clear();
+
+   // Molecule consumed or produced since last update.
+   void consume(Molecule *molecule);
+   void produce(Molecule *molecule);
+
+   // Group consumed and produced molecules into reactions at update cycle.
+   // Returns number of reaction occurrences.
+   int update(int cycle);
+
+   // Find reaction (NULL=none).
+   ReactionType *find(vector<int>& reactants, vector<int>& products);
+
+   // Print.
+   void print(FILE *fp = stdout);
+
+private:
+
+   // Consumed and produced molecules since last update:
+   // species, side (0=consumed, 1=produced) and atoms.
+   vector<int> participantSpecies;
+   vector<int> participantSide;
+   vector<int> participantStart;
+   vector<int> participantAtoms;
+   void addParticipant(Molecule *molecule, int side);
+
+   // Participant grouping.
+   vector<int> atomOwners;
+   vector<int> participantGroups;
+   int getGroup(int participant);
+
+   // Reactions hashed by reactant and product species.
+   HashTable<ReactionType> *table;
+   static unsigned long long getKey(ReactionType *reaction);
+
+   // Reactions by consumed and produced species.
+   vector<vector<int> > consumers;
+   vector<vector<int> > producers;
+
+   // Add reaction and check for autocatalytic cycles through it.
+   ReactionType *insert(vector<int>& reactants, vector<int>& products, int cycle);
+   void findCycles(ReactionType *reaction);
+   void findPaths(ReactionType *reaction, int species);
+   int getGrowth(vector<int>& reactions, vector<int>& species);
+   bool hasCycle(vector<int>& reactions);
+
+   // Cycle search: species on current path, and path reactions
+   // with the species each consumes.
+   vector<bool> speciesOnPath;
+   vector<int>  pathReactions;
+   vector<int>  pathSpecies;
+};
+}
+#endif
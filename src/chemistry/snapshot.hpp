@@ -0,0 +1,152 @@
+/*
+ * This software is provided under the terms of the GNU General
+ * Public License as published by the Free Software Foundation.
+ *
+ * Copyright (c) 2006-2007 Tom Portegys, All Rights Reserved.
+ * Permission to use, copy, modify, and distribute this software
+ * and its documentation for NON-COMMERCIAL purposes and without
+ * fee is hereby granted provided that this copyright notice
+ * appears in all copies.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.
+ */
+
+
+/*
+ * Chemistry snapshot format version 2.
+ * A binary snapshot is a header followed by contiguous sections of
+ * fixed size records, so that it can be loaded with a single read.
+ * Section offsets are from the start of the header and 8-byte aligned.
+ */
+
+#ifndef __SNAPSHOT__
+#define __SNAPSHOT__
+
+// Snapshot identification.
+#define SNAPSHOT_MAGIC         "AFSN"
+#define SNAPSHOT_MAGIC_SIZE    4
+#define SNAPSHOT_VERSION       2
+#define SNAPSHOT_BYTE_ORDER    0x01020304u
+
+// Text format identification: text saves begin with this marker and
+// a version. Earlier text files have neither; they go from the vessel
+// radius straight to the random state.
+#define TEXT_FORMAT_MAGIC      "AFTX"
+#define TEXT_FORMAT_VERSION    1
+
+namespace affinity
+{
+// Snapshot header.
+struct SnapshotHeader
+{
+   char         magic[SNAPSHOT_MAGIC_SIZE];
+   int          version;
+   unsigned int byteOrder;                        // SNAPSHOT_BYTE_ORDER as written
+   int          headerSize;
+   int          size;                             // header and sections
+   int          numAtoms;
+   int          numShells;
+   int          numBodies;
+   int          numBonds;
+   int          numThermals;
+   int          randomSize;                       // random state words
+   int          parametersOffset;
+   int          stateOffset;
+   int          randomOffset;
+   int          atomsOffset;
+   int          shellsOffset;
+   int          bodiesOffset;
+   int          bondsOffset;
+   int          thermalsOffset;
+};
+
+// Chemistry parameters.
+struct SnapshotParameters
+{
+   float MIN_ATOM_INITIAL_FORCE;
+   float MAX_ATOM_INITIAL_FORCE;
+   int   MIN_NUCLEUS_PROTONS;
+   int   MAX_NUCLEUS_PROTONS;
+   float PROTON_MASS;
+   float ELECTRON_MASS;
+   float PROTON_CHARGE;
+   float ELECTRON_CHARGE;
+   float CHARGE_GAUSSIAN_SPREAD;
+   float NUCLEUS_BODY_RADIUS;
+   float ORBITAL_BODY_RADIUS;
+   float MAX_BODY_RANGE;
+   float BOND_LENGTH;
+   float BOND_STIFFNESS;
+   float BOND_DAMPER;
+   float NUCLEAR_REPULSION_STIFFNESS;
+   float COVALENT_BONDING_RANGE;
+   float MIN_COVALENT_BOND_FORCE;
+   float COVALENT_BOND_STIFFNESS_SCALE;
+   float MIN_THERMAL_RADIUS;
+   float MAX_THERMAL_RADIUS;
+   float MIN_THERMAL_TEMPERATURE;
+   float MAX_TEMPERATURE;
+   float UPDATE_STEP;
+};
+
+// Chemistry state.
+struct SnapshotState
+{
+   double updateTime;
+   int    atomIDfactory;
+   float  vesselRadius;
+   float  minUpdateStep;
+   float  maxUpdateStep;
+   float  updateStep;
+   int    updateCycle;
+   int    randomIndex;                            // random state index
+};
+
+// Atom: its shells and bodies follow those of the previous atom.
+struct SnapshotAtom
+{
+   int number;
+   int numShells;
+};
+
+// Shell.
+struct SnapshotShell
+{
+   int number;
+   int numOrbitals;
+};
+
+// Body: an atom nucleus followed by its orbitals in shell order.
+struct SnapshotBody
+{
+   int   id;
+   int   shell;
+   int   orbital;
+   float mass;
+   float radius;
+   float charge;
+   float valence[2];
+   int   hasValence;
+   float position[3];
+   float velocity[3];
+};
+
+// Covalent bond between bodies.
+struct SnapshotBond
+{
+   int id1, shell1, orbital1;
+   int id2, shell2, orbital2;
+};
+
+// Thermal.
+struct SnapshotThermal
+{
+   float radius;
+   float position[3];
+   float temperature;
+};
+}
+#endif
@@ -0,0 +1,269 @@
+/*
+ * This software is provided under the terms of the GNU General
+ * Public License as published by the Free Software Foundation.
+ *
+ * Copyright (c) 2006-2007 Tom Portegys, All Rights Reserved.
+ * Permission to use, copy, modify, and distribute this software
+ * and its documentation for NON-COMMERCIAL purposes and without
+ * fee is hereby granted provided that this copyright notice
+ * appears in all copies.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.
+ */
+
+
+/*
+ * Species: a registry of molecule types keyed by formula and code.
+ */
+
+#include "species.hpp"
+#include "chemistry.hpp"
+using namespace affinity;
+
+// Species constructor.
+Species::Species(Molecule *molecule, bool closed, int cycle, bool coding)
+{
+   int  i, i2;
+   Atom *atom;
+
+   id      = -1;
+   formula = molecule->formula;
+   coded   = molecule->coded;
+   graph   = NULL;
+   if (coded)
+   {
+      memcpy(code, molecule->code, MOLECULE_CODE_SIZE);
+   }
+   else if (coding)
+   {
+      graph = new MoleculeGraph();
+      assert(graph != NULL);
+      molecule->getGraph(*graph);
+   }
+   firstCycle   = cycle;
+   count        = peakCount = 0;
+   size         = molecule->size();
+   presentIndex = -1;
+   this->closed = closed;
+   for (i = 0, i2 = (int)molecule->atomIDs.size(); i < i2; i++)
+   {
+      atom = molecule->chemistry->getAtom(molecule->atomIDs[i]);
+      if (atom->number >= (int)composition.size())
+      {
+         composition.resize(atom->number + 1, 0);
+      }
+      composition[atom->number]++;
+   }
+}
+
+
+// Species destructor.
+Species::~Species()
+{
+   if (graph != NULL)
+   {
+      delete graph;
+   }
+}
+
+
+// Generate code if not yet coded.
+void Species::generateCode()
+{
+   if (!coded)
+   {
+      graph->generateCode(code);
+      coded = true;
+      delete graph;
+      graph = NULL;
+   }
+}
+
+
+// Print species.
+void Species::print(FILE *fp)
+{
+   int i, i2;
+
+   fprintf(fp, "Composition (number/count): ");
+   for (i = 0, i2 = (int)composition.size(); i < i2; i++)
+   {
+      if (composition[i] > 0)
+      {
+         fprintf(fp, "%d/%d ", i, composition[i]);
+      }
+   }
+   fprintf(fp, "\n");
+   fprintf(fp, "Size=%d, first cycle=%d, count=%d, peak=%d, closed=%d\n",
+           size, firstCycle, count, peakCount, closed ? 1 : 0);
+}
+
+
+// Registry constructor.
+SpeciesRegistry::SpeciesRegistry(bool byFormula)
+{
+   this->byFormula = byFormula;
+   table           = new HashTable<Species>(INITIAL_SPECIES_BUCKETS, getKey);
+   assert(table != NULL);
+   numMolecules = numAtoms = numClosed = numClosedAtoms = numClosedTypes = 0;
+}
+
+
+// Registry destructor.
+SpeciesRegistry::~SpeciesRegistry()
+{
+   clear();
+   delete table;
+}
+
+
+// Clear registry.
+void SpeciesRegistry::clear()
+{
+   int i, i2;
+
+   for (i = 0, i2 = (int)species.size(); i < i2; i++)
+   {
+      delete species[i];
+   }
+   species.clear();
+   present.clear();
+   numMolecules = numAtoms = numClosed = numClosedAtoms = numClosedTypes = 0;
+   table->clear();
+}
+
+
+// Get hash key of species.
+unsigned long long SpeciesRegistry::getKey(Species *species)
+{
+   return(species->formula);
+}
+
+
+// Find species of molecule.
+// Codes are generated only when another species has the same formula.
+Species *SpeciesRegistry::find(Molecule *molecule, bool closed)
+{
+   int     i, i2;
+   Species *s;
+
+   vector<Species *>& bucket = table->getBucket(molecule->formula);
+   for (i = 0, i2 = (int)bucket.size(); i < i2; i++)
+   {
+      s = bucket[i];
+      if ((s->formula != molecule->formula) || (s->closed != closed))
+      {
+         continue;
+      }
+      if (byFormula)
+      {
+         return(s);
+      }
+      molecule->generateCode();
+      s->generateCode();
+      if (memcmp(s->code, molecule->code, MOLECULE_CODE_SIZE) == 0)
+      {
+         return(s);
+      }
+   }
+   return(NULL);
+}
+
+
+// Find or add species of molecule.
+Species *SpeciesRegistry::insert(Molecule *molecule, bool closed, int cycle)
+{
+   Species *s;
+
+   if ((s = find(molecule, closed)) != NULL)
+   {
+      return(s);
+   }
+   s = new Species(molecule, closed, cycle, !byFormula);
+   assert(s != NULL);
+   s->id = (int)species.size();
+   species.push_back(s);
+   table->insert(s);
+   return(s);
+}
+
+
+// Add molecule at update cycle, setting its species.
+void SpeciesRegistry::add(Molecule *molecule, int cycle)
+{
+   Species *s;
+
+   s = molecule->species = insert(molecule, molecule->isClosed(), cycle);
+   if (s->count == 0)
+   {
+      s->presentIndex = (int)present.size();
+      present.push_back(s);
+      if (s->closed)
+      {
+         numClosedTypes++;
+      }
+   }
+   s->count++;
+   if (s->count > s->peakCount)
+   {
+      s->peakCount = s->count;
+   }
+   numMolecules++;
+   numAtoms += s->size;
+   if (s->closed)
+   {
+      numClosed++;
+      numClosedAtoms += s->size;
+   }
+}
+
+
+// Remove molecule.
+void SpeciesRegistry::remove(Molecule *molecule)
+{
+   int     i;
+   Species *s;
+
+   if ((s = molecule->species) == NULL)
+   {
+      return;
+   }
+   molecule->species = NULL;
+   assert(s->count > 0);
+   s->count--;
+   if (s->count == 0)
+   {
+      i = s->presentIndex;
+      present[i] = present.back();
+      present[i]->presentIndex = i;
+      present.pop_back();
+      s->presentIndex = -1;
+      if (s->closed)
+      {
+         numClosedTypes--;
+      }
+   }
+   numMolecules--;
+   numAtoms -= s->size;
+   if (s->closed)
+   {
+      numClosed--;
+      numClosedAtoms -= s->size;
+   }
+}
+
+
+// Print registry.
+void SpeciesRegistry::print(FILE *fp)
+{
+   int i, i2;
+
+   fprintf(fp, "Species:\n");
+   for (i = 0, i2 = (int)species.size(); i < i2; i++)
+   {
+      species[i]->print(fp);
+   }
+}
@@ -0,0 +1,143 @@
+/*
+ * This software is provided under the terms of the GNU General
+ * Public License as published by the Free Software Foundation.
+ *
+ * Copyright (c) 2006-2007 Tom Portegys, All Rights Reserved.
+ * Permission to use, copy, modify, and distribute this software
+ * and its documentation for NON-COMMERCIAL purposes and without
+ * fee is hereby granted provided that this copyright notice
+ * appears in all copies.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.
+ */
+
+
+/*
+ * Species: a registry of molecule types keyed by formula and code.
+ */
+
+#ifndef __SPECIES__
+#define __SPECIES__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include <assert.h>
+#include "molecule.hpp"
+#include "hashTable.hpp"
+using namespace std;
+
+// Initial number of hash buckets (power of 2).
+#define INITIAL_SPECIES_BUCKETS    64
+
+namespace affinity
+{
+// Species: a molecule type.
+class Species
+{
+public:
+
+   // Index in registry species.
+   int id;
+
+   // Molecule formula.
+   unsigned long long formula;
+
+   // Molecule code, generated on demand from a kept bond graph.
+   unsigned char code[MOLECULE_CODE_SIZE];
+   bool          coded;
+   MoleculeGraph *graph;
+
+   // Update cycle first seen.
+   int firstCycle;
+
+   // Current and peak molecule counts.
+   int count;
+   int peakCount;
+
+   // Molecule size (number of atoms).
+   int size;
+
+   // Closed (all bonds connected)?
+   bool closed;
+
+   // Composition: atom counts by atomic number.
+   vector<int> composition;
+
+   // Index in registry present species (-1=absent).
+   int presentIndex;
+
+   // Constructor.
+   // If coding, an uncoded molecule's bond graph is kept to code later.
+   Species(Molecule *molecule, bool closed, int cycle, bool coding = true);
+
+   // Destructor.
+   ~Species();
+
+   // Generate code if not yet coded.
+   void generateCode();
+
+   // Print.
+   void print(FILE *fp = stdout);
+};
+
+// Species registry.
+// Species persist once seen. Molecule counts and totals are kept
+// current as molecules are added and removed.
+// Species are bucketed by formula, and structural codes are only
+// generated to tell apart molecules whose formulas match. If byFormula
+// is set, species are formulas (split by closure) and never coded.
+class SpeciesRegistry
+{
+public:
+
+   // Species are formulas?
+   bool byFormula;
+
+   // Species in order first seen.
+   vector<Species *> species;
+
+   // Species present.
+   vector<Species *> present;
+
+   // Molecule totals: count, atoms, closed count and closed atoms.
+   int numMolecules;
+   int numAtoms;
+   int numClosed;
+   int numClosedAtoms;
+   int numClosedTypes;
+
+   // Constructor.
+   SpeciesRegistry(bool byFormula = false);
+
+   // Destructor.
+   ~SpeciesRegistry();
+
+   // Clear.
+   void clear();
+
+   // Find species of molecule.
+   Species *find(Molecule *molecule, bool closed);
+
+   // Find or add species of molecule.
+   Species *insert(Molecule *molecule, bool closed, int cycle);
+
+   // Add molecule at update cycle, setting its species.
+   void add(Molecule *molecule, int cycle);
+
+   // Remove molecule.
+   void remove(Molecule *molecule);
+
+   // Print.
+   void print(FILE *fp = stdout);
+
+   // Species hashed by formula.
+   HashTable<Species> *table;
+   static unsigned long long getKey(Species *species);
+};
+}
+#endif
@@ -0,0 +1,307 @@
+/*
+ * This software is provided under the terms of the GNU General
+ * Public License as published by the Free Software Foundation.
+ *
+ * Copyright (c) 2006-2007 Tom Portegys, All Rights Reserved.
+ * Permission to use, copy, modify, and distribute this software
+ * and its documentation for NON-COMMERCIAL purposes and without
+ * fee is hereby granted provided that this copyright notice
+ * appears in all copies.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.
+ */
+
+
+/*
+ * Molecule statistics service.
+ */
+
+#include "statsService.hpp"
+#include "chemistry.hpp"
+using namespace affinity;
+
+// Statistics constructor.
+MoleculeStats::MoleculeStats()
+{
+   num            = numClosed = numTypes = numClosedTypes = 0;
+   aveSize        = aveClosedSize = 0.0f;
+   cycle          = -1;
+}
+
+
+// Service constructor.
+StatsService::StatsService()
+{
+   byFormula = false;
+   cycle     = -1;
+   ready     = busy = false;
+#ifdef THREADS
+   terminate = false;
+   if (pthread_mutex_init(&mutex, NULL) != 0)
+   {
+      fprintf(stderr, "pthread_mutex_init failed, errno=%d\n", errno);
+      exit(1);
+   }
+   if (pthread_cond_init(&cond, NULL) != 0)
+   {
+      fprintf(stderr, "pthread_cond_init failed, errno=%d\n", errno);
+      exit(1);
+   }
+   if (pthread_create(&thread, NULL, run, (void *)this) != 0)
+   {
+      fprintf(stderr, "pthread_create failed, errno=%d\n", errno);
+      exit(1);
+   }
+#endif
+}
+
+
+// Service destructor.
+StatsService::~StatsService()
+{
+#ifdef THREADS
+   pthread_mutex_lock(&mutex);
+   terminate = true;
+   pthread_cond_broadcast(&cond);
+   pthread_mutex_unlock(&mutex);
+   pthread_join(thread, NULL);
+   pthread_cond_destroy(&cond);
+   pthread_mutex_destroy(&mutex);
+#endif
+}
+
+
+// Snapshot chemistry and compute its statistics.
+// Bonds are taken as for molecules, from outer shells.
+bool StatsService::request(Chemistry *chemistry)
+{
+   int  i, i2, j, j2;
+   Atom *atom;
+
+   vector<int> ids;
+
+#ifdef THREADS
+   pthread_mutex_lock(&mutex);
+   if (busy)
+   {
+      pthread_mutex_unlock(&mutex);
+      return(false);
+   }
+#endif
+   atomIDs.clear();
+   numbers.clear();
+   open.clear();
+   bonds.clear();
+   for (i = 0, i2 = (int)chemistry->atoms.size(); i < i2; i++)
+   {
+      atom = chemistry->atoms[i];
+      atomIDs.push_back(atom->getID());
+      numbers.push_back(atom->number);
+      open.push_back(Molecule::isOpen(atom));
+      Molecule::getBondedIDs(atom, ids);
+      for (j = 0, j2 = (int)ids.size(); j < j2; j++)
+      {
+         if (atom->getID() < ids[j])
+         {
+            bonds.push_back(pair<int, int>(atom->getID(), ids[j]));
+         }
+      }
+   }
+   byFormula = chemistry->speciesRegistry->byFormula;
+   cycle     = chemistry->updateCycle;
+   busy      = true;
+#ifdef THREADS
+   pthread_cond_broadcast(&cond);
+   pthread_mutex_unlock(&mutex);
+#else
+   compute(stats);
+   ready = true;
+   busy  = false;
+#endif
+   return(true);
+}
+
+
+// Get latest statistics.
+bool StatsService::getStats(MoleculeStats& stats)
+{
+   bool result;
+
+#ifdef THREADS
+   pthread_mutex_lock(&mutex);
+#endif
+   result = ready;
+   if (ready)
+   {
+      stats = this->stats;
+   }
+#ifdef THREADS
+   pthread_mutex_unlock(&mutex);
+#endif
+   return(result);
+}
+
+
+// Wait for statistics of last request.
+void StatsService::wait(MoleculeStats& stats)
+{
+#ifdef THREADS
+   pthread_mutex_lock(&mutex);
+   while (busy)
+   {
+      pthread_cond_wait(&cond, &mutex);
+   }
+   stats = this->stats;
+   pthread_mutex_unlock(&mutex);
+#else
+   stats = this->stats;
+#endif
+}
+
+
+#ifdef THREADS
+// Worker thread.
+void *StatsService::run(void *arg)
+{
+   StatsService  *service = (StatsService *)arg;
+   MoleculeStats result;
+
+   pthread_mutex_lock(&service->mutex);
+   while (true)
+   {
+      while (!service->busy && !service->terminate)
+      {
+         pthread_cond_wait(&service->cond, &service->mutex);
+      }
+      if (service->terminate)
+      {
+         break;
+      }
+      pthread_mutex_unlock(&service->mutex);
+      service->compute(result);
+      pthread_mutex_lock(&service->mutex);
+      service->stats = result;
+      service->ready = true;
+      service->busy  = false;
+      pthread_cond_broadcast(&service->cond);
+   }
+   pthread_mutex_unlock(&service->mutex);
+   return(NULL);
+}
+#endif
+
+
+// Compute statistics from snapshot.
+// Molecules are the connected components of the snapshot bond graph.
+// Molecules of the same formula and closure are told apart by code.
+void StatsService::compute(MoleculeStats& result)
+{
+   int                i, i2, j, j2, k, k2, n, a, closed, maxID, maxNumber;
+   unsigned long long formula;
+   MoleculeGraph      graph, molecule;
+
+   vector<int>                         index, moleculeStart, moleculeAtoms, atomCounts;
+   vector<pair<int, int> >             indexBonds;
+   vector<pair<pair<unsigned long long, int>, int> > keys;
+   vector<vector<unsigned char> >      codes;
+
+   // Index atoms by ID.
+   n     = (int)atomIDs.size();
+   maxID = maxNumber = 0;
+   for (i = 0; i < n; i++)
+   {
+      if (atomIDs[i] > maxID)
+      {
+         maxID = atomIDs[i];
+      }
+      if (numbers[i] > maxNumber)
+      {
+         maxNumber = numbers[i];
+      }
+   }
+   index.resize(maxID + 1, -1);
+   for (i = 0; i < n; i++)
+   {
+      index[atomIDs[i]] = i;
+   }
+
+   // Build bond graph and find molecules.
+   for (i = 0, i2 = (int)bonds.size(); i < i2; i++)
+   {
+      indexBonds.push_back(pair<int, int>(index[bonds[i].first],
+                                          index[bonds[i].second]));
+   }
+   graph.build(numbers, indexBonds);
+   graph.getComponents(moleculeStart, moleculeAtoms);
+
+   // Key molecules by formula and closure.
+   result       = MoleculeStats();
+   result.cycle = cycle;
+   atomCounts.resize(maxNumber + 1, 0);
+   for (i = 0, i2 = (int)moleculeStart.size() - 1; i < i2; i++)
+   {
+      j  = moleculeStart[i];
+      j2 = moleculeStart[i + 1];
+      for (k = j, closed = 1; k < j2; k++)
+      {
+         atomCounts[numbers[moleculeAtoms[k]]]++;
+         if (open[moleculeAtoms[k]])
+         {
+            closed = 0;
+         }
+      }
+      formula = Molecule::getFormula(atomCounts);
+      for (k = j; k < j2; k++)
+      {
+         atomCounts[numbers[moleculeAtoms[k]]] = 0;
+      }
+      keys.push_back(pair<pair<unsigned long long, int>, int>(
+                        pair<unsigned long long, int>(formula, closed), i));
+      result.num++;
+      result.aveSize += (float)(j2 - j);
+      if (closed == 1)
+      {
+         result.numClosed++;
+         result.aveClosedSize += (float)(j2 - j);
+      }
+   }
+
+   // Count types: distinct keys, split by code where keys collide.
+   sort(keys.begin(), keys.end());
+   for (i = 0, i2 = (int)keys.size(); i < i2; i = j)
+   {
+      for (j = i + 1; j < i2 && keys[j].first == keys[i].first; j++)
+      {
+      }
+      k = 1;
+      if (!byFormula && (j - i > 1))
+      {
+         codes.clear();
+         for (k2 = i; k2 < j; k2++)
+         {
+            a = keys[k2].second;
+            graph.getSubgraph(moleculeAtoms, moleculeStart[a], moleculeStart[a + 1], molecule);
+            codes.push_back(vector<unsigned char>(MOLECULE_CODE_SIZE));
+            molecule.generateCode(&codes.back()[0]);
+         }
+         sort(codes.begin(), codes.end());
+         k = (int)(unique(codes.begin(), codes.end()) - codes.begin());
+      }
+      result.numTypes += k;
+      if (keys[i].first.second == 1)
+      {
+         result.numClosedTypes += k;
+      }
+   }
+   if (result.num > 0)
+   {
+      result.aveSize /= (float)result.num;
+   }
+   if (result.numClosed > 0)
+   {
+      result.aveClosedSize /= (float)result.numClosed;
+   }
+}
@@ -0,0 +1,111 @@
+/*
+ * This software is provided under the terms of the GNU General
+ * Public License as published by the Free Software Foundation.
+ *
+ * Copyright (c) 2006-2007 Tom Portegys, All Rights Reserved.
+ * Permission to use, copy, modify, and distribute this software
+ * and its documentation for NON-COMMERCIAL purposes and without
+ * fee is hereby granted provided that this copyright notice
+ * appears in all copies.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.
+ */
+
+
+/*
+ * Molecule statistics service.
+ * Statistics are computed from a snapshot of the bond graph on a
+ * worker thread, so that the simulation is not blocked.
+ */
+
+#ifndef __STATS_SERVICE__
+#define __STATS_SERVICE__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include <utility>
+#include <assert.h>
+#ifdef THREADS
+#include <pthread.h>
+#endif
+#include "molecule.hpp"
+using namespace std;
+
+namespace affinity
+{
+class Chemistry;
+
+// Molecule statistics.
+class MoleculeStats
+{
+public:
+
+   int   num;
+   int   numClosed;
+   int   numTypes;
+   int   numClosedTypes;
+   float aveSize;
+   float aveClosedSize;
+
+   // Update cycle of snapshot (-1=none).
+   int cycle;
+
+   // Constructor.
+   MoleculeStats();
+};
+
+// Statistics service.
+class StatsService
+{
+public:
+
+   // Constructor.
+   StatsService();
+
+   // Destructor.
+   ~StatsService();
+
+   // Snapshot chemistry and compute its statistics.
+   // Returns false if still computing the previous snapshot.
+   bool request(Chemistry *chemistry);
+
+   // Get latest statistics; returns false if none yet.
+   bool getStats(MoleculeStats& stats);
+
+   // Wait for statistics of last request.
+   void wait(MoleculeStats& stats);
+
+private:
+
+   // Bond graph snapshot: atoms with atomic numbers and whether
+   // open (see Molecule::isOpen), and bonds as atom ID pairs.
+   vector<int>             atomIDs;
+   vector<int>             numbers;
+   vector<bool>            open;
+   vector<pair<int, int> > bonds;
+   bool                    byFormula;
+   int                     cycle;
+
+   // Latest statistics.
+   MoleculeStats stats;
+   bool          ready;
+   bool          busy;
+
+   // Compute statistics from snapshot.
+   void compute(MoleculeStats& result);
+
+#ifdef THREADS
+   pthread_t       thread;
+   pthread_mutex_t mutex;
+   pthread_cond_t  cond;
+   bool            terminate;
+   static void *run(void *service);
+#endif
+};
+}
+#endif
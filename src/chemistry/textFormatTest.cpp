@@ -0,0 +1,315 @@
+/*
+ * This software is provided under the terms of the GNU General
+ * Public License as published by the Free Software Foundation.
+ *
+ * Copyright (c) 2006-2007 Tom Portegys, All Rights Reserved.
+ * Permission to use, copy, modify, and distribute this software
+ * and its documentation for NON-COMMERCIAL purposes and without
+ * fee is hereby granted provided that this copyright notice
+ * appears in all copies.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.
+ */
+
+/**
+ * Chemistry file format regression test.
+ * A chemistry saved in the earlier unversioned text layout, in the
+ * versioned text format and as a binary snapshot must load back to
+ * the same atoms, bonds and thermals, leaving the file positioned
+ * after it as population files require. Snapshots with invalid atom
+ * or bond records must be rejected with a load error.
+ */
+
+#include "chemistry.hpp"
+#include <unistd.h>
+#include <sys/wait.h>
+using namespace affinity;
+
+// Saved formats.
+enum FORMAT { EARLIER_TEXT, TEXT, SNAPSHOT };
+char *FormatNames[] = { (char *)"earlier text", (char *)"text", (char *)"snapshot" };
+
+// Value written after each chemistry.
+#define SENTINEL    12345
+
+// Position tolerance for text formats.
+#define TOLERANCE    0.001f
+
+// Snapshot corruptions.
+enum CORRUPTION { ATOM_NUMBER, BOND_ORBITAL, BOND_NUCLEUS, BOND_REPEATED };
+char *CorruptionNames[] =
+{
+   (char *)"atomic number out of range", (char *)"bond orbital out of range",
+   (char *)"bond to nucleus",            (char *)"orbital bonded twice"
+};
+
+// Save chemistry in the earlier text layout: no format marker or
+// update step fields.
+void saveEarlierText(Chemistry *chemistry, FILE *fp)
+{
+   int  i, j;
+   Body *body;
+
+   chemistry->parameters->save(fp);
+   FWRITE_INT(&chemistry->atomIDfactory, fp);
+   FWRITE_FLOAT(&chemistry->vesselRadius, fp);
+   chemistry->randomizer->RAND_SAVE(fp);
+   j = (int)chemistry->atoms.size();
+   FWRITE_INT(&j, fp);
+   for (i = 0; i < j; i++)
+   {
+      chemistry->atoms[i]->save(fp);
+   }
+   j = (int)chemistry->bonds.size();
+   FWRITE_INT(&j, fp);
+   for (i = 0; i < j; i++)
+   {
+      body = chemistry->bonds[i].body1;
+      FWRITE_INT(&body->id, fp);
+      FWRITE_INT(&body->shell, fp);
+      FWRITE_INT(&body->orbital, fp);
+      body = chemistry->bonds[i].body2;
+      FWRITE_INT(&body->id, fp);
+      FWRITE_INT(&body->shell, fp);
+      FWRITE_INT(&body->orbital, fp);
+   }
+   j = (int)chemistry->thermals.size();
+   FWRITE_INT(&j, fp);
+   for (i = 0; i < j; i++)
+   {
+      chemistry->thermals[i]->save(fp);
+   }
+}
+
+
+// Report failure.
+bool fail(FORMAT format, const char *what)
+{
+   fprintf(stderr, "textFormatTest: %s format: %s\n", FormatNames[format], what);
+   return(false);
+}
+
+
+// Save chemistry in format, load it back and compare.
+bool check(Chemistry *chemistry, FORMAT format)
+{
+   int       i, i2, sentinel;
+   FILE      *fp;
+   Chemistry *loaded;
+   Atom      *atom, *atom2;
+   Body      *b1, *b2;
+   Vector    d;
+
+   if ((fp = tmpfile()) == NULL)
+   {
+      return(fail(format, "cannot open temporary file"));
+   }
+   switch (format)
+   {
+   case EARLIER_TEXT:
+      saveEarlierText(chemistry, fp);
+      break;
+
+   case TEXT:
+      chemistry->saveText(fp);
+      break;
+
+   case SNAPSHOT:
+      chemistry->save(fp);
+      break;
+   }
+   sentinel = SENTINEL;
+   FWRITE_INT(&sentinel, fp);
+   rewind(fp);
+#ifdef THREADS
+   loaded = new Chemistry(1.0f, (RANDOM)0, 1);
+#else
+   loaded = new Chemistry(1.0f, (RANDOM)0);
+#endif
+   assert(loaded != NULL);
+   loaded->load(fp);
+   sentinel = 0;
+   FREAD_INT(&sentinel, fp);
+   fclose(fp);
+
+   // Compare.
+   if (sentinel != SENTINEL)
+   {
+      return(fail(format, "file not positioned after chemistry"));
+   }
+   if ((loaded->atomIDfactory != chemistry->atomIDfactory) ||
+       (fabs(loaded->vesselRadius - chemistry->vesselRadius) > TOLERANCE))
+   {
+      return(fail(format, "chemistry fields differ"));
+   }
+   if (loaded->atoms.size() != chemistry->atoms.size())
+   {
+      return(fail(format, "atom count differs"));
+   }
+   for (i = 0, i2 = (int)chemistry->atoms.size(); i < i2; i++)
+   {
+      atom  = chemistry->atoms[i];
+      atom2 = loaded->atoms[i];
+      d     = atom->nucleus.position - atom2->nucleus.position;
+      if ((atom->getID() != atom2->getID()) || (atom->number != atom2->number) ||
+          (d.Magnitude() > TOLERANCE))
+      {
+         return(fail(format, "atoms differ"));
+      }
+   }
+   if (loaded->bonds.size() != chemistry->bonds.size())
+   {
+      return(fail(format, "bond count differs"));
+   }
+   for (i = 0, i2 = (int)chemistry->bonds.size(); i < i2; i++)
+   {
+      b1 = chemistry->bonds[i].body1;
+      b2 = loaded->getBody(b1->id, b1->shell, b1->orbital);
+      if ((b2 == NULL) || (b2->covalentBody == NULL) ||
+          (b2->covalentBody->id != chemistry->bonds[i].body2->id))
+      {
+         return(fail(format, "bonds differ"));
+      }
+   }
+   if (loaded->thermals.size() != chemistry->thermals.size())
+   {
+      return(fail(format, "thermal count differs"));
+   }
+   if (format == EARLIER_TEXT)
+   {
+      if ((loaded->updateCycle != 0) || (loaded->updateTime != 0.0) ||
+          (loaded->updateStep != loaded->parameters->UPDATE_STEP) ||
+          (loaded->minUpdateStep != 0.0f) || (loaded->maxUpdateStep != 0.0f))
+      {
+         return(fail(format, "update fields not defaulted"));
+      }
+   }
+   else
+   {
+      if ((loaded->updateCycle != chemistry->updateCycle) ||
+          (fabs(loaded->updateTime - chemistry->updateTime) > TOLERANCE) ||
+          (fabs(loaded->maxUpdateStep - chemistry->maxUpdateStep) > TOLERANCE))
+      {
+         return(fail(format, "update fields differ"));
+      }
+   }
+   delete loaded;
+   return(true);
+}
+
+
+// Load corrupted snapshot in a child process, which must exit with
+// a load error rather than load it or crash.
+bool checkRejected(Chemistry *chemistry, CORRUPTION corruption)
+{
+   int            status;
+   pid_t          pid;
+   FILE           *fp;
+   Chemistry      *loaded;
+   SnapshotHeader *header;
+   SnapshotBond   *bonds;
+
+   vector<char> buffer;
+
+   chemistry->save(buffer);
+   header = (SnapshotHeader *)&buffer[0];
+   bonds  = (SnapshotBond *)&buffer[header->bondsOffset];
+   switch (corruption)
+   {
+   case ATOM_NUMBER:
+      ((SnapshotAtom *)&buffer[header->atomsOffset])->number =
+         chemistry->parameters->MAX_NUCLEUS_PROTONS + 1;
+      break;
+
+   case BOND_ORBITAL:
+      bonds[0].orbital1 = 1000;
+      break;
+
+   case BOND_NUCLEUS:
+      bonds[0].shell1 = bonds[0].orbital1 = -1;
+      break;
+
+   case BOND_REPEATED:
+      bonds[1] = bonds[0];
+      break;
+   }
+   if ((fp = tmpfile()) == NULL)
+   {
+      fprintf(stderr, "textFormatTest: cannot open temporary file\n");
+      return(false);
+   }
+   if (fwrite(&buffer[0], buffer.size(), 1, fp) != 1)
+   {
+      fprintf(stderr, "textFormatTest: cannot write snapshot\n");
+      fclose(fp);
+      return(false);
+   }
+   rewind(fp);
+   fflush(stdout);
+   fflush(stderr);
+   if ((pid = fork()) == 0)
+   {
+      freopen("/dev/null", "w", stderr);
+#ifdef THREADS
+      loaded = new Chemistry(1.0f, (RANDOM)0, 1);
+#else
+      loaded = new Chemistry(1.0f, (RANDOM)0);
+#endif
+      assert(loaded != NULL);
+      loaded->load(fp);
+      _exit(0);
+   }
+   fclose(fp);
+   if ((pid < 0) || (waitpid(pid, &status, 0) != pid) ||
+       !WIFEXITED(status) || (WEXITSTATUS(status) != 1))
+   {
+      fprintf(stderr, "textFormatTest: snapshot with %s not rejected\n",
+              CorruptionNames[corruption]);
+      return(false);
+   }
+   return(true);
+}
+
+
+int
+main(int argc, char *argv[])
+{
+   int       i;
+   bool      result;
+   Chemistry *chemistry;
+   Vector    position(0.0f, 5.0f, 0.0f);
+
+#ifdef THREADS
+   chemistry = new Chemistry(15.0f, (RANDOM)7, 1);
+#else
+   chemistry = new Chemistry(15.0f, (RANDOM)7);
+#endif
+   assert(chemistry != NULL);
+   chemistry->minUpdateStep = 0.01f;
+   chemistry->maxUpdateStep = 0.5f;
+   chemistry->init(60);
+   chemistry->createThermal(2.0f, position, 8.0f);
+   for (i = 0; i < 50; i++)
+   {
+      chemistry->update();
+   }
+   if (chemistry->bonds.size() < 2)
+   {
+      fprintf(stderr, "textFormatTest: too few bonds formed\n");
+      return(1);
+   }
+   result = check(chemistry, EARLIER_TEXT) &&
+            check(chemistry, TEXT) && check(chemistry, SNAPSHOT) &&
+            checkRejected(chemistry, ATOM_NUMBER) && checkRejected(chemistry, BOND_ORBITAL) &&
+            checkRejected(chemistry, BOND_NUCLEUS) && checkRejected(chemistry, BOND_REPEATED);
+   delete chemistry;
+   if (!result)
+   {
+      return(1);
+   }
+   printf("textFormatTest passed\n");
+   return(0);
+}
@@ -79,3 +79,25 @@ void Thermal::save(FILE *fp)
    FWRITE_FLOAT(&position.z, fp);
    FWRITE_FLOAT(&temperature, fp);
 }
+
+
+// Load thermal from snapshot record.
+void Thermal::load(SnapshotThermal& record)
+{
+   radius      = record.radius;
+   position.x  = record.position[0];
+   position.y  = record.position[1];
+   position.z  = record.position[2];
+   temperature = record.temperature;
+}
+
+
+// Save thermal to snapshot record.
+void Thermal::save(SnapshotThermal& record)
+{
+   record.radius      = radius;
+   record.position[0] = position.x;
+   record.position[1] = position.y;
+   record.position[2] = position.z;
+   record.temperature = temperature;
+}
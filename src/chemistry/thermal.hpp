@@ -56,6 +56,8 @@ public:
    // Load and save thermal.
    void load(FILE *fp);
    void save(FILE *fp);
+   void load(SnapshotThermal& record);
+   void save(SnapshotThermal& record);
 };
 }
 #endif
@@ -0,0 +1,1270 @@
+/*
+ * This software is provided under the terms of the GNU General
+ * Public License as published by the Free Software Foundation.
+ *
+ * Copyright (c) 2006-2007 Tom Portegys, All Rights Reserved.
+ * Permission to use, copy, modify, and distribute this software
+ * and its documentation for NON-COMMERCIAL purposes and without
+ * fee is hereby granted provided that this copyright notice
+ * appears in all copies.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.
+ */
+
+
+/*
+ * Molecular trajectory.
+ */
+
+#include "trajectory.hpp"
+#include "chemistry.hpp"
+using namespace affinity;
+
+// Update cycles between frames.
+const int TrajectoryWriter::DEFAULT_FRAME_FREQ = 100;
+
+// Frames between key frames.
+const int TrajectoryWriter::DEFAULT_KEY_FRAME_FREQ = 100;
+
+// Position quantum.
+const float TrajectoryWriter::DEFAULT_PRECISION = 0.001f;
+
+// Frames queued for writing.
+const int TrajectoryWriter::DEFAULT_QUEUE_SIZE = 8;
+
+// Append unsigned variable length integer.
+static void putUnsigned(vector<unsigned char>& code, unsigned int value)
+{
+   while (value >= 0x80)
+   {
+      code.push_back((unsigned char)(value | 0x80));
+      value >>= 7;
+   }
+   code.push_back((unsigned char)value);
+}
+
+
+// Append signed variable length integer.
+static void putSigned(vector<unsigned char>& code, int value)
+{
+   putUnsigned(code, ((unsigned int)value << 1) ^ (unsigned int)(value >> 31));
+}
+
+
+// Get unsigned variable length integer.
+static bool getUnsigned(unsigned char *& code, unsigned char *end, unsigned int& value)
+{
+   int shift;
+
+   for (value = 0, shift = 0; code < end && shift < 32; shift += 7)
+   {
+      value |= (unsigned int)(*code & 0x7f) << shift;
+      if ((*code++ & 0x80) == 0)
+      {
+         return(true);
+      }
+   }
+   return(false);
+}
+
+
+// Get signed variable length integer.
+static bool getSigned(unsigned char *& code, unsigned char *end, int& value)
+{
+   unsigned int v;
+
+   if (!getUnsigned(code, end, v))
+   {
+      return(false);
+   }
+   value = (int)(v >> 1) ^ -(int)(v & 1);
+   return(true);
+}
+
+
+// Get count no larger than limit.
+static bool getCount(unsigned char *& code, unsigned char *end, int limit, int& count)
+{
+   unsigned int v;
+
+   if (!getUnsigned(code, end, v) || (v > (unsigned int)limit))
+   {
+      return(false);
+   }
+   count = (int)v;
+   return(true);
+}
+
+
+// Append bonds.
+static void putBonds(vector<unsigned char>& code, vector<TrajectoryBond>& bonds)
+{
+   int i, i2, id;
+
+   putUnsigned(code, (unsigned int)bonds.size());
+   for (i = id = 0, i2 = (int)bonds.size(); i < i2; i++)
+   {
+      putSigned(code, bonds[i].id1 - id);
+      putUnsigned(code, (unsigned int)(bonds[i].shell1 + 1));
+      putUnsigned(code, (unsigned int)(bonds[i].orbital1 + 1));
+      putSigned(code, bonds[i].id2 - bonds[i].id1);
+      putUnsigned(code, (unsigned int)(bonds[i].shell2 + 1));
+      putUnsigned(code, (unsigned int)(bonds[i].orbital2 + 1));
+      id = bonds[i].id1;
+   }
+}
+
+
+// Get bonds.
+static bool getBonds(unsigned char *& code, unsigned char *end, vector<TrajectoryBond>& bonds)
+{
+   int            i, n, id, d;
+   unsigned int   s1, o1, s2, o2;
+   TrajectoryBond bond;
+
+   bonds.clear();
+   if (!getCount(code, end, (int)(end - code), n))
+   {
+      return(false);
+   }
+   for (i = id = 0; i < n; i++)
+   {
+      if (!getSigned(code, end, d) || !getUnsigned(code, end, s1) ||
+          !getUnsigned(code, end, o1))
+      {
+         return(false);
+      }
+      bond.id1      = id + d;
+      bond.shell1   = (int)s1 - 1;
+      bond.orbital1 = (int)o1 - 1;
+      if (!getSigned(code, end, d) || !getUnsigned(code, end, s2) ||
+          !getUnsigned(code, end, o2))
+      {
+         return(false);
+      }
+      bond.id2      = bond.id1 + d;
+      bond.shell2   = (int)s2 - 1;
+      bond.orbital2 = (int)o2 - 1;
+      bonds.push_back(bond);
+      id = bond.id1;
+   }
+   return(true);
+}
+
+
+// Get sorted chemistry bonds.
+static void getBonds(Chemistry *chemistry, vector<TrajectoryBond>& bonds)
+{
+   int  i, i2;
+   Body *b1, *b2;
+
+   bonds.clear();
+   for (i = 0, i2 = (int)chemistry->bonds.size(); i < i2; i++)
+   {
+      b1 = chemistry->bonds[i].body1;
+      b2 = chemistry->bonds[i].body2;
+      if ((b2->id < b1->id) ||
+          ((b2->id == b1->id) && ((b2->shell < b1->shell) ||
+                                  ((b2->shell == b1->shell) && (b2->orbital < b1->orbital)))))
+      {
+         b1 = b2;
+         b2 = chemistry->bonds[i].body1;
+      }
+      bonds.push_back(TrajectoryBond(b1->id, b1->shell, b1->orbital,
+                                     b2->id, b2->shell, b2->orbital));
+   }
+   sort(bonds.begin(), bonds.end());
+}
+
+
+// Bond constructor.
+TrajectoryBond::TrajectoryBond(int id1, int shell1, int orbital1,
+                               int id2, int shell2, int orbital2)
+{
+   this->id1      = id1;
+   this->shell1   = shell1;
+   this->orbital1 = orbital1;
+   this->id2      = id2;
+   this->shell2   = shell2;
+   this->orbital2 = orbital2;
+}
+
+
+bool TrajectoryBond::operator<(const TrajectoryBond& bond) const
+{
+   if (id1 != bond.id1)
+   {
+      return(id1 < bond.id1);
+   }
+   if (shell1 != bond.shell1)
+   {
+      return(shell1 < bond.shell1);
+   }
+   if (orbital1 != bond.orbital1)
+   {
+      return(orbital1 < bond.orbital1);
+   }
+   if (id2 != bond.id2)
+   {
+      return(id2 < bond.id2);
+   }
+   if (shell2 != bond.shell2)
+   {
+      return(shell2 < bond.shell2);
+   }
+   return(orbital2 < bond.orbital2);
+}
+
+
+bool TrajectoryBond::operator==(const TrajectoryBond& bond) const
+{
+   return((id1 == bond.id1) && (shell1 == bond.shell1) && (orbital1 == bond.orbital1) &&
+          (id2 == bond.id2) && (shell2 == bond.shell2) && (orbital2 == bond.orbital2));
+}
+
+
+// Frame constructor.
+TrajectoryFrame::TrajectoryFrame()
+{
+   clear();
+}
+
+
+// Clear frame.
+void TrajectoryFrame::clear()
+{
+   cycle = -1;
+   time  = 0.0;
+   ids.clear();
+   numbers.clear();
+   positions.clear();
+   bonds.clear();
+}
+
+
+// Capture chemistry state at position precision.
+void TrajectoryFrame::capture(Chemistry *chemistry, float precision)
+{
+   int    i, i2;
+   Atom   *atom;
+   Vector p;
+
+   clear();
+   cycle = chemistry->updateCycle;
+   time  = chemistry->updateTime;
+   for (i = 0, i2 = chemistry->atomIDfactory; i < i2; i++)
+   {
+      if ((atom = chemistry->getAtom(i)) == NULL)
+      {
+         continue;
+      }
+      p = atom->nucleus.position;
+      ids.push_back(i);
+      numbers.push_back(atom->number);
+      positions.push_back((int)floor((p.x / precision) + 0.5f));
+      positions.push_back((int)floor((p.y / precision) + 0.5f));
+      positions.push_back((int)floor((p.z / precision) + 0.5f));
+   }
+   getBonds(chemistry, bonds);
+}
+
+
+// Code frame, as key frame or against previous frame.
+// Atom changes and positions are followed by bond breaks and
+// formations; runs of unchanged position values are coded as counts.
+void TrajectoryFrame::encode(TrajectoryFrame *previous, vector<unsigned char>& code)
+{
+   int                    i, i2, j, j2, k, n, id, v;
+   vector<int>            removed, added, sources, values;
+   vector<TrajectoryBond> bondChanges;
+
+   code.clear();
+
+   // Removed and added atoms.
+   i2 = (int)ids.size();
+   j2 = (previous != NULL) ? (int)previous->ids.size() : 0;
+   for (i = j = 0; i < i2 || j < j2; )
+   {
+      if ((j < j2) && ((i == i2) || (previous->ids[j] < ids[i])))
+      {
+         removed.push_back(previous->ids[j]);
+         j++;
+      }
+      else if ((j == j2) || (ids[i] < previous->ids[j]))
+      {
+         added.push_back(i);
+         sources.push_back(-1);
+         i++;
+      }
+      else
+      {
+         sources.push_back(j);
+         i++;
+         j++;
+      }
+   }
+   if (previous != NULL)
+   {
+      putUnsigned(code, (unsigned int)removed.size());
+      for (i = id = 0, i2 = (int)removed.size(); i < i2; i++)
+      {
+         putSigned(code, removed[i] - id);
+         id = removed[i];
+      }
+   }
+   putUnsigned(code, (unsigned int)added.size());
+   for (i = id = 0, i2 = (int)added.size(); i < i2; i++)
+   {
+      putSigned(code, ids[added[i]] - id);
+      putUnsigned(code, (unsigned int)numbers[added[i]]);
+      id = ids[added[i]];
+   }
+
+   // Position changes.
+   for (i = 0, i2 = (int)ids.size(); i < i2; i++)
+   {
+      for (k = 0; k < 3; k++)
+      {
+         v = positions[(i * 3) + k];
+         if (sources[i] != -1)
+         {
+            v -= previous->positions[(sources[i] * 3) + k];
+         }
+         values.push_back(v);
+      }
+   }
+   for (i = 0, i2 = (int)values.size(); i < i2; i += n)
+   {
+      putSigned(code, values[i]);
+      n = 1;
+      if (values[i] == 0)
+      {
+         for ( ; (i + n) < i2 && values[i + n] == 0; n++)
+         {
+         }
+         putUnsigned(code, (unsigned int)(n - 1));
+      }
+   }
+
+   // Bond changes.
+   if (previous != NULL)
+   {
+      set_difference(previous->bonds.begin(), previous->bonds.end(),
+                     bonds.begin(), bonds.end(), back_inserter(bondChanges));
+      putBonds(code, bondChanges);
+      bondChanges.clear();
+      set_difference(bonds.begin(), bonds.end(),
+                     previous->bonds.begin(), previous->bonds.end(),
+                     back_inserter(bondChanges));
+      putBonds(code, bondChanges);
+   }
+   else
+   {
+      putBonds(code, bonds);
+   }
+}
+
+
+// Decode frame, as key frame or against previous frame.
+bool TrajectoryFrame::decode(TrajectoryFrame *previous, int numAtoms,
+                             unsigned char *code, int size)
+{
+   int                    i, i2, j, j2, k, n, id, d, v, numRemoved, numAdded;
+   unsigned int           number;
+   unsigned char          *end;
+   vector<int>            removed, addedIDs, addedNumbers, sources;
+   vector<TrajectoryBond> broken, formed;
+
+   end = code + size;
+   ids.clear();
+   numbers.clear();
+   positions.clear();
+   bonds.clear();
+   if (numAtoms < 0)
+   {
+      return(false);
+   }
+
+   // Removed and added atoms.
+   numRemoved = 0;
+   if (previous != NULL)
+   {
+      if (!getCount(code, end, (int)previous->ids.size(), numRemoved))
+      {
+         return(false);
+      }
+      for (i = id = 0; i < numRemoved; i++)
+      {
+         if (!getSigned(code, end, d))
+         {
+            return(false);
+         }
+         id += d;
+         removed.push_back(id);
+      }
+   }
+   if (!getCount(code, end, numAtoms, numAdded))
+   {
+      return(false);
+   }
+   for (i = id = 0; i < numAdded; i++)
+   {
+      if (!getSigned(code, end, d) || !getUnsigned(code, end, number))
+      {
+         return(false);
+      }
+      id += d;
+      addedIDs.push_back(id);
+      addedNumbers.push_back((int)number);
+   }
+
+   // Merge kept and added atoms.
+   j2 = (previous != NULL) ? (int)previous->ids.size() : 0;
+   for (i = j = k = 0; j < j2 || i < numAdded; )
+   {
+      if ((j < j2) && (k < numRemoved) && (previous->ids[j] == removed[k]))
+      {
+         j++;
+         k++;
+      }
+      else if ((j < j2) && ((i == numAdded) || (previous->ids[j] < addedIDs[i])))
+      {
+         ids.push_back(previous->ids[j]);
+         numbers.push_back(previous->numbers[j]);
+         sources.push_back(j);
+         j++;
+      }
+      else
+      {
+         ids.push_back(addedIDs[i]);
+         numbers.push_back(addedNumbers[i]);
+         sources.push_back(-1);
+         i++;
+      }
+   }
+   if ((k != numRemoved) || ((int)ids.size() != numAtoms))
+   {
+      return(false);
+   }
+
+   // Positions.
+   positions.resize(numAtoms * 3);
+   for (i = 0, i2 = numAtoms * 3; i < i2; )
+   {
+      if (!getSigned(code, end, v))
+      {
+         return(false);
+      }
+      n = 1;
+      if (v == 0)
+      {
+         if (!getCount(code, end, i2 - i - 1, n))
+         {
+            return(false);
+         }
+         n++;
+      }
+      for ( ; n > 0; n--, i++)
+      {
+         positions[i] = v;
+      }
+   }
+   for (i = 0; i < numAtoms; i++)
+   {
+      if (sources[i] != -1)
+      {
+         for (k = 0; k < 3; k++)
+         {
+            positions[(i * 3) + k] += previous->positions[(sources[i] * 3) + k];
+         }
+      }
+   }
+
+   // Bonds.
+   if (previous != NULL)
+   {
+      if (!getBonds(code, end, broken) || !getBonds(code, end, formed))
+      {
+         return(false);
+      }
+      set_difference(previous->bonds.begin(), previous->bonds.end(),
+                     broken.begin(), broken.end(), back_inserter(bonds));
+      i2 = (int)bonds.size();
+      bonds.insert(bonds.end(), formed.begin(), formed.end());
+      inplace_merge(bonds.begin(), bonds.begin() + i2, bonds.end());
+   }
+   else if (!getBonds(code, end, bonds))
+   {
+      return(false);
+   }
+   return(code == end);
+}
+
+
+// Get positions at precision as x,y,z per atom.
+void TrajectoryFrame::getPositions(float precision, vector<float>& xyz)
+{
+   int i, i2;
+
+   xyz.resize(positions.size());
+   for (i = 0, i2 = (int)positions.size(); i < i2; i++)
+   {
+      xyz[i] = (float)positions[i] * precision;
+   }
+}
+
+
+// Restore chemistry to frame at position precision.
+void TrajectoryFrame::restore(Chemistry *chemistry, float precision)
+{
+   int                    i, i2;
+   Atom                   *atom;
+   Body                   *b1, *b2;
+   Vector                 p;
+   vector<int>            removed;
+   vector<TrajectoryBond> current, changes;
+
+   // Remove atoms missing from frame.
+   for (i = 0, i2 = (int)chemistry->atoms.size(); i < i2; i++)
+   {
+      if (!binary_search(ids.begin(), ids.end(), chemistry->atoms[i]->getID()))
+      {
+         removed.push_back(chemistry->atoms[i]->getID());
+      }
+   }
+   for (i = 0, i2 = (int)removed.size(); i < i2; i++)
+   {
+      chemistry->removeAtom(removed[i]);
+   }
+
+   // Add and place atoms.
+   for (i = 0, i2 = (int)ids.size(); i < i2; i++)
+   {
+      atom = chemistry->getAtom(ids[i]);
+      if ((atom != NULL) && (atom->number != numbers[i]))
+      {
+         chemistry->removeAtom(ids[i]);
+         atom = NULL;
+      }
+      if (atom == NULL)
+      {
+         atom = chemistry->createAtom(numbers[i], ids[i]);
+         if (chemistry->atomIDfactory <= ids[i])
+         {
+            chemistry->atomIDfactory = ids[i] + 1;
+         }
+      }
+      p.x = (float)positions[i * 3] * precision;
+      p.y = (float)positions[(i * 3) + 1] * precision;
+      p.z = (float)positions[(i * 3) + 2] * precision;
+      atom->setPosition(p);
+   }
+
+   // Break and form bonds.
+   getBonds(chemistry, current);
+   set_difference(current.begin(), current.end(),
+                  bonds.begin(), bonds.end(), back_inserter(changes));
+   for (i = 0, i2 = (int)changes.size(); i < i2; i++)
+   {
+      chemistry->removeBond(chemistry->getBody(changes[i].id1, changes[i].shell1,
+                                               changes[i].orbital1));
+   }
+   changes.clear();
+   set_difference(bonds.begin(), bonds.end(),
+                  current.begin(), current.end(), back_inserter(changes));
+   for (i = 0, i2 = (int)changes.size(); i < i2; i++)
+   {
+      b1 = chemistry->getBody(changes[i].id1, changes[i].shell1, changes[i].orbital1);
+      b2 = chemistry->getBody(changes[i].id2, changes[i].shell2, changes[i].orbital2);
+      if ((b1 != NULL) && (b2 != NULL) && (b1->covalentBody == NULL) &&
+          (b2->covalentBody == NULL))
+      {
+         chemistry->createBond(b1, b2);
+      }
+   }
+   chemistry->updateCycle = cycle;
+   chemistry->updateTime  = time;
+   chemistry->resetBondSearch();
+}
+
+
+// Writer constructor.
+TrajectoryWriter::TrajectoryWriter(FILE *fp, float vesselRadius, int frameFreq,
+                                   float precision, int keyFrameFreq, int queueSize)
+{
+   assert(fp != NULL);
+   assert(frameFreq > 0);
+   assert(precision > 0.0f);
+   assert(keyFrameFreq > 0);
+   assert(queueSize > 0);
+   this->fp        = fp;
+   this->queueSize = queueSize;
+   memset(&header, 0, sizeof(header));
+   memcpy(header.magic, TRAJECTORY_MAGIC, TRAJECTORY_MAGIC_SIZE);
+   header.version      = TRAJECTORY_VERSION;
+   header.byteOrder    = TRAJECTORY_BYTE_ORDER;
+   header.headerSize   = (int)sizeof(TrajectoryHeader);
+   header.frameFreq    = frameFreq;
+   header.keyFrameFreq = keyFrameFreq;
+   header.precision    = precision;
+   header.vesselRadius = vesselRadius;
+   fwrite(&header, sizeof(header), 1, fp);
+   offset   = (long long)sizeof(header);
+   previous = NULL;
+   written  = dropped = 0;
+#ifdef THREADS
+   busy = terminate = false;
+   if (pthread_mutex_init(&mutex, NULL) != 0)
+   {
+      fprintf(stderr, "pthread_mutex_init failed, errno=%d\n", errno);
+      exit(1);
+   }
+   if (pthread_cond_init(&cond, NULL) != 0)
+   {
+      fprintf(stderr, "pthread_cond_init failed, errno=%d\n", errno);
+      exit(1);
+   }
+   if (pthread_create(&thread, NULL, run, (void *)this) != 0)
+   {
+      fprintf(stderr, "pthread_create failed, errno=%d\n", errno);
+      exit(1);
+   }
+#endif
+}
+
+
+// Writer destructor.
+TrajectoryWriter::~TrajectoryWriter()
+{
+   int i, i2;
+
+#ifdef THREADS
+   pthread_mutex_lock(&mutex);
+   terminate = true;
+   pthread_cond_broadcast(&cond);
+   pthread_mutex_unlock(&mutex);
+   pthread_join(thread, NULL);
+   pthread_cond_destroy(&cond);
+   pthread_mutex_destroy(&mutex);
+#endif
+   writeIndex();
+   fflush(fp);
+   for (i = 0, i2 = (int)freeFrames.size(); i < i2; i++)
+   {
+      delete freeFrames[i];
+   }
+   freeFrames.clear();
+   if (previous != NULL)
+   {
+      delete previous;
+      previous = NULL;
+   }
+}
+
+
+// Record chemistry frame if due on update cycle.
+bool TrajectoryWriter::record(Chemistry *chemistry)
+{
+   TrajectoryFrame *frame;
+
+   if ((chemistry->updateCycle % header.frameFreq) != 0)
+   {
+      return(true);
+   }
+#ifdef THREADS
+   pthread_mutex_lock(&mutex);
+   if ((int)queue.size() >= queueSize)
+   {
+      dropped++;
+      pthread_mutex_unlock(&mutex);
+      return(false);
+   }
+#endif
+   if (freeFrames.size() > 0)
+   {
+      frame = freeFrames.back();
+      freeFrames.pop_back();
+   }
+   else
+   {
+      frame = new TrajectoryFrame();
+      assert(frame != NULL);
+   }
+#ifdef THREADS
+   pthread_mutex_unlock(&mutex);
+#endif
+   frame->capture(chemistry, header.precision);
+#ifdef THREADS
+   pthread_mutex_lock(&mutex);
+   queue.push_back(frame);
+   pthread_cond_broadcast(&cond);
+   pthread_mutex_unlock(&mutex);
+#else
+   write(frame);
+#endif
+   return(true);
+}
+
+
+// Wait for queued frames to be written.
+void TrajectoryWriter::flush()
+{
+#ifdef THREADS
+   pthread_mutex_lock(&mutex);
+   while ((queue.size() > 0) || busy)
+   {
+      pthread_cond_wait(&cond, &mutex);
+   }
+   pthread_mutex_unlock(&mutex);
+#endif
+   fflush(fp);
+}
+
+
+// Frames written.
+int TrajectoryWriter::getWritten()
+{
+   int n;
+
+#ifdef THREADS
+   pthread_mutex_lock(&mutex);
+#endif
+   n = written;
+#ifdef THREADS
+   pthread_mutex_unlock(&mutex);
+#endif
+   return(n);
+}
+
+
+// Frames dropped on full queue.
+int TrajectoryWriter::getDropped()
+{
+   int n;
+
+#ifdef THREADS
+   pthread_mutex_lock(&mutex);
+#endif
+   n = dropped;
+#ifdef THREADS
+   pthread_mutex_unlock(&mutex);
+#endif
+   return(n);
+}
+
+
+// Code and write frame.
+// Dropped frames are skipped, so deltas are always against the
+// last frame written.
+void TrajectoryWriter::write(TrajectoryFrame *frame)
+{
+   TrajectoryFrameHeader frameHeader;
+   TrajectoryIndexEntry  entry;
+   TrajectoryFrame       *last;
+
+   if ((previous == NULL) || ((written % header.keyFrameFreq) == 0))
+   {
+      frameHeader.type = TrajectoryFrame::KEY_FRAME;
+      frame->encode(NULL, code);
+   }
+   else
+   {
+      frameHeader.type = TrajectoryFrame::DELTA_FRAME;
+      frame->encode(previous, code);
+   }
+   frameHeader.cycle    = frame->cycle;
+   frameHeader.time     = frame->time;
+   frameHeader.numAtoms = (int)frame->ids.size();
+   frameHeader.size     = (int)code.size();
+   fwrite(&frameHeader, sizeof(frameHeader), 1, fp);
+   if (code.size() > 0)
+   {
+      fwrite(&code[0], code.size(), 1, fp);
+   }
+   entry.offset   = offset;
+   entry.type     = frameHeader.type;
+   entry.cycle    = frameHeader.cycle;
+   entry.time     = frameHeader.time;
+   entry.numAtoms = frameHeader.numAtoms;
+   entry.size     = frameHeader.size;
+   index.push_back(entry);
+   offset  += (long long)sizeof(frameHeader) + (long long)frameHeader.size;
+   last     = previous;
+   previous = frame;
+#ifdef THREADS
+   pthread_mutex_lock(&mutex);
+#endif
+   written++;
+   if (last != NULL)
+   {
+      freeFrames.push_back(last);
+   }
+#ifdef THREADS
+   pthread_mutex_unlock(&mutex);
+#endif
+}
+
+
+// Write frame index and point header at it.
+// The index record is found by scanning if the file cannot seek.
+void TrajectoryWriter::writeIndex()
+{
+   TrajectoryFrameHeader frameHeader;
+
+   frameHeader.type     = TrajectoryFrame::FRAME_INDEX;
+   frameHeader.cycle    = -1;
+   frameHeader.time     = 0.0;
+   frameHeader.numAtoms = (int)index.size();
+   frameHeader.size     = (int)(index.size() * sizeof(TrajectoryIndexEntry));
+   fwrite(&frameHeader, sizeof(frameHeader), 1, fp);
+   if (index.size() > 0)
+   {
+      fwrite(&index[0], sizeof(TrajectoryIndexEntry), index.size(), fp);
+   }
+   header.numFrames   = (int)index.size();
+   header.indexOffset = offset;
+   if (fseek(fp, 0, SEEK_SET) == 0)
+   {
+      fwrite(&header, sizeof(header), 1, fp);
+      fseek(fp, 0, SEEK_END);
+   }
+}
+
+
+#ifdef THREADS
+// Writer thread.
+void *TrajectoryWriter::run(void *arg)
+{
+   TrajectoryWriter *writer = (TrajectoryWriter *)arg;
+   TrajectoryFrame  *frame;
+
+   pthread_mutex_lock(&writer->mutex);
+   while (true)
+   {
+      while ((writer->queue.size() == 0) && !writer->terminate)
+      {
+         pthread_cond_wait(&writer->cond, &writer->mutex);
+      }
+      if (writer->queue.size() == 0)
+      {
+         break;
+      }
+      frame = writer->queue[0];
+      writer->queue.erase(writer->queue.begin());
+      writer->busy = true;
+      pthread_mutex_unlock(&writer->mutex);
+      writer->write(frame);
+      pthread_mutex_lock(&writer->mutex);
+      writer->busy = false;
+      pthread_cond_broadcast(&writer->cond);
+   }
+   pthread_mutex_unlock(&writer->mutex);
+   return(NULL);
+}
+#endif
+
+
+// Reader constructor.
+TrajectoryReader::TrajectoryReader(FILE *fp)
+{
+   long long end;
+
+   assert(fp != NULL);
+   this->fp     = fp;
+   data         = NULL;
+   dataSize     = 0;
+   currentFrame = -1;
+   valid        = false;
+   memset(&header, 0, sizeof(header));
+   if ((fread(&header, TRAJECTORY_V1_HEADER_SIZE, 1, fp) != 1) ||
+       (memcmp(header.magic, TRAJECTORY_MAGIC, TRAJECTORY_MAGIC_SIZE) != 0) ||
+       (header.version < 1) || (header.version > TRAJECTORY_VERSION) ||
+       (header.byteOrder != TRAJECTORY_BYTE_ORDER) ||
+       (header.precision <= 0.0f))
+   {
+      return;
+   }
+   if (header.version == 1)
+   {
+      if (header.headerSize < TRAJECTORY_V1_HEADER_SIZE)
+      {
+         return;
+      }
+   }
+   else if ((header.headerSize < (int)sizeof(header)) ||
+            (fread((char *)&header + TRAJECTORY_V1_HEADER_SIZE,
+                   sizeof(header) - TRAJECTORY_V1_HEADER_SIZE, 1, fp) != 1))
+   {
+      return;
+   }
+   fseek(fp, 0, SEEK_END);
+   end = (long long)ftell(fp);
+   valid = true;
+
+#ifdef UNIX
+   // Map file.
+   if (end > 0)
+   {
+      void *p = mmap(NULL, (size_t)end, PROT_READ, MAP_SHARED, fileno(fp), 0);
+      if (p != MAP_FAILED)
+      {
+         data     = (unsigned char *)p;
+         dataSize = end;
+      }
+   }
+#endif
+
+   // Load frame index, or scan frames for it.
+   if ((header.indexOffset <= 0) || !loadIndex(header.indexOffset, end))
+   {
+      scanFrames(end);
+   }
+#ifdef THREADS
+   prefetchFrame = -1;
+   busy          = terminate = false;
+   if (pthread_mutex_init(&mutex, NULL) != 0)
+   {
+      fprintf(stderr, "pthread_mutex_init failed, errno=%d\n", errno);
+      exit(1);
+   }
+   if (pthread_cond_init(&cond, NULL) != 0)
+   {
+      fprintf(stderr, "pthread_cond_init failed, errno=%d\n", errno);
+      exit(1);
+   }
+   if (pthread_create(&thread, NULL, run, (void *)this) != 0)
+   {
+      fprintf(stderr, "pthread_create failed, errno=%d\n", errno);
+      exit(1);
+   }
+#endif
+}
+
+
+// Reader destructor.
+TrajectoryReader::~TrajectoryReader()
+{
+#ifdef THREADS
+   if (valid)
+   {
+      pthread_mutex_lock(&mutex);
+      terminate = true;
+      pthread_cond_broadcast(&cond);
+      pthread_mutex_unlock(&mutex);
+      pthread_join(thread, NULL);
+      pthread_cond_destroy(&cond);
+      pthread_mutex_destroy(&mutex);
+   }
+#endif
+#ifdef UNIX
+   if (data != NULL)
+   {
+      munmap(data, (size_t)dataSize);
+      data = NULL;
+   }
+#endif
+}
+
+
+// Get bytes at offset, mapped or read into buffer.
+bool TrajectoryReader::getBytes(long long offset, int size, vector<unsigned char>& buffer,
+                                unsigned char *& bytes)
+{
+   if ((offset < 0) || (size < 0))
+   {
+      return(false);
+   }
+   if (data != NULL)
+   {
+      if ((offset + (long long)size) > dataSize)
+      {
+         return(false);
+      }
+      bytes = data + offset;
+      return(true);
+   }
+   buffer.resize(size + 1);
+   bytes = &buffer[0];
+   if (fseek(fp, (long)offset, SEEK_SET) != 0)
+   {
+      return(false);
+   }
+   return((size == 0) || (fread(bytes, size, 1, fp) == 1));
+}
+
+
+// Load index record at offset.
+bool TrajectoryReader::loadIndex(long long indexOffset, long long end)
+{
+   int                   i, i2;
+   unsigned char         *bytes;
+   vector<unsigned char> buffer;
+
+   TrajectoryFrameHeader frameHeader;
+
+   frames.clear();
+   if ((indexOffset < header.headerSize) ||
+       ((indexOffset + (long long)sizeof(frameHeader)) > end) ||
+       !getBytes(indexOffset, (int)sizeof(frameHeader), buffer, bytes))
+   {
+      return(false);
+   }
+   memcpy(&frameHeader, bytes, sizeof(frameHeader));
+   if ((frameHeader.type != TrajectoryFrame::FRAME_INDEX) || (frameHeader.numAtoms < 0) ||
+       ((long long)frameHeader.size != ((long long)frameHeader.numAtoms * (long long)sizeof(TrajectoryIndexEntry))) ||
+       ((indexOffset + (long long)sizeof(frameHeader) + (long long)frameHeader.size) > end) ||
+       !getBytes(indexOffset + (long long)sizeof(frameHeader), frameHeader.size, buffer, bytes))
+   {
+      return(false);
+   }
+   frames.resize(frameHeader.numAtoms);
+   if (frameHeader.numAtoms > 0)
+   {
+      memcpy(&frames[0], bytes, frameHeader.size);
+   }
+   for (i = 0, i2 = (int)frames.size(); i < i2; i++)
+   {
+      if (((frames[i].type != TrajectoryFrame::KEY_FRAME) &&
+           (frames[i].type != TrajectoryFrame::DELTA_FRAME)) ||
+          (frames[i].offset < header.headerSize) || (frames[i].size < 0) ||
+          (frames[i].numAtoms < 0) ||
+          ((frames[i].offset + (long long)sizeof(frameHeader) + (long long)frames[i].size) > indexOffset) ||
+          ((i > 0) && (frames[i].cycle < frames[i - 1].cycle)))
+      {
+         frames.clear();
+         return(false);
+      }
+   }
+   return(true);
+}
+
+
+// Index frames by scanning frame headers, up to the end of the
+// file, a partial frame or the index record.
+void TrajectoryReader::scanFrames(long long end)
+{
+   long long             offset;
+   unsigned char         *bytes;
+   vector<unsigned char> buffer;
+
+   TrajectoryFrameHeader frameHeader;
+   TrajectoryIndexEntry  entry;
+
+   frames.clear();
+   for (offset = header.headerSize; (offset + (long long)sizeof(frameHeader)) <= end; )
+   {
+      if (!getBytes(offset, (int)sizeof(frameHeader), buffer, bytes))
+      {
+         break;
+      }
+      memcpy(&frameHeader, bytes, sizeof(frameHeader));
+      if ((frameHeader.size < 0) || (frameHeader.numAtoms < 0) ||
+          ((frameHeader.type != TrajectoryFrame::KEY_FRAME) &&
+           (frameHeader.type != TrajectoryFrame::DELTA_FRAME)) ||
+          ((offset + (long long)sizeof(frameHeader) + (long long)frameHeader.size) > end))
+      {
+         break;
+      }
+      entry.offset   = offset;
+      entry.type     = frameHeader.type;
+      entry.cycle    = frameHeader.cycle;
+      entry.time     = frameHeader.time;
+      entry.numAtoms = frameHeader.numAtoms;
+      entry.size     = frameHeader.size;
+      frames.push_back(entry);
+      offset += (long long)sizeof(frameHeader) + (long long)frameHeader.size;
+   }
+}
+
+
+// Get number of frames.
+int TrajectoryReader::getNumFrames()
+{
+   return((int)frames.size());
+}
+
+
+// Find last frame at or before update cycle.
+int TrajectoryReader::findFrame(int cycle)
+{
+   int lo, hi, mid;
+
+   for (lo = 0, hi = (int)frames.size(); lo < hi; )
+   {
+      mid = (lo + hi) / 2;
+      if (frames[mid].cycle <= cycle)
+      {
+         lo = mid + 1;
+      }
+      else
+      {
+         hi = mid;
+      }
+   }
+   return(lo - 1);
+}
+
+
+// Read next frame.
+bool TrajectoryReader::read(TrajectoryFrame& frame)
+{
+   return(read(currentFrame + 1, frame));
+}
+
+
+// Read frame by number.
+bool TrajectoryReader::read(int frameNum, TrajectoryFrame& frame)
+{
+   bool result;
+
+   if (!valid || (frameNum < 0) || (frameNum >= (int)frames.size()))
+   {
+      return(false);
+   }
+#ifdef THREADS
+   pthread_mutex_lock(&mutex);
+   while (busy)
+   {
+      pthread_cond_wait(&cond, &mutex);
+   }
+   prefetchFrame = -1;
+   pthread_mutex_unlock(&mutex);
+#endif
+   if ((result = decode(frameNum)))
+   {
+      frame = current;
+   }
+   return(result);
+}
+
+
+// Read last frame at or before update cycle.
+bool TrajectoryReader::readCycle(int cycle, TrajectoryFrame& frame)
+{
+   int frameNum;
+
+   if ((frameNum = findFrame(cycle)) < 0)
+   {
+      return(false);
+   }
+   return(read(frameNum, frame));
+}
+
+
+// Create chemistry restored to last frame at or before update cycle.
+Chemistry *TrajectoryReader::getChemistry(int cycle)
+{
+   Chemistry       *chemistry;
+   TrajectoryFrame frame;
+
+   if (!readCycle(cycle, frame))
+   {
+      return(NULL);
+   }
+#ifdef THREADS
+   chemistry = new Chemistry(header.vesselRadius, (RANDOM)(frame.cycle + 1), 1);
+#else
+   chemistry = new Chemistry(header.vesselRadius, (RANDOM)(frame.cycle + 1));
+#endif
+   assert(chemistry != NULL);
+   chemistry->init(0);
+   frame.restore(chemistry, header.precision);
+   return(chemistry);
+}
+
+
+// Prefetch frame by number.
+void TrajectoryReader::prefetch(int frameNum)
+{
+#ifdef THREADS
+   if (!valid || (frameNum < 0) || (frameNum >= (int)frames.size()))
+   {
+      return;
+   }
+   pthread_mutex_lock(&mutex);
+   if (!busy && (frameNum != currentFrame))
+   {
+      prefetchFrame = frameNum;
+      busy          = true;
+      pthread_cond_broadcast(&cond);
+   }
+   pthread_mutex_unlock(&mutex);
+#endif
+}
+
+
+// Decode frame into current frame.
+// Decoding continues from the current frame if no key frame
+// intervenes, otherwise starts at the nearest preceding key frame.
+bool TrajectoryReader::decode(int frameNum)
+{
+   int           i, k;
+   unsigned char *bytes;
+
+   if (frameNum == currentFrame)
+   {
+      return(true);
+   }
+   for (k = frameNum; k >= 0 && frames[k].type != TrajectoryFrame::KEY_FRAME; k--)
+   {
+   }
+   if (k < 0)
+   {
+      return(false);
+   }
+   i = k;
+   if ((currentFrame >= k) && (currentFrame < frameNum))
+   {
+      i = currentFrame + 1;
+   }
+   for ( ; i <= frameNum; i++)
+   {
+      if (!getBytes(frames[i].offset + (long long)sizeof(TrajectoryFrameHeader),
+                    frames[i].size, code, bytes) ||
+          !next.decode(i == k ? NULL : &current, frames[i].numAtoms,
+                       bytes, frames[i].size))
+      {
+         currentFrame = -1;
+         return(false);
+      }
+      next.cycle = frames[i].cycle;
+      next.time  = frames[i].time;
+      swap(current, next);
+      currentFrame = i;
+   }
+   return(true);
+}
+
+
+#ifdef THREADS
+// Prefetch thread.
+void *TrajectoryReader::run(void *arg)
+{
+   TrajectoryReader *reader = (TrajectoryReader *)arg;
+   int              frameNum;
+
+   pthread_mutex_lock(&reader->mutex);
+   while (true)
+   {
+      while (!reader->busy && !reader->terminate)
+      {
+         pthread_cond_wait(&reader->cond, &reader->mutex);
+      }
+      if (reader->terminate)
+      {
+         break;
+      }
+      frameNum = reader->prefetchFrame;
+      pthread_mutex_unlock(&reader->mutex);
+      reader->decode(frameNum);
+      pthread_mutex_lock(&reader->mutex);
+      reader->busy = false;
+      pthread_cond_broadcast(&reader->cond);
+   }
+   pthread_mutex_unlock(&reader->mutex);
+   return(NULL);
+}
+#endif
@@ -0,0 +1,313 @@
+/*
+ * This software is provided under the terms of the GNU General
+ * Public License as published by the Free Software Foundation.
+ *
+ * Copyright (c) 2006-2007 Tom Portegys, All Rights Reserved.
+ * Permission to use, copy, modify, and distribute this software
+ * and its documentation for NON-COMMERCIAL purposes and without
+ * fee is hereby granted provided that this copyright notice
+ * appears in all copies.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED.
+ */
+
+
+/*
+ * Molecular trajectory.
+ * Frames of atom positions and bonds are appended every so many
+ * update cycles. Positions are quantized to a precision and coded as
+ * differences from the previous frame, bonds as formations and breaks,
+ * and the values are packed as variable length integers with zero runs.
+ * Frames are coded and written on a worker thread from a bounded queue,
+ * so recording never waits on the disk. Closing the trajectory appends
+ * a frame index, through which readers materialize any cycle from its
+ * nearest key frame.
+ */
+
+#ifndef __TRAJECTORY__
+#define __TRAJECTORY__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <errno.h>
+#include <assert.h>
+#include <vector>
+#include <algorithm>
+#ifdef THREADS
+#include <pthread.h>
+#endif
+#ifdef UNIX
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+using namespace std;
+
+namespace affinity
+{
+class Chemistry;
+
+// File header.
+// Version 1 files have no index fields and are indexed by scanning.
+#define TRAJECTORY_MAGIC            "AFTR"
+#define TRAJECTORY_MAGIC_SIZE       4
+#define TRAJECTORY_VERSION          2
+#define TRAJECTORY_BYTE_ORDER       0x01020304u
+#define TRAJECTORY_V1_HEADER_SIZE   32
+
+struct TrajectoryHeader
+{
+   char         magic[TRAJECTORY_MAGIC_SIZE];
+   int          version;
+   unsigned int byteOrder;
+   int          headerSize;
+   int          frameFreq;                        // update cycles between frames
+   int          keyFrameFreq;                     // frames between key frames
+   float        precision;                        // position quantum
+   float        vesselRadius;
+   int          numFrames;                        // indexed frames
+   int          reserved;
+   long long    indexOffset;                      // index record (0=none)
+};
+
+// Frame header: a key frame is complete, a delta frame is
+// coded against the preceding frame. The index record shares the
+// header, with an entry per frame following.
+struct TrajectoryFrameHeader
+{
+   int    type;                                   // KEY_FRAME, DELTA_FRAME or FRAME_INDEX
+   int    cycle;                                  // update cycle
+   double time;                                   // simulated time
+   int    numAtoms;
+   int    size;                                   // coded bytes following
+};
+
+// Frame index entry.
+struct TrajectoryIndexEntry
+{
+   long long offset;                              // frame header offset
+   int       type;
+   int       cycle;
+   double    time;
+   int       numAtoms;
+   int       size;
+};
+
+// Bond between atom orbitals, lesser end first.
+class TrajectoryBond
+{
+public:
+
+   int id1, shell1, orbital1;
+   int id2, shell2, orbital2;
+
+   // Constructor.
+   TrajectoryBond(int id1 = -1, int shell1 = -1, int orbital1 = -1,
+                  int id2 = -1, int shell2 = -1, int orbital2 = -1);
+
+   bool operator<(const TrajectoryBond& bond) const;
+   bool operator==(const TrajectoryBond& bond) const;
+};
+
+// Trajectory frame: atoms in ID order with quantized positions.
+class TrajectoryFrame
+{
+public:
+
+   enum { KEY_FRAME=0, DELTA_FRAME=1, FRAME_INDEX=2 };
+
+   int                    cycle;
+   double                 time;
+   vector<int>            ids;
+   vector<int>            numbers;
+   vector<int>            positions;              // x,y,z per atom
+   vector<TrajectoryBond> bonds;                  // sorted
+
+   // Constructor.
+   TrajectoryFrame();
+
+   // Capture chemistry state at position precision.
+   void capture(Chemistry *chemistry, float precision);
+
+   // Clear.
+   void clear();
+
+   // Code frame, as key frame or against previous frame.
+   void encode(TrajectoryFrame *previous, vector<unsigned char>& code);
+
+   // Decode frame, as key frame or against previous frame.
+   // Returns false if code is invalid.
+   bool decode(TrajectoryFrame *previous, int numAtoms,
+               unsigned char *code, int size);
+
+   // Get positions at precision as x,y,z per atom.
+   void getPositions(float precision, vector<float>& xyz);
+
+   // Restore chemistry to frame at position precision.
+   // Atoms are added and removed by ID, nuclei are placed with their
+   // orbitals, and bonds are broken and formed to match the frame.
+   void restore(Chemistry *chemistry, float precision);
+};
+
+// Trajectory writer.
+class TrajectoryWriter
+{
+public:
+
+   static const int   DEFAULT_FRAME_FREQ;
+   static const int   DEFAULT_KEY_FRAME_FREQ;
+   static const float DEFAULT_PRECISION;
+   static const int   DEFAULT_QUEUE_SIZE;
+
+   // Constructor: writes file header.
+   TrajectoryWriter(FILE *fp, float vesselRadius,
+                    int frameFreq = DEFAULT_FRAME_FREQ,
+                    float precision = DEFAULT_PRECISION,
+                    int keyFrameFreq = DEFAULT_KEY_FRAME_FREQ,
+                    int queueSize = DEFAULT_QUEUE_SIZE);
+
+   // Destructor: writes queued frames and the frame index.
+   // The file is not closed.
+   ~TrajectoryWriter();
+
+   // Record chemistry frame if due on update cycle.
+   // Returns false and counts the frame as dropped if the queue is full.
+   bool record(Chemistry *chemistry);
+
+   // Wait for queued frames to be written.
+   void flush();
+
+   // Frames written and dropped.
+   int getWritten();
+   int getDropped();
+
+   TrajectoryHeader header;
+
+private:
+
+   FILE *fp;
+
+   // Frame queue and free frames.
+   vector<TrajectoryFrame *> queue;
+   vector<TrajectoryFrame *> freeFrames;
+   int                       queueSize;
+
+   // Last frame written.
+   TrajectoryFrame       *previous;
+   vector<unsigned char> code;
+   int                   written;
+   int                   dropped;
+
+   // Index of frames written, and offset of next frame.
+   vector<TrajectoryIndexEntry> index;
+   long long                    offset;
+
+   // Code and write frame.
+   void write(TrajectoryFrame *frame);
+
+   // Write frame index and point header at it.
+   void writeIndex();
+
+#ifdef THREADS
+   pthread_t       thread;
+   pthread_mutex_t mutex;
+   pthread_cond_t  cond;
+   bool            busy;
+   bool            terminate;
+   static void *run(void *writer);
+#endif
+};
+
+// Trajectory reader.
+// Frames are located through the index written with the trajectory,
+// or by scanning frame headers if there is none, and are read in any
+// order by decoding from the nearest preceding key frame. Where
+// supported the file is memory-mapped and frames are decoded in place,
+// so separate readers can work through disjoint ranges of one file
+// concurrently. A frame can be prefetched on a worker thread ahead of
+// reading it.
+class TrajectoryReader
+{
+public:
+
+   // Constructor: reads file header and frame index.
+   TrajectoryReader(FILE *fp);
+
+   // Destructor.
+   // The file is not closed.
+   ~TrajectoryReader();
+
+   // Valid file?
+   bool valid;
+
+   TrajectoryHeader header;
+
+   // Frame index.
+   vector<TrajectoryIndexEntry> frames;
+
+   // Get number of frames.
+   int getNumFrames();
+
+   // Find last frame at or before update cycle (-1=none).
+   int findFrame(int cycle);
+
+   // Read next frame; returns false at end of file.
+   bool read(TrajectoryFrame& frame);
+
+   // Read frame by number; returns false if invalid.
+   bool read(int frameNum, TrajectoryFrame& frame);
+
+   // Read last frame at or before update cycle; returns false if none.
+   bool readCycle(int cycle, TrajectoryFrame& frame);
+
+   // Create chemistry restored to last frame at or before update
+   // cycle (NULL=none).
+   Chemistry *getChemistry(int cycle);
+
+   // Prefetch frame by number.
+   void prefetch(int frameNum);
+
+private:
+
+   FILE *fp;
+
+   // Mapped file (NULL=read by stream).
+   unsigned char *data;
+   long long     dataSize;
+
+   // Get bytes at offset, mapped or read into buffer.
+   bool getBytes(long long offset, int size, vector<unsigned char>& buffer,
+                 unsigned char *& bytes);
+
+   // Load index record at offset; returns false if invalid.
+   bool loadIndex(long long indexOffset, long long end);
+
+   // Index frames by scanning frame headers.
+   void scanFrames(long long end);
+
+   // Current and next decoded frames.
+   TrajectoryFrame       current;
+   TrajectoryFrame       next;
+   int                   currentFrame;
+   vector<unsigned char> code;
+
+   // Decode frame into current frame.
+   bool decode(int frameNum);
+
+#ifdef THREADS
+   pthread_t       thread;
+   pthread_mutex_t mutex;
+   pthread_cond_t  cond;
+   int             prefetchFrame;
+   bool            busy;
+   bool            terminate;
+   static void *run(void *reader);
+#endif
+};
+}
+#endif
@@ -319,6 +319,26 @@ void Random::RAND_SAVE(FILE *fp)
    save_genrand(fp);
 }
 
+// Get random state
+void Random::RAND_GET_STATE(unsigned int *state, int& index)
+{
+   for (int i = 0; i < RAND_N; i++)
+   {
+      state[i] = (unsigned int)mt[i];
+   }
+   index = mti;
+}
+
+// Set random state
+void Random::RAND_SET_STATE(unsigned int *state, int index)
+{
+   for (int i = 0; i < RAND_N; i++)
+   {
+      mt[i] = (RANDOM)state[i];
+   }
+   mti = index;
+}
+
 // Save random state
 void Random::RAND_PUSH()
 {
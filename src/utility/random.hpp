@@ -86,6 +86,10 @@ public:
    // Save random state
    void RAND_SAVE(FILE *fp);
 
+   // Get and set random state as RAND_N 32-bit words and an index.
+   void RAND_GET_STATE(unsigned int *state, int& index);
+   void RAND_SET_STATE(unsigned int *state, int index);
+
    // Save random state
    void RAND_PUSH();
 